@@ -38,6 +38,9 @@ For discussion please visit http://box2d.org/forum
 #include <Box2D/Collision/Shapes/b2CircleShape.h>
 #include <Box2D/Collision/Shapes/b2EdgeShape.h>
 #include <Box2D/Collision/Shapes/b2ChainShape.h>
+#include <Box2D/Collision/Shapes/b2CompoundShape.h>
+#include <Box2D/Collision/Shapes/b2HeightFieldShape.h>
+#include <Box2D/Collision/Shapes/b2CapsuleShape.h>
 #include <Box2D/Collision/Shapes/b2PolygonShape.h>
 
 #include <Box2D/Collision/b2BroadPhase.h>
@@ -46,10 +49,15 @@ For discussion please visit http://box2d.org/forum
 #include <Box2D/Collision/b2TimeOfImpact.h>
 
 #include <Box2D/Dynamics/b2Body.h>
+#include <Box2D/Dynamics/b2BodyPrefab.h>
 #include <Box2D/Dynamics/b2Fixture.h>
 #include <Box2D/Dynamics/b2WorldCallbacks.h>
 #include <Box2D/Dynamics/b2TimeStep.h>
+#include <Box2D/Dynamics/b2QuerySnapshot.h>
 #include <Box2D/Dynamics/b2World.h>
+#include <Box2D/Dynamics/b2ShardedWorld.h>
+#include <Box2D/Dynamics/b2BatchRunner.h>
+#include <Box2D/Dynamics/b2Track.h>
 
 #include <Box2D/Dynamics/Contacts/b2Contact.h>
 
@@ -65,4 +73,6 @@ For discussion please visit http://box2d.org/forum
 #include <Box2D/Dynamics/Joints/b2WeldJoint.h>
 #include <Box2D/Dynamics/Joints/b2WheelJoint.h>
 
+#include <Box2D/Particle/b2ParticleSystem.h>
+
 #endif
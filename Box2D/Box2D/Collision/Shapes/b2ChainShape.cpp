@@ -94,9 +94,50 @@ b2Shape* b2ChainShape::Clone(b2BlockAllocator* allocator) const
 	clone->m_nextVertex = m_nextVertex;
 	clone->m_hasPrevVertex = m_hasPrevVertex;
 	clone->m_hasNextVertex = m_hasNextVertex;
+
+	clone->m_tree.Copy(m_tree);
+
 	return clone;
 }
 
+void b2ChainShape::BuildTree()
+{
+	b2Assert(m_count >= 2);
+
+	int32 edgeCount = m_count - 1;
+	b2AABB* aabbs = (b2AABB*)b2Alloc(edgeCount * sizeof(b2AABB));
+
+	b2Transform identity;
+	identity.SetIdentity();
+	for (int32 i = 0; i < edgeCount; ++i)
+	{
+		ComputeAABB(aabbs + i, identity, i);
+	}
+
+	m_tree.Build(aabbs, edgeCount);
+	b2Free(aabbs);
+}
+
+bool b2ChainShape::HasChildQuery() const
+{
+	return m_tree.IsBuilt();
+}
+
+void b2ChainShape::QueryChildren(b2ChildQueryCallback* callback, const b2AABB& aabb) const
+{
+	m_tree.QueryChildren(callback, aabb);
+}
+
+void b2ChainShape::ComputeChildrenAABB(b2AABB* aabb, const b2Transform& xf) const
+{
+	m_tree.ComputeAABB(aabb, xf);
+}
+
+void b2ChainShape::RayCastChildren(b2ChildRayCastCallback* callback, const b2RayCastInput& input) const
+{
+	m_tree.RayCastChildren(callback, input);
+}
+
 int32 b2ChainShape::GetChildCount() const
 {
 	// edge count = vertex count - 1
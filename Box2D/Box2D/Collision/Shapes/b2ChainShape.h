@@ -20,6 +20,7 @@
 #define B2_CHAIN_SHAPE_H
 
 #include <Box2D/Collision/Shapes/b2Shape.h>
+#include <Box2D/Collision/b2StaticTree.h>
 
 class b2EdgeShape;
 
@@ -55,6 +56,29 @@ public:
 	/// Don't call this for loops.
 	void SetNextVertex(const b2Vec2& nextVertex);
 
+	/// Build a static bounding volume tree over the edges. A fixture using this
+	/// chain then has a single broad-phase proxy for the whole chain, and finds
+	/// the edges near other shapes with this tree. Use this for large level outlines.
+	/// Call this after creating the chain.
+	/// WARNING: The chain must be attached to a static body. Moving a chain with a
+	/// tree can miss contacts.
+	void BuildTree();
+
+	/// Does this chain have an edge tree?
+	bool HasTree() const { return m_tree.IsBuilt(); }
+
+	/// @see b2Shape::HasChildQuery
+	bool HasChildQuery() const;
+
+	/// @see b2Shape::QueryChildren
+	void QueryChildren(b2ChildQueryCallback* callback, const b2AABB& aabb) const;
+
+	/// @see b2Shape::ComputeChildrenAABB
+	void ComputeChildrenAABB(b2AABB* aabb, const b2Transform& xf) const;
+
+	/// @see b2Shape::RayCastChildren
+	void RayCastChildren(b2ChildRayCastCallback* callback, const b2RayCastInput& input) const;
+
 	/// Implement b2Shape. Vertices are cloned using b2Alloc.
 	b2Shape* Clone(b2BlockAllocator* allocator) const;
 
@@ -87,6 +111,9 @@ public:
 
 	b2Vec2 m_prevVertex, m_nextVertex;
 	bool m_hasPrevVertex, m_hasNextVertex;
+
+	/// The edge tree, empty unless built.
+	b2StaticTree m_tree;
 };
 
 inline b2ChainShape::b2ChainShape()
@@ -0,0 +1,225 @@
+/*
+* Copyright (c) 2006-2009 Erin Catto http://www.box2d.org
+*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include <Box2D/Collision/Shapes/b2CompoundShape.h>
+#include <Box2D/Collision/Shapes/b2PolygonShape.h>
+#include <new>
+#include <memory.h>
+
+b2CompoundShape::~b2CompoundShape()
+{
+	b2Free(m_children);
+	b2Free(m_vertices);
+	b2Free(m_normals);
+	m_children = NULL;
+	m_vertices = NULL;
+	m_normals = NULL;
+	m_childCount = 0;
+	m_vertexCount = 0;
+}
+
+void b2CompoundShape::Create(const b2PolygonShape* polygons, int32 count)
+{
+	b2Assert(m_children == NULL && m_childCount == 0);
+	b2Assert(count >= 1);
+
+	m_vertexCount = 0;
+	for (int32 i = 0; i < count; ++i)
+	{
+		b2Assert(polygons[i].m_count >= 3);
+		m_vertexCount += polygons[i].m_count;
+	}
+
+	m_childCount = count;
+	m_children = (b2CompoundChild*)b2Alloc(m_childCount * sizeof(b2CompoundChild));
+	m_vertices = (b2Vec2*)b2Alloc(m_vertexCount * sizeof(b2Vec2));
+	m_normals = (b2Vec2*)b2Alloc(m_vertexCount * sizeof(b2Vec2));
+
+	b2AABB* aabbs = (b2AABB*)b2Alloc(m_childCount * sizeof(b2AABB));
+	b2Transform identity;
+	identity.SetIdentity();
+
+	int32 firstVertex = 0;
+	for (int32 i = 0; i < count; ++i)
+	{
+		const b2PolygonShape* polygon = polygons + i;
+		b2CompoundChild* child = m_children + i;
+		child->centroid = polygon->m_centroid;
+		child->firstVertex = firstVertex;
+		child->count = polygon->m_count;
+
+		memcpy(m_vertices + firstVertex, polygon->m_vertices, polygon->m_count * sizeof(b2Vec2));
+		memcpy(m_normals + firstVertex, polygon->m_normals, polygon->m_count * sizeof(b2Vec2));
+		firstVertex += polygon->m_count;
+
+		ComputeAABB(aabbs + i, identity, i);
+	}
+
+	m_tree.Build(aabbs, m_childCount);
+	b2Free(aabbs);
+}
+
+b2Shape* b2CompoundShape::Clone(b2BlockAllocator* allocator) const
+{
+	void* mem = allocator->Allocate(sizeof(b2CompoundShape));
+	b2CompoundShape* clone = new (mem) b2CompoundShape;
+	clone->m_radius = m_radius;
+	clone->m_childCount = m_childCount;
+	clone->m_vertexCount = m_vertexCount;
+	clone->m_children = (b2CompoundChild*)b2Alloc(m_childCount * sizeof(b2CompoundChild));
+	clone->m_vertices = (b2Vec2*)b2Alloc(m_vertexCount * sizeof(b2Vec2));
+	clone->m_normals = (b2Vec2*)b2Alloc(m_vertexCount * sizeof(b2Vec2));
+	memcpy(clone->m_children, m_children, m_childCount * sizeof(b2CompoundChild));
+	memcpy(clone->m_vertices, m_vertices, m_vertexCount * sizeof(b2Vec2));
+	memcpy(clone->m_normals, m_normals, m_vertexCount * sizeof(b2Vec2));
+	clone->m_tree.Copy(m_tree);
+	return clone;
+}
+
+int32 b2CompoundShape::GetChildCount() const
+{
+	return m_childCount;
+}
+
+bool b2CompoundShape::HasChildQuery() const
+{
+	return true;
+}
+
+void b2CompoundShape::QueryChildren(b2ChildQueryCallback* callback, const b2AABB& aabb) const
+{
+	m_tree.QueryChildren(callback, aabb);
+}
+
+void b2CompoundShape::ComputeChildrenAABB(b2AABB* aabb, const b2Transform& xf) const
+{
+	m_tree.ComputeAABB(aabb, xf);
+}
+
+void b2CompoundShape::RayCastChildren(b2ChildRayCastCallback* callback, const b2RayCastInput& input) const
+{
+	m_tree.RayCastChildren(callback, input);
+}
+
+void b2CompoundShape::GetChildPolygon(b2PolygonShape* polygon, int32 index) const
+{
+	b2Assert(0 <= index && index < m_childCount);
+	const b2CompoundChild* child = m_children + index;
+
+	polygon->m_type = b2Shape::e_polygon;
+	polygon->m_radius = m_radius;
+	polygon->m_centroid = child->centroid;
+	polygon->m_count = child->count;
+	memcpy(polygon->m_vertices, m_vertices + child->firstVertex, child->count * sizeof(b2Vec2));
+	memcpy(polygon->m_normals, m_normals + child->firstVertex, child->count * sizeof(b2Vec2));
+}
+
+// Tests a point against the polygons near it.
+struct b2CompoundPointCallback
+{
+	bool QueryCallback(int32 childIndex)
+	{
+		const b2CompoundChild* child = compound->m_children + childIndex;
+		const b2Vec2* vertices = compound->m_vertices + child->firstVertex;
+		const b2Vec2* normals = compound->m_normals + child->firstVertex;
+
+		for (int32 i = 0; i < child->count; ++i)
+		{
+			if (b2Dot(normals[i], point - vertices[i]) > 0.0f)
+			{
+				return true;
+			}
+		}
+
+		inside = true;
+		return false;
+	}
+
+	const b2CompoundShape* compound;
+	b2Vec2 point;
+	bool inside;
+};
+
+bool b2CompoundShape::TestPoint(const b2Transform& xf, const b2Vec2& p) const
+{
+	b2CompoundPointCallback callback;
+	callback.compound = this;
+	callback.point = b2MulT(xf, p);
+	callback.inside = false;
+
+	b2AABB aabb;
+	aabb.lowerBound = callback.point;
+	aabb.upperBound = callback.point;
+	m_tree.Query(&callback, aabb);
+
+	return callback.inside;
+}
+
+bool b2CompoundShape::RayCast(b2RayCastOutput* output, const b2RayCastInput& input,
+							  const b2Transform& xf, int32 childIndex) const
+{
+	b2PolygonShape polygon;
+	GetChildPolygon(&polygon, childIndex);
+	return polygon.RayCast(output, input, xf, 0);
+}
+
+void b2CompoundShape::ComputeAABB(b2AABB* aabb, const b2Transform& xf, int32 childIndex) const
+{
+	b2Assert(0 <= childIndex && childIndex < m_childCount);
+	const b2CompoundChild* child = m_children + childIndex;
+	const b2Vec2* vertices = m_vertices + child->firstVertex;
+
+	b2Vec2 lower = b2Mul(xf, vertices[0]);
+	b2Vec2 upper = lower;
+
+	for (int32 i = 1; i < child->count; ++i)
+	{
+		b2Vec2 v = b2Mul(xf, vertices[i]);
+		lower = b2Min(lower, v);
+		upper = b2Max(upper, v);
+	}
+
+	b2Vec2 r(m_radius, m_radius);
+	aabb->lowerBound = lower - r;
+	aabb->upperBound = upper + r;
+}
+
+void b2CompoundShape::ComputeMass(b2MassData* massData, float32 density) const
+{
+	// The polygon mass data is relative to the shape origin, so it adds up.
+	massData->mass = 0.0f;
+	massData->center.SetZero();
+	massData->I = 0.0f;
+
+	b2PolygonShape polygon;
+	for (int32 i = 0; i < m_childCount; ++i)
+	{
+		GetChildPolygon(&polygon, i);
+
+		b2MassData childData;
+		polygon.ComputeMass(&childData, density);
+		massData->mass += childData.mass;
+		massData->center += childData.mass * childData.center;
+		massData->I += childData.I;
+	}
+
+	if (massData->mass > 0.0f)
+	{
+		massData->center *= 1.0f / massData->mass;
+	}
+}
@@ -0,0 +1,114 @@
+/*
+* Copyright (c) 2006-2009 Erin Catto http://www.box2d.org
+*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#ifndef B2_COMPOUND_SHAPE_H
+#define B2_COMPOUND_SHAPE_H
+
+#include <Box2D/Collision/Shapes/b2Shape.h>
+#include <Box2D/Collision/b2StaticTree.h>
+
+class b2PolygonShape;
+
+/// A child polygon of a compound shape. Its vertices and normals are stored in
+/// the arrays of the compound shape.
+struct b2CompoundChild
+{
+	b2Vec2 centroid;
+	int32 firstVertex;
+	int32 count;
+};
+
+/// A compound shape is a set of convex polygons, such as the level art of a
+/// static body. The polygons share one vertex array and are kept in a static
+/// tree, so a fixture with a compound shape has a single broad-phase proxy.
+/// Each polygon is a child shape that collides like a b2PolygonShape.
+/// Since there may be many polygons, the data is allocated using b2Alloc.
+/// WARNING: A compound shape must be attached to a static body. Moving it can
+/// miss contacts.
+class b2CompoundShape : public b2Shape
+{
+public:
+	b2CompoundShape();
+
+	/// The destructor frees the polygons using b2Free.
+	~b2CompoundShape();
+
+	/// Create the compound from polygons and build the tree.
+	/// @param polygons an array of polygons, these are copied
+	/// @param count the polygon count
+	void Create(const b2PolygonShape* polygons, int32 count);
+
+	/// Implement b2Shape. Polygons are cloned using b2Alloc.
+	b2Shape* Clone(b2BlockAllocator* allocator) const;
+
+	/// @see b2Shape::GetChildCount
+	int32 GetChildCount() const;
+
+	/// @see b2Shape::HasChildQuery
+	bool HasChildQuery() const;
+
+	/// @see b2Shape::QueryChildren
+	void QueryChildren(b2ChildQueryCallback* callback, const b2AABB& aabb) const;
+
+	/// @see b2Shape::ComputeChildrenAABB
+	void ComputeChildrenAABB(b2AABB* aabb, const b2Transform& xf) const;
+
+	/// @see b2Shape::RayCastChildren
+	void RayCastChildren(b2ChildRayCastCallback* callback, const b2RayCastInput& input) const;
+
+	/// Get a child polygon.
+	void GetChildPolygon(b2PolygonShape* polygon, int32 index) const;
+
+	/// @see b2Shape::TestPoint
+	bool TestPoint(const b2Transform& transform, const b2Vec2& p) const;
+
+	/// Implement b2Shape.
+	bool RayCast(b2RayCastOutput* output, const b2RayCastInput& input,
+					const b2Transform& transform, int32 childIndex) const;
+
+	/// @see b2Shape::ComputeAABB
+	void ComputeAABB(b2AABB* aabb, const b2Transform& transform, int32 childIndex) const;
+
+	/// @see b2Shape::ComputeMass
+	void ComputeMass(b2MassData* massData, float32 density) const;
+
+	/// The polygons. Owned by this class.
+	b2CompoundChild* m_children;
+	int32 m_childCount;
+
+	/// The vertices and normals of all polygons. Owned by this class.
+	b2Vec2* m_vertices;
+	b2Vec2* m_normals;
+	int32 m_vertexCount;
+
+	/// The tree over the polygons.
+	b2StaticTree m_tree;
+};
+
+inline b2CompoundShape::b2CompoundShape()
+{
+	m_type = e_compound;
+	m_radius = b2_polygonRadius;
+	m_children = NULL;
+	m_childCount = 0;
+	m_vertices = NULL;
+	m_normals = NULL;
+	m_vertexCount = 0;
+}
+
+#endif
@@ -0,0 +1,258 @@
+/*
+* Copyright (c) 2006-2009 Erin Catto http://www.box2d.org
+*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+
+#include <Box2D/Collision/Shapes/b2HeightFieldShape.h>
+#include <Box2D/Collision/Shapes/b2EdgeShape.h>
+#include <new>
+#include <memory.h>
+#include <math.h>
+
+b2HeightFieldShape::~b2HeightFieldShape()
+{
+	b2Free(m_heights);
+	m_heights = NULL;
+	m_count = 0;
+}
+
+void b2HeightFieldShape::Create(const float32* heights, int32 count, float32 cellWidth)
+{
+	b2Assert(m_heights == NULL && m_count == 0);
+	b2Assert(count >= 2);
+	b2Assert(cellWidth > b2_linearSlop);
+
+	m_count = count;
+	m_cellWidth = cellWidth;
+	m_heights = (float32*)b2Alloc(count * sizeof(float32));
+	memcpy(m_heights, heights, count * sizeof(float32));
+
+	m_minHeight = heights[0];
+	m_maxHeight = heights[0];
+	for (int32 i = 1; i < count; ++i)
+	{
+		m_minHeight = b2Min(m_minHeight, heights[i]);
+		m_maxHeight = b2Max(m_maxHeight, heights[i]);
+	}
+}
+
+b2Shape* b2HeightFieldShape::Clone(b2BlockAllocator* allocator) const
+{
+	void* mem = allocator->Allocate(sizeof(b2HeightFieldShape));
+	b2HeightFieldShape* clone = new (mem) b2HeightFieldShape;
+	clone->Create(m_heights, m_count, m_cellWidth);
+	return clone;
+}
+
+int32 b2HeightFieldShape::GetChildCount() const
+{
+	// cell count = sample count - 1
+	return m_count - 1;
+}
+
+void b2HeightFieldShape::GetChildEdge(b2EdgeShape* edge, int32 index) const
+{
+	b2Assert(0 <= index && index < m_count - 1);
+	edge->m_type = b2Shape::e_edge;
+	edge->m_radius = m_radius;
+
+	edge->m_vertex1 = GetVertex(index + 0);
+	edge->m_vertex2 = GetVertex(index + 1);
+
+	if (index > 0)
+	{
+		edge->m_vertex0 = GetVertex(index - 1);
+		edge->m_hasVertex0 = true;
+	}
+	else
+	{
+		edge->m_vertex0.SetZero();
+		edge->m_hasVertex0 = false;
+	}
+
+	if (index < m_count - 2)
+	{
+		edge->m_vertex3 = GetVertex(index + 2);
+		edge->m_hasVertex3 = true;
+	}
+	else
+	{
+		edge->m_vertex3.SetZero();
+		edge->m_hasVertex3 = false;
+	}
+}
+
+bool b2HeightFieldShape::HasChildQuery() const
+{
+	return true;
+}
+
+void b2HeightFieldShape::QueryChildren(b2ChildQueryCallback* callback, const b2AABB& aabb) const
+{
+	int32 cellCount = m_count - 1;
+	float32 inverseWidth = 1.0f / m_cellWidth;
+
+	// Clamp before converting so that far away boxes can't overflow the index.
+	float32 lower = aabb.lowerBound.x * inverseWidth;
+	float32 upper = aabb.upperBound.x * inverseWidth;
+	if (upper < 0.0f || lower > float32(cellCount))
+	{
+		return;
+	}
+
+	int32 first = int32(floorf(b2Max(lower, 0.0f)));
+	int32 last = int32(floorf(b2Min(upper, float32(cellCount - 1))));
+
+	for (int32 i = first; i <= last; ++i)
+	{
+		float32 h1 = m_heights[i];
+		float32 h2 = m_heights[i + 1];
+		if (b2Min(h1, h2) > aabb.upperBound.y || b2Max(h1, h2) < aabb.lowerBound.y)
+		{
+			continue;
+		}
+
+		bool proceed = callback->ReportChild(i);
+		if (proceed == false)
+		{
+			return;
+		}
+	}
+}
+
+void b2HeightFieldShape::ComputeChildrenAABB(b2AABB* aabb, const b2Transform& xf) const
+{
+	b2AABB local;
+	local.lowerBound.Set(0.0f, m_minHeight);
+	local.upperBound.Set((m_count - 1) * m_cellWidth, m_maxHeight);
+
+	// Rotate the extents of the local AABB.
+	b2Vec2 c = b2Mul(xf, local.GetCenter());
+	b2Vec2 h = local.GetExtents();
+	b2Vec2 r;
+	r.x = b2Abs(xf.q.c) * h.x + b2Abs(xf.q.s) * h.y;
+	r.y = b2Abs(xf.q.s) * h.x + b2Abs(xf.q.c) * h.y;
+
+	aabb->lowerBound = c - r;
+	aabb->upperBound = c + r;
+}
+
+// Clip the ray parameter range to a slab. Returns false if the range is empty.
+static bool b2ClipToSlab(float32* tmin, float32* tmax, float32 p, float32 d, float32 lower, float32 upper)
+{
+	if (b2Abs(d) < b2_epsilon)
+	{
+		return lower <= p && p <= upper;
+	}
+
+	float32 inv_d = 1.0f / d;
+	float32 t1 = (lower - p) * inv_d;
+	float32 t2 = (upper - p) * inv_d;
+	if (t1 > t2)
+	{
+		b2Swap(t1, t2);
+	}
+
+	*tmin = b2Max(*tmin, t1);
+	*tmax = b2Min(*tmax, t2);
+	return *tmin <= *tmax;
+}
+
+void b2HeightFieldShape::RayCastChildren(b2ChildRayCastCallback* callback, const b2RayCastInput& input) const
+{
+	b2Vec2 p = input.p1;
+	b2Vec2 d = input.p2 - input.p1;
+	int32 cellCount = m_count - 1;
+
+	// Only the part of the ray inside the bounds of the samples can hit.
+	float32 tmin = 0.0f;
+	float32 tmax = input.maxFraction;
+	if (b2ClipToSlab(&tmin, &tmax, p.x, d.x, 0.0f, cellCount * m_cellWidth) == false ||
+		b2ClipToSlab(&tmin, &tmax, p.y, d.y, m_minHeight, m_maxHeight) == false)
+	{
+		return;
+	}
+
+	// The ray parameter grows with x in the direction of the ray, so the cells
+	// are reported in the order they are crossed and a clipped ray ends early.
+	// One more cell is visited at each end for round-off.
+	float32 inverseWidth = 1.0f / m_cellWidth;
+	int32 step = d.x >= 0.0f ? 1 : -1;
+	int32 first = int32(floorf((p.x + tmin * d.x) * inverseWidth)) - step;
+	int32 last = int32(floorf((p.x + tmax * d.x) * inverseWidth)) + step;
+	first = b2Clamp(first, 0, cellCount - 1);
+	last = b2Clamp(last, 0, cellCount - 1);
+
+	b2RayCastInput cellInput = input;
+	for (int32 i = first; (last - i) * step >= 0; i += step)
+	{
+		float32 value = callback->ReportChild(cellInput, i);
+
+		if (value == 0.0f)
+		{
+			// The client has terminated the ray cast.
+			return;
+		}
+
+		if (value > 0.0f)
+		{
+			cellInput.maxFraction = value;
+			tmax = b2Min(tmax, value);
+			last = int32(floorf((p.x + tmax * d.x) * inverseWidth)) + step;
+			last = b2Clamp(last, 0, cellCount - 1);
+		}
+	}
+}
+
+bool b2HeightFieldShape::TestPoint(const b2Transform& xf, const b2Vec2& p) const
+{
+	B2_NOT_USED(xf);
+	B2_NOT_USED(p);
+	return false;
+}
+
+bool b2HeightFieldShape::RayCast(b2RayCastOutput* output, const b2RayCastInput& input,
+								 const b2Transform& xf, int32 childIndex) const
+{
+	b2Assert(0 <= childIndex && childIndex < m_count - 1);
+
+	b2EdgeShape edgeShape;
+	edgeShape.m_vertex1 = GetVertex(childIndex);
+	edgeShape.m_vertex2 = GetVertex(childIndex + 1);
+
+	return edgeShape.RayCast(output, input, xf, 0);
+}
+
+void b2HeightFieldShape::ComputeAABB(b2AABB* aabb, const b2Transform& xf, int32 childIndex) const
+{
+	b2Assert(0 <= childIndex && childIndex < m_count - 1);
+
+	b2Vec2 v1 = b2Mul(xf, GetVertex(childIndex));
+	b2Vec2 v2 = b2Mul(xf, GetVertex(childIndex + 1));
+
+	aabb->lowerBound = b2Min(v1, v2);
+	aabb->upperBound = b2Max(v1, v2);
+}
+
+void b2HeightFieldShape::ComputeMass(b2MassData* massData, float32 density) const
+{
+	B2_NOT_USED(density);
+
+	massData->mass = 0.0f;
+	massData->center.SetZero();
+	massData->I = 0.0f;
+}
@@ -0,0 +1,122 @@
+/*
+* Copyright (c) 2006-2009 Erin Catto http://www.box2d.org
+*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+
+#ifndef B2_HEIGHT_FIELD_SHAPE_H
+#define B2_HEIGHT_FIELD_SHAPE_H
+
+#include <Box2D/Collision/Shapes/b2Shape.h>
+
+class b2EdgeShape;
+
+/// A height field is a terrain surface given by heights sampled at a uniform
+/// spacing along the x-axis of the shape. Sample i is at (i * cellWidth, heights[i]).
+/// Each cell between two samples is a child edge that collides like an edge of
+/// a chain, including smooth collision across cells. The cells near a shape are
+/// found directly from its x-range, so no tree is needed and only one float is
+/// stored per sample. A fixture with a height field has a single broad-phase proxy.
+/// Since there may be many samples, they are allocated using b2Alloc.
+/// WARNING: A height field must be attached to a static body. Moving it can miss
+/// contacts.
+class b2HeightFieldShape : public b2Shape
+{
+public:
+	b2HeightFieldShape();
+
+	/// The destructor frees the heights using b2Free.
+	~b2HeightFieldShape();
+
+	/// Create the height field.
+	/// @param heights an array of heights, these are copied
+	/// @param count the sample count, at least 2
+	/// @param cellWidth the distance between samples along the x-axis
+	void Create(const float32* heights, int32 count, float32 cellWidth);
+
+	/// Implement b2Shape. Heights are cloned using b2Alloc.
+	b2Shape* Clone(b2BlockAllocator* allocator) const;
+
+	/// @see b2Shape::GetChildCount
+	int32 GetChildCount() const;
+
+	/// Get the vertex of a sample in the frame of the shape.
+	b2Vec2 GetVertex(int32 index) const;
+
+	/// Get a child edge.
+	void GetChildEdge(b2EdgeShape* edge, int32 index) const;
+
+	/// @see b2Shape::HasChildQuery
+	bool HasChildQuery() const;
+
+	/// Report the cells whose edges may overlap the AABB. The cells are found
+	/// from the x-range of the AABB in constant time.
+	/// @see b2Shape::QueryChildren
+	void QueryChildren(b2ChildQueryCallback* callback, const b2AABB& aabb) const;
+
+	/// @see b2Shape::ComputeChildrenAABB
+	void ComputeChildrenAABB(b2AABB* aabb, const b2Transform& xf) const;
+
+	/// Walk the cells crossed by the ray in order, so the first hit is the closest.
+	/// @see b2Shape::RayCastChildren
+	void RayCastChildren(b2ChildRayCastCallback* callback, const b2RayCastInput& input) const;
+
+	/// This always return false.
+	/// @see b2Shape::TestPoint
+	bool TestPoint(const b2Transform& transform, const b2Vec2& p) const;
+
+	/// Implement b2Shape.
+	bool RayCast(b2RayCastOutput* output, const b2RayCastInput& input,
+					const b2Transform& transform, int32 childIndex) const;
+
+	/// @see b2Shape::ComputeAABB
+	void ComputeAABB(b2AABB* aabb, const b2Transform& transform, int32 childIndex) const;
+
+	/// Height fields have zero mass.
+	/// @see b2Shape::ComputeMass
+	void ComputeMass(b2MassData* massData, float32 density) const;
+
+	/// The heights. Owned by this class.
+	float32* m_heights;
+
+	/// The sample count.
+	int32 m_count;
+
+	/// The distance between samples.
+	float32 m_cellWidth;
+
+	/// The height range of all samples.
+	float32 m_minHeight, m_maxHeight;
+};
+
+inline b2HeightFieldShape::b2HeightFieldShape()
+{
+	m_type = e_heightField;
+	m_radius = b2_polygonRadius;
+	m_heights = NULL;
+	m_count = 0;
+	m_cellWidth = 1.0f;
+	m_minHeight = 0.0f;
+	m_maxHeight = 0.0f;
+}
+
+inline b2Vec2 b2HeightFieldShape::GetVertex(int32 index) const
+{
+	b2Assert(0 <= index && index < m_count);
+	return b2Vec2(index * m_cellWidth, m_heights[index]);
+}
+
+#endif
@@ -36,6 +36,34 @@ struct b2MassData
 	float32 I;
 };
 
+/// Callback class for shapes that find their own children.
+/// @see b2Shape::QueryChildren
+class b2ChildQueryCallback
+{
+public:
+	virtual ~b2ChildQueryCallback() {}
+
+	/// Called for each child that may overlap the query AABB.
+	/// @return false to terminate the query.
+	virtual bool ReportChild(int32 childIndex) = 0;
+};
+
+/// Callback class for shapes that find the children hit by a ray themselves.
+/// @see b2Shape::RayCastChildren
+class b2ChildRayCastCallback
+{
+public:
+	virtual ~b2ChildRayCastCallback() {}
+
+	/// Called for each child that the ray may hit. The callback casts the ray
+	/// against the child.
+	/// @param input the ray in the frame of the shape, clipped to the current max fraction.
+	/// @param childIndex the child that may be hit.
+	/// @return the new max fraction, 0 to terminate the ray cast or
+	/// input.maxFraction to continue unchanged.
+	virtual float32 ReportChild(const b2RayCastInput& input, int32 childIndex) = 0;
+};
+
 /// A shape is used for collision detection. You can create a shape however you like.
 /// Shapes used for simulation in b2World are created automatically when a b2Fixture
 /// is created. Shapes may encapsulate a one or more child shapes.
@@ -49,7 +77,10 @@ public:
 		e_edge = 1,
 		e_polygon = 2,
 		e_chain = 3,
-		e_typeCount = 4
+		e_compound = 4,
+		e_heightField = 5,
+		e_capsule = 6,
+		e_typeCount = 7
 	};
 
 	virtual ~b2Shape() {}
@@ -64,6 +95,42 @@ public:
 	/// Get the number of child primitives.
 	virtual int32 GetChildCount() const = 0;
 
+	/// Does this shape find the children near an AABB itself? A fixture of such a
+	/// shape uses one broad-phase proxy for all children and relies on the child
+	/// query functions below, which are only called if this returns true.
+	virtual bool HasChildQuery() const { return false; }
+
+	/// Report the children that may overlap an AABB.
+	/// @param callback receives the child indices.
+	/// @param aabb the query box in the frame of the shape.
+	virtual void QueryChildren(b2ChildQueryCallback* callback, const b2AABB& aabb) const
+	{
+		B2_NOT_USED(callback);
+		B2_NOT_USED(aabb);
+		b2Assert(false);
+	}
+
+	/// Compute an axis aligned bounding box that contains all children.
+	/// @param aabb returns the axis aligned box.
+	/// @param xf the world transform of the shape.
+	virtual void ComputeChildrenAABB(b2AABB* aabb, const b2Transform& xf) const
+	{
+		B2_NOT_USED(aabb);
+		B2_NOT_USED(xf);
+		b2Assert(false);
+	}
+
+	/// Report the children that a ray may hit. This only finds the candidates,
+	/// the callback casts the ray against each of them.
+	/// @param callback receives the child indices.
+	/// @param input the ray in the frame of the shape.
+	virtual void RayCastChildren(b2ChildRayCastCallback* callback, const b2RayCastInput& input) const
+	{
+		B2_NOT_USED(callback);
+		B2_NOT_USED(input);
+		b2Assert(false);
+	}
+
 	/// Test a point for containment in this shape. This only works for convex shapes.
 	/// @param xf the shape world transform.
 	/// @param p a point in world coordinates.
@@ -29,6 +29,8 @@ b2BroadPhase::b2BroadPhase()
 	m_moveCapacity = 16;
 	m_moveCount = 0;
 	m_moveBuffer = (int32*)b2Alloc(m_moveCapacity * sizeof(int32));
+
+	m_filterPairs = false;
 }
 
 b2BroadPhase::~b2BroadPhase()
@@ -37,14 +39,25 @@ b2BroadPhase::~b2BroadPhase()
 	b2Free(m_pairBuffer);
 }
 
-int32 b2BroadPhase::CreateProxy(const b2AABB& aabb, void* userData)
+int32 b2BroadPhase::CreateProxy(const b2AABB& aabb, void* userData, const b2Filter& filter)
 {
-	int32 proxyId = m_tree.CreateProxy(aabb, userData);
+	int32 proxyId = m_tree.CreateProxy(aabb, userData, filter);
 	++m_proxyCount;
 	BufferMove(proxyId);
 	return proxyId;
 }
 
+void b2BroadPhase::CreateProxies(int32* proxyIds, const b2AABB* aabbs, void* const* userData,
+								 const b2Filter* filters, int32 count)
+{
+	m_tree.CreateProxies(proxyIds, aabbs, userData, filters, count);
+	m_proxyCount += count;
+	for (int32 i = 0; i < count; ++i)
+	{
+		BufferMove(proxyIds[i]);
+	}
+}
+
 void b2BroadPhase::DestroyProxy(int32 proxyId)
 {
 	UnBufferMove(proxyId);
@@ -45,9 +45,13 @@ public:
 	b2BroadPhase();
 	~b2BroadPhase();
 
-	/// Create a proxy with an initial AABB. Pairs are not reported until
+	/// Create a proxy with an initial AABB and a filter. Pairs are not reported until
 	/// UpdatePairs is called.
-	int32 CreateProxy(const b2AABB& aabb, void* userData);
+	int32 CreateProxy(const b2AABB& aabb, void* userData, const b2Filter& filter);
+
+	/// Create many proxies at once. See b2DynamicTree::CreateProxies.
+	void CreateProxies(int32* proxyIds, const b2AABB* aabbs, void* const* userData,
+					   const b2Filter* filters, int32 count);
 
 	/// Destroy a proxy. It is up to the client to remove any pairs.
 	void DestroyProxy(int32 proxyId);
@@ -59,6 +63,14 @@ public:
 	/// Call to trigger a re-processing of it's pairs on the next call to UpdatePairs.
 	void TouchProxy(int32 proxyId);
 
+	/// Change the filter of a proxy. Touch the proxy to get the pairs it now accepts.
+	void SetFilter(int32 proxyId, const b2Filter& filter);
+
+	/// Only report the pairs whose filters pass b2ShouldCollide. The pairs are then
+	/// pruned in the tree, before they are buffered and sorted. Only enable this if
+	/// the client rejects these pairs anyway. Off by default.
+	void SetFilterPairs(bool flag);
+
 	/// Get the fat AABB for a proxy.
 	const b2AABB& GetFatAABB(int32 proxyId) const;
 
@@ -80,6 +92,11 @@ public:
 	template <typename T>
 	void Query(T* callback, const b2AABB& aabb) const;
 
+	/// Query an AABB for overlapping proxies whose filter passes b2ShouldCollide
+	/// with the given filter.
+	template <typename T>
+	void Query(T* callback, const b2AABB& aabb, const b2Filter& filter) const;
+
 	/// Ray-cast against the proxies in the tree. This relies on the callback
 	/// to perform a exact ray-cast in the case were the proxy contains a shape.
 	/// The callback also performs the any collision filtering. This has performance
@@ -90,6 +107,11 @@ public:
 	template <typename T>
 	void RayCast(T* callback, const b2RayCastInput& input) const;
 
+	/// Ray-cast against the proxies whose filter passes b2ShouldCollide with the
+	/// given filter.
+	template <typename T>
+	void RayCast(T* callback, const b2RayCastInput& input, const b2Filter& filter) const;
+
 	/// Get the height of the embedded tree.
 	int32 GetTreeHeight() const;
 
@@ -107,6 +129,7 @@ public:
 private:
 
 	friend class b2DynamicTree;
+	friend class b2QuerySnapshot;
 
 	void BufferMove(int32 proxyId);
 	void UnBufferMove(int32 proxyId);
@@ -126,6 +149,8 @@ private:
 	int32 m_pairCount;
 
 	int32 m_queryProxyId;
+
+	bool m_filterPairs;
 };
 
 /// This is used to sort pairs.
@@ -161,6 +186,16 @@ inline const b2AABB& b2BroadPhase::GetFatAABB(int32 proxyId) const
 	return m_tree.GetFatAABB(proxyId);
 }
 
+inline void b2BroadPhase::SetFilter(int32 proxyId, const b2Filter& filter)
+{
+	m_tree.SetFilter(proxyId, filter);
+}
+
+inline void b2BroadPhase::SetFilterPairs(bool flag)
+{
+	m_filterPairs = flag;
+}
+
 inline int32 b2BroadPhase::GetProxyCount() const
 {
 	return m_proxyCount;
@@ -201,7 +236,14 @@ void b2BroadPhase::UpdatePairs(T* callback)
 		const b2AABB& fatAABB = m_tree.GetFatAABB(m_queryProxyId);
 
 		// Query tree, create pairs and add them pair buffer.
-		m_tree.Query(this, fatAABB);
+		if (m_filterPairs)
+		{
+			m_tree.Query(this, fatAABB, m_tree.GetFilter(m_queryProxyId));
+		}
+		else
+		{
+			m_tree.Query(this, fatAABB);
+		}
 	}
 
 	// Reset move buffer
@@ -243,12 +285,24 @@ inline void b2BroadPhase::Query(T* callback, const b2AABB& aabb) const
 	m_tree.Query(callback, aabb);
 }
 
+template <typename T>
+inline void b2BroadPhase::Query(T* callback, const b2AABB& aabb, const b2Filter& filter) const
+{
+	m_tree.Query(callback, aabb, filter);
+}
+
 template <typename T>
 inline void b2BroadPhase::RayCast(T* callback, const b2RayCastInput& input) const
 {
 	m_tree.RayCast(callback, input);
 }
 
+template <typename T>
+inline void b2BroadPhase::RayCast(T* callback, const b2RayCastInput& input, const b2Filter& filter) const
+{
+	m_tree.RayCast(callback, input, filter);
+}
+
 inline void b2BroadPhase::ShiftOrigin(const b2Vec2& newOrigin)
 {
 	m_tree.ShiftOrigin(newOrigin);
@@ -0,0 +1,383 @@
+/*
+* Copyright (c) 2006-2009 Erin Catto http://www.box2d.org
+*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+
+#include <Box2D/Collision/b2Collision.h>
+#include <Box2D/Collision/Shapes/b2CapsuleShape.h>
+#include <Box2D/Collision/Shapes/b2CircleShape.h>
+#include <Box2D/Collision/Shapes/b2PolygonShape.h>
+
+// Compute the closest points between segments p1-q1 and p2-q2.
+// Real-Time Collision Detection by Christer Ericson, Section 5.1.9.
+static float32 b2ClosestPointsOnSegments(b2Vec2* c1, float32* f1, b2Vec2* c2, float32* f2,
+										 const b2Vec2& p1, const b2Vec2& q1,
+										 const b2Vec2& p2, const b2Vec2& q2)
+{
+	b2Vec2 d1 = q1 - p1;
+	b2Vec2 d2 = q2 - p2;
+	b2Vec2 r = p1 - p2;
+	float32 dd1 = b2Dot(d1, d1);
+	float32 dd2 = b2Dot(d2, d2);
+	float32 rd1 = b2Dot(r, d1);
+	float32 rd2 = b2Dot(r, d2);
+	float32 d12 = b2Dot(d1, d2);
+
+	// The segments are not degenerate, see b2CapsuleShape::Set.
+	float32 s = 0.0f;
+	float32 denominator = dd1 * dd2 - d12 * d12;
+	if (denominator > 0.0f)
+	{
+		s = b2Clamp((d12 * rd2 - rd1 * dd2) / denominator, 0.0f, 1.0f);
+	}
+
+	float32 t = (d12 * s + rd2) / dd2;
+	if (t < 0.0f)
+	{
+		t = 0.0f;
+		s = b2Clamp(-rd1 / dd1, 0.0f, 1.0f);
+	}
+	else if (t > 1.0f)
+	{
+		t = 1.0f;
+		s = b2Clamp((d12 - rd1) / dd1, 0.0f, 1.0f);
+	}
+
+	*f1 = s;
+	*f2 = t;
+	*c1 = p1 + s * d1;
+	*c2 = p2 + t * d2;
+	return b2DistanceSquared(*c1, *c2);
+}
+
+void b2CollideCapsuleAndCircle(
+	b2Manifold* manifold,
+	const b2CapsuleShape* capsuleA, const b2Transform& xfA,
+	const b2CircleShape* circleB, const b2Transform& xfB)
+{
+	manifold->pointCount = 0;
+
+	// Compute circle in frame of capsule
+	b2Vec2 Q = b2MulT(xfA, b2Mul(xfB, circleB->m_p));
+
+	b2Vec2 A = capsuleA->m_vertex1, B = capsuleA->m_vertex2;
+	b2Vec2 e = B - A;
+
+	// Barycentric coordinates
+	float32 u = b2Dot(e, B - Q);
+	float32 v = b2Dot(e, Q - A);
+
+	float32 radius = capsuleA->m_radius + circleB->m_radius;
+
+	b2ContactFeature cf;
+	cf.indexB = 0;
+	cf.typeB = b2ContactFeature::e_vertex;
+
+	// Region A or B
+	if (v <= 0.0f || u <= 0.0f)
+	{
+		b2Vec2 P = v <= 0.0f ? A : B;
+		if (b2DistanceSquared(Q, P) > radius * radius)
+		{
+			return;
+		}
+
+		cf.indexA = v <= 0.0f ? 0 : 1;
+		cf.typeA = b2ContactFeature::e_vertex;
+		manifold->pointCount = 1;
+		manifold->type = b2Manifold::e_circles;
+		manifold->localNormal.SetZero();
+		manifold->localPoint = P;
+		manifold->points[0].id.key = 0;
+		manifold->points[0].id.cf = cf;
+		manifold->points[0].localPoint = circleB->m_p;
+		return;
+	}
+
+	// Region AB
+	b2Vec2 n(-e.y, e.x);
+	if (b2Dot(n, Q - A) < 0.0f)
+	{
+		n.Set(-n.x, -n.y);
+	}
+	n.Normalize();
+
+	if (b2Dot(n, Q - A) > radius)
+	{
+		return;
+	}
+
+	cf.indexA = 0;
+	cf.typeA = b2ContactFeature::e_face;
+	manifold->pointCount = 1;
+	manifold->type = b2Manifold::e_faceA;
+	manifold->localNormal = n;
+	manifold->localPoint = A;
+	manifold->points[0].id.key = 0;
+	manifold->points[0].id.cf = cf;
+	manifold->points[0].localPoint = circleB->m_p;
+}
+
+// Collide the segment of a capsule with a convex polygon in the frame of the
+// polygon. The polygon may have two vertices, which makes it a capsule. This
+// follows b2CollidePolygons, but rounded ends and corners get one point along
+// the line between them instead of being clipped against a face.
+static void b2CollideSegmentAndPolygon(b2Manifold* manifold,
+									   const b2CapsuleShape* capsuleA, const b2Transform& xf,
+									   const b2Vec2* vertices, const b2Vec2* normals, int32 count,
+									   float32 totalRadius)
+{
+	manifold->pointCount = 0;
+
+	b2Vec2 p = b2Mul(xf, capsuleA->m_vertex1);
+	b2Vec2 q = b2Mul(xf, capsuleA->m_vertex2);
+
+	// Find the polygon face with the largest separation from the segment.
+	int32 edgeB = 0;
+	float32 separationB = -b2_maxFloat;
+	for (int32 i = 0; i < count; ++i)
+	{
+		float32 si = b2Min(b2Dot(normals[i], p - vertices[i]), b2Dot(normals[i], q - vertices[i]));
+		if (si > separationB)
+		{
+			separationB = si;
+			edgeB = i;
+		}
+	}
+
+	if (separationB > totalRadius)
+	{
+		return;
+	}
+
+	// Find the separation along the segment normal, facing the polygon.
+	b2Vec2 normalA = b2Cross(q - p, 1.0f);
+	normalA.Normalize();
+
+	float32 front = b2_maxFloat;
+	float32 back = b2_maxFloat;
+	for (int32 i = 0; i < count; ++i)
+	{
+		float32 si = b2Dot(normalA, vertices[i] - p);
+		front = b2Min(front, si);
+		back = b2Min(back, -si);
+	}
+
+	float32 separationA = front;
+	if (back > front)
+	{
+		separationA = back;
+		normalA = -normalA;
+	}
+
+	if (separationA > totalRadius)
+	{
+		return;
+	}
+
+	// Use the face of the capsule unless the polygon face is clearly better.
+	const float32 k_tol = 0.1f * b2_linearSlop;
+	bool flip = separationB > separationA + k_tol;
+
+	// The reference face is v11-v12 and the incident edge is v21-v22.
+	b2Vec2 v11, v12, v21, v22, normal;
+	int32 i11, i12, i21, i22;
+	float32 separation;
+	if (flip)
+	{
+		i11 = edgeB;
+		i12 = edgeB + 1 < count ? edgeB + 1 : 0;
+		v11 = vertices[i11];
+		v12 = vertices[i12];
+		normal = normals[edgeB];
+		separation = separationB;
+
+		i21 = 0;
+		i22 = 1;
+		v21 = p;
+		v22 = q;
+	}
+	else
+	{
+		i11 = 0;
+		i12 = 1;
+		v11 = p;
+		v12 = q;
+		normal = normalA;
+		separation = separationA;
+
+		// The incident edge is the polygon edge most anti-parallel to the normal.
+		int32 index = 0;
+		float32 minDot = b2_maxFloat;
+		for (int32 i = 0; i < count; ++i)
+		{
+			float32 dot = b2Dot(normal, normals[i]);
+			if (dot < minDot)
+			{
+				minDot = dot;
+				index = i;
+			}
+		}
+
+		i21 = index;
+		i22 = index + 1 < count ? index + 1 : 0;
+		v21 = vertices[i21];
+		v22 = vertices[i22];
+	}
+
+	// If the cores are apart and the closest points are clearly further than the
+	// face separation, the contact is between rounded ends or corners. Any point
+	// on the core is the center of a rounding circle, so use the closest points.
+	if (separation > 0.1f * b2_linearSlop)
+	{
+		b2Vec2 c1, c2;
+		float32 f1, f2;
+		float32 distanceSquared = b2ClosestPointsOnSegments(&c1, &f1, &c2, &f2, v11, v12, v21, v22);
+		if (distanceSquared > totalRadius * totalRadius)
+		{
+			return;
+		}
+
+		float32 distance = b2Sqrt(distanceSquared);
+		if (distance > separation + b2_linearSlop)
+		{
+			b2Vec2 pointA = flip ? c2 : c1;
+			b2Vec2 pointB = flip ? c1 : c2;
+			float32 fractionA = flip ? f2 : f1;
+			float32 fractionB = flip ? f1 : f2;
+			int32 indexA = flip ? (fractionA < 0.5f ? i21 : i22) : (fractionA < 0.5f ? i11 : i12);
+			int32 indexB = flip ? (fractionB < 0.5f ? i11 : i12) : (fractionB < 0.5f ? i21 : i22);
+
+			manifold->pointCount = 1;
+			manifold->type = b2Manifold::e_circles;
+			manifold->localNormal.SetZero();
+			manifold->localPoint = b2MulT(xf, pointA);
+			manifold->points[0].localPoint = pointB;
+			manifold->points[0].id.key = 0;
+			manifold->points[0].id.cf.indexA = static_cast<uint8>(indexA);
+			manifold->points[0].id.cf.indexB = static_cast<uint8>(indexB);
+			manifold->points[0].id.cf.typeA = b2ContactFeature::e_vertex;
+			manifold->points[0].id.cf.typeB = b2ContactFeature::e_vertex;
+			return;
+		}
+	}
+
+	// Clip the incident edge to the sides of the reference face.
+	b2ClipVertex incident[2];
+	incident[0].v = v21;
+	incident[0].id.cf.indexA = static_cast<uint8>(i11);
+	incident[0].id.cf.indexB = static_cast<uint8>(i21);
+	incident[0].id.cf.typeA = b2ContactFeature::e_face;
+	incident[0].id.cf.typeB = b2ContactFeature::e_vertex;
+	incident[1].v = v22;
+	incident[1].id.cf.indexA = static_cast<uint8>(i11);
+	incident[1].id.cf.indexB = static_cast<uint8>(i22);
+	incident[1].id.cf.typeA = b2ContactFeature::e_face;
+	incident[1].id.cf.typeB = b2ContactFeature::e_vertex;
+
+	b2Vec2 tangent = b2Cross(normal, 1.0f);
+	if (b2Dot(tangent, v12 - v11) < 0.0f)
+	{
+		tangent = -tangent;
+	}
+
+	b2ClipVertex clipPoints1[2];
+	b2ClipVertex clipPoints2[2];
+	int32 np = b2ClipSegmentToLine(clipPoints1, incident, -tangent, -b2Dot(tangent, v11), i11);
+	if (np < 2)
+	{
+		return;
+	}
+
+	np = b2ClipSegmentToLine(clipPoints2, clipPoints1, tangent, b2Dot(tangent, v12), i12);
+	if (np < 2)
+	{
+		return;
+	}
+
+	if (flip)
+	{
+		manifold->type = b2Manifold::e_faceB;
+		manifold->localNormal = normal;
+		manifold->localPoint = v11;
+	}
+	else
+	{
+		manifold->type = b2Manifold::e_faceA;
+		manifold->localNormal = b2MulT(xf.q, normal);
+		manifold->localPoint = capsuleA->m_vertex1;
+	}
+
+	int32 pointCount = 0;
+	for (int32 i = 0; i < b2_maxManifoldPoints; ++i)
+	{
+		if (b2Dot(normal, clipPoints2[i].v - v11) > totalRadius)
+		{
+			continue;
+		}
+
+		b2ManifoldPoint* cp = manifold->points + pointCount;
+		cp->id = clipPoints2[i].id;
+		if (flip)
+		{
+			// The capsule is the incident shape.
+			cp->localPoint = b2MulT(xf, clipPoints2[i].v);
+			b2ContactFeature cf = cp->id.cf;
+			cp->id.cf.indexA = cf.indexB;
+			cp->id.cf.indexB = cf.indexA;
+			cp->id.cf.typeA = cf.typeB;
+			cp->id.cf.typeB = cf.typeA;
+		}
+		else
+		{
+			cp->localPoint = clipPoints2[i].v;
+		}
+		++pointCount;
+	}
+
+	manifold->pointCount = pointCount;
+}
+
+void b2CollideCapsules(
+	b2Manifold* manifold,
+	const b2CapsuleShape* capsuleA, const b2Transform& xfA,
+	const b2CapsuleShape* capsuleB, const b2Transform& xfB)
+{
+	// Capsule B is a polygon with two vertices and two opposite faces.
+	b2Vec2 vertices[2];
+	b2Vec2 normals[2];
+	vertices[0] = capsuleB->m_vertex1;
+	vertices[1] = capsuleB->m_vertex2;
+	normals[0] = b2Cross(vertices[1] - vertices[0], 1.0f);
+	normals[0].Normalize();
+	normals[1] = -normals[0];
+
+	b2Transform xf = b2MulT(xfB, xfA);
+	float32 totalRadius = capsuleA->m_radius + capsuleB->m_radius;
+	b2CollideSegmentAndPolygon(manifold, capsuleA, xf, vertices, normals, 2, totalRadius);
+}
+
+void b2CollideCapsuleAndPolygon(
+	b2Manifold* manifold,
+	const b2CapsuleShape* capsuleA, const b2Transform& xfA,
+	const b2PolygonShape* polygonB, const b2Transform& xfB)
+{
+	b2Transform xf = b2MulT(xfB, xfA);
+	float32 totalRadius = capsuleA->m_radius + polygonB->m_radius;
+	b2CollideSegmentAndPolygon(manifold, capsuleA, xf, polygonB->m_vertices, polygonB->m_normals,
+							   polygonB->m_count, totalRadius);
+}
@@ -21,9 +21,12 @@
 #include <Box2D/Collision/Shapes/b2EdgeShape.h>
 #include <Box2D/Collision/Shapes/b2ChainShape.h>
 #include <Box2D/Collision/Shapes/b2PolygonShape.h>
+#include <Box2D/Collision/Shapes/b2CompoundShape.h>
+#include <Box2D/Collision/Shapes/b2HeightFieldShape.h>
+#include <Box2D/Collision/Shapes/b2CapsuleShape.h>
 
 // GJK using Voronoi regions (Christer Ericson) and Barycentric coordinates.
-int32 b2_gjkCalls, b2_gjkIters, b2_gjkMaxIters;
+B2_THREAD_LOCAL int32 b2_gjkCalls, b2_gjkIters, b2_gjkMaxIters;
 
 void b2DistanceProxy::Set(const b2Shape* shape, int32 index)
 {
@@ -77,6 +80,41 @@ void b2DistanceProxy::Set(const b2Shape* shape, int32 index)
 		}
 		break;
 
+	case b2Shape::e_compound:
+		{
+			const b2CompoundShape* compound = static_cast<const b2CompoundShape*>(shape);
+			b2Assert(0 <= index && index < compound->m_childCount);
+
+			const b2CompoundChild* child = compound->m_children + index;
+			m_vertices = compound->m_vertices + child->firstVertex;
+			m_count = child->count;
+			m_radius = compound->m_radius;
+		}
+		break;
+
+	case b2Shape::e_capsule:
+		{
+			const b2CapsuleShape* capsule = static_cast<const b2CapsuleShape*>(shape);
+			m_vertices = &capsule->m_vertex1;
+			m_count = 2;
+			m_radius = capsule->m_radius;
+		}
+		break;
+
+	case b2Shape::e_heightField:
+		{
+			const b2HeightFieldShape* heightField = static_cast<const b2HeightFieldShape*>(shape);
+			b2Assert(0 <= index && index < heightField->m_count - 1);
+
+			m_buffer[0] = heightField->GetVertex(index);
+			m_buffer[1] = heightField->GetVertex(index + 1);
+
+			m_vertices = m_buffer;
+			m_count = 2;
+			m_radius = heightField->m_radius;
+		}
+		break;
+
 	default:
 		b2Assert(false);
 	}
@@ -90,6 +90,10 @@ void b2Distance(b2DistanceOutput* output,
 				b2SimplexCache* cache, 
 				const b2DistanceInput* input);
 
+/// GJK statistics. These count the calls made on the calling thread, so
+/// worlds stepped on separate threads don't share them.
+extern B2_THREAD_LOCAL int32 b2_gjkCalls, b2_gjkIters, b2_gjkMaxIters;
+
 
 //////////////////////////////////////////////////////////////////////////
 
@@ -18,6 +18,19 @@
 
 #include <Box2D/Collision/b2DynamicTree.h>
 #include <memory.h>
+#include <algorithm>
+
+// Orders proxies by the center of their AABB along one axis.
+struct b2ProxyCenterLess
+{
+	bool operator()(int32 a, int32 b) const
+	{
+		return centers[a](axis) < centers[b](axis);
+	}
+
+	const b2Vec2* centers;
+	int32 axis;
+};
 
 b2DynamicTree::b2DynamicTree()
 {
@@ -26,7 +39,10 @@ b2DynamicTree::b2DynamicTree()
 	m_nodeCapacity = 16;
 	m_nodeCount = 0;
 	m_nodes = (b2TreeNode*)b2Alloc(m_nodeCapacity * sizeof(b2TreeNode));
-	memset(m_nodes, 0, m_nodeCapacity * sizeof(b2TreeNode));
+	for (int32 i = 0; i < m_nodeCapacity; ++i)
+	{
+		m_nodes[i] = b2TreeNode();
+	}
 
 	// Build a linked list for the free list.
 	for (int32 i = 0; i < m_nodeCapacity - 1; ++i)
@@ -102,7 +118,7 @@ void b2DynamicTree::FreeNode(int32 nodeId)
 // Create a proxy in the tree as a leaf node. We return the index
 // of the node instead of a pointer so that we can grow
 // the node pool.
-int32 b2DynamicTree::CreateProxy(const b2AABB& aabb, void* userData)
+int32 b2DynamicTree::CreateProxy(const b2AABB& aabb, void* userData, const b2Filter& filter)
 {
 	int32 proxyId = AllocateNode();
 
@@ -112,12 +128,87 @@ int32 b2DynamicTree::CreateProxy(const b2AABB& aabb, void* userData)
 	m_nodes[proxyId].aabb.upperBound = aabb.upperBound + r;
 	m_nodes[proxyId].userData = userData;
 	m_nodes[proxyId].height = 0;
+	m_nodes[proxyId].filter = filter;
 
 	InsertLeaf(proxyId);
 
 	return proxyId;
 }
 
+void b2DynamicTree::CreateProxies(int32* proxyIds, const b2AABB* aabbs, void* const* userData,
+								 const b2Filter* filters, int32 count)
+{
+	if (count == 0)
+	{
+		return;
+	}
+
+	int32* indices = (int32*)b2Alloc(count * sizeof(int32));
+	b2Vec2* centers = (b2Vec2*)b2Alloc(count * sizeof(b2Vec2));
+
+	b2Vec2 r(b2_aabbExtension, b2_aabbExtension);
+	for (int32 i = 0; i < count; ++i)
+	{
+		int32 proxyId = AllocateNode();
+		m_nodes[proxyId].aabb.lowerBound = aabbs[i].lowerBound - r;
+		m_nodes[proxyId].aabb.upperBound = aabbs[i].upperBound + r;
+		m_nodes[proxyId].userData = userData[i];
+		m_nodes[proxyId].height = 0;
+		m_nodes[proxyId].filter = filters[i];
+
+		proxyIds[i] = proxyId;
+		indices[i] = i;
+		centers[i] = aabbs[i].GetCenter();
+	}
+
+	int32 root = BuildRecursive(proxyIds, indices, centers, 0, count);
+	InsertLeaf(root);
+
+	b2Free(centers);
+	b2Free(indices);
+}
+
+// Build the subtree of the proxies in [begin, end). The proxies are split at
+// the median center along the longest axis of their centers.
+int32 b2DynamicTree::BuildRecursive(const int32* proxyIds, int32* indices, const b2Vec2* centers,
+									int32 begin, int32 end)
+{
+	if (end - begin == 1)
+	{
+		return proxyIds[indices[begin]];
+	}
+
+	b2Vec2 lower = centers[indices[begin]];
+	b2Vec2 upper = lower;
+	for (int32 i = begin + 1; i < end; ++i)
+	{
+		lower = b2Min(lower, centers[indices[i]]);
+		upper = b2Max(upper, centers[indices[i]]);
+	}
+
+	b2Vec2 d = upper - lower;
+
+	b2ProxyCenterLess less;
+	less.centers = centers;
+	less.axis = d.x >= d.y ? 0 : 1;
+
+	int32 middle = begin + (end - begin) / 2;
+	std::nth_element(indices + begin, indices + middle, indices + end, less);
+
+	int32 child1 = BuildRecursive(proxyIds, indices, centers, begin, middle);
+	int32 child2 = BuildRecursive(proxyIds, indices, centers, middle, end);
+
+	int32 parent = AllocateNode();
+	m_nodes[parent].child1 = child1;
+	m_nodes[parent].child2 = child2;
+	m_nodes[parent].aabb.Combine(m_nodes[child1].aabb, m_nodes[child2].aabb);
+	m_nodes[parent].height = 1 + b2Max(m_nodes[child1].height, m_nodes[child2].height);
+	CombineFilters(parent);
+	m_nodes[child1].parent = parent;
+	m_nodes[child2].parent = parent;
+	return parent;
+}
+
 void b2DynamicTree::DestroyProxy(int32 proxyId)
 {
 	b2Assert(0 <= proxyId && proxyId < m_nodeCapacity);
@@ -173,6 +264,34 @@ bool b2DynamicTree::MoveProxy(int32 proxyId, const b2AABB& aabb, const b2Vec2& d
 	return true;
 }
 
+void b2DynamicTree::SetFilter(int32 proxyId, const b2Filter& filter)
+{
+	b2Assert(0 <= proxyId && proxyId < m_nodeCapacity);
+	b2Assert(m_nodes[proxyId].IsLeaf());
+
+	m_nodes[proxyId].filter = filter;
+
+	// A detached leaf has no parent.
+	int32 index = m_nodes[proxyId].parent;
+	while (index != b2_nullNode)
+	{
+		CombineFilters(index);
+		index = m_nodes[index].parent;
+	}
+}
+
+// An internal node keeps the union of the bits of its children.
+void b2DynamicTree::CombineFilters(int32 index)
+{
+	b2TreeNode* node = m_nodes + index;
+	const b2TreeNode* child1 = m_nodes + node->child1;
+	const b2TreeNode* child2 = m_nodes + node->child2;
+	node->filter.categoryBits = child1->filter.categoryBits | child2->filter.categoryBits;
+	node->filter.maskBits = child1->filter.maskBits | child2->filter.maskBits;
+	node->filter.groupIndex = 0;
+}
+
+// Insert a leaf, or the root of a subtree built by CreateProxies.
 void b2DynamicTree::InsertLeaf(int32 leaf)
 {
 	++m_insertionCount;
@@ -263,7 +382,7 @@ void b2DynamicTree::InsertLeaf(int32 leaf)
 	m_nodes[newParent].parent = oldParent;
 	m_nodes[newParent].userData = NULL;
 	m_nodes[newParent].aabb.Combine(leafAABB, m_nodes[sibling].aabb);
-	m_nodes[newParent].height = m_nodes[sibling].height + 1;
+	m_nodes[newParent].height = 1 + b2Max(m_nodes[sibling].height, m_nodes[leaf].height);
 
 	if (oldParent != b2_nullNode)
 	{
@@ -306,6 +425,7 @@ void b2DynamicTree::InsertLeaf(int32 leaf)
 
 		m_nodes[index].height = 1 + b2Max(m_nodes[child1].height, m_nodes[child2].height);
 		m_nodes[index].aabb.Combine(m_nodes[child1].aabb, m_nodes[child2].aabb);
+		CombineFilters(index);
 
 		index = m_nodes[index].parent;
 	}
@@ -358,6 +478,7 @@ void b2DynamicTree::RemoveLeaf(int32 leaf)
 
 			m_nodes[index].aabb.Combine(m_nodes[child1].aabb, m_nodes[child2].aabb);
 			m_nodes[index].height = 1 + b2Max(m_nodes[child1].height, m_nodes[child2].height);
+			CombineFilters(index);
 
 			index = m_nodes[index].parent;
 		}
@@ -438,6 +559,9 @@ int32 b2DynamicTree::Balance(int32 iA)
 
 			A->height = 1 + b2Max(B->height, G->height);
 			C->height = 1 + b2Max(A->height, F->height);
+
+			CombineFilters(iA);
+			CombineFilters(iC);
 		}
 		else
 		{
@@ -449,6 +573,9 @@ int32 b2DynamicTree::Balance(int32 iA)
 
 			A->height = 1 + b2Max(B->height, F->height);
 			C->height = 1 + b2Max(A->height, G->height);
+
+			CombineFilters(iA);
+			CombineFilters(iC);
 		}
 
 		return iC;
@@ -498,6 +625,9 @@ int32 b2DynamicTree::Balance(int32 iA)
 
 			A->height = 1 + b2Max(C->height, E->height);
 			B->height = 1 + b2Max(A->height, D->height);
+
+			CombineFilters(iA);
+			CombineFilters(iB);
 		}
 		else
 		{
@@ -509,6 +639,9 @@ int32 b2DynamicTree::Balance(int32 iA)
 
 			A->height = 1 + b2Max(C->height, D->height);
 			B->height = 1 + b2Max(A->height, E->height);
+
+			CombineFilters(iA);
+			CombineFilters(iB);
 		}
 
 		return iB;
@@ -646,6 +779,9 @@ void b2DynamicTree::ValidateMetrics(int32 index) const
 	b2Assert(aabb.lowerBound == node->aabb.lowerBound);
 	b2Assert(aabb.upperBound == node->aabb.upperBound);
 
+	b2Assert(node->filter.categoryBits == (m_nodes[child1].filter.categoryBits | m_nodes[child2].filter.categoryBits));
+	b2Assert(node->filter.maskBits == (m_nodes[child1].filter.maskBits | m_nodes[child2].filter.maskBits));
+
 	ValidateMetrics(child1);
 	ValidateMetrics(child2);
 }
@@ -751,6 +887,7 @@ void b2DynamicTree::RebuildBottomUp()
 		parent->child2 = index2;
 		parent->height = 1 + b2Max(child1->height, child2->height);
 		parent->aabb.Combine(child1->aabb, child2->aabb);
+		CombineFilters(parentIndex);
 		parent->parent = b2_nullNode;
 
 		child1->parent = parentIndex;
@@ -48,6 +48,10 @@ struct b2TreeNode
 
 	// leaf = 0, free node = -1
 	int32 height;
+
+	/// The filter of a leaf. Internal nodes keep the union of the category
+	/// and mask bits below them so that filtered queries can skip subtrees.
+	b2Filter filter;
 };
 
 /// A dynamic AABB tree broad-phase, inspired by Nathanael Presson's btDbvt.
@@ -67,8 +71,15 @@ public:
 	/// Destroy the tree, freeing the node pool.
 	~b2DynamicTree();
 
-	/// Create a proxy. Provide a tight fitting AABB and a userData pointer.
-	int32 CreateProxy(const b2AABB& aabb, void* userData);
+	/// Create a proxy. Provide a tight fitting AABB, a userData pointer and
+	/// the filter used by filtered queries.
+	int32 CreateProxy(const b2AABB& aabb, void* userData, const b2Filter& filter);
+
+	/// Create many proxies at once. The proxies are built into a subtree that is
+	/// inserted as one node, this is much faster than creating them one by one.
+	/// @param proxyIds receives the proxy ids.
+	void CreateProxies(int32* proxyIds, const b2AABB* aabbs, void* const* userData,
+					   const b2Filter* filters, int32 count);
 
 	/// Destroy a proxy. This asserts if the id is invalid.
 	void DestroyProxy(int32 proxyId);
@@ -79,10 +90,16 @@ public:
 	/// @return true if the proxy was re-inserted.
 	bool MoveProxy(int32 proxyId, const b2AABB& aabb1, const b2Vec2& displacement);
 
+	/// Change the filter of a proxy.
+	void SetFilter(int32 proxyId, const b2Filter& filter);
+
 	/// Get proxy user data.
 	/// @return the proxy user data or 0 if the id is invalid.
 	void* GetUserData(int32 proxyId) const;
 
+	/// Get the filter of a proxy.
+	const b2Filter& GetFilter(int32 proxyId) const;
+
 	/// Get the fat AABB for a proxy.
 	const b2AABB& GetFatAABB(int32 proxyId) const;
 
@@ -91,6 +108,11 @@ public:
 	template <typename T>
 	void Query(T* callback, const b2AABB& aabb) const;
 
+	/// Query an AABB for overlapping proxies that pass b2ShouldCollide
+	/// with the given filter. Subtrees without a matching category are skipped.
+	template <typename T>
+	void Query(T* callback, const b2AABB& aabb, const b2Filter& filter) const;
+
 	/// Ray-cast against the proxies in the tree. This relies on the callback
 	/// to perform a exact ray-cast in the case were the proxy contains a shape.
 	/// The callback also performs the any collision filtering. This has performance
@@ -101,6 +123,10 @@ public:
 	template <typename T>
 	void RayCast(T* callback, const b2RayCastInput& input) const;
 
+	/// Ray-cast against the proxies that pass b2ShouldCollide with the given filter.
+	template <typename T>
+	void RayCast(T* callback, const b2RayCastInput& input, const b2Filter& filter) const;
+
 	/// Validate this tree. For testing.
 	void Validate() const;
 
@@ -125,14 +151,26 @@ public:
 
 private:
 
+	friend class b2QuerySnapshot;
+
 	int32 AllocateNode();
 	void FreeNode(int32 node);
 
 	void InsertLeaf(int32 node);
 	void RemoveLeaf(int32 node);
 
+	int32 BuildRecursive(const int32* proxyIds, int32* indices, const b2Vec2* centers, int32 begin, int32 end);
+
 	int32 Balance(int32 index);
 
+	void CombineFilters(int32 index);
+
+	template <typename T>
+	void Query(T* callback, const b2AABB& aabb, const b2Filter* filter) const;
+
+	template <typename T>
+	void RayCast(T* callback, const b2RayCastInput& input, const b2Filter* filter) const;
+
 	int32 ComputeHeight() const;
 	int32 ComputeHeight(int32 nodeId) const;
 
@@ -165,8 +203,62 @@ inline const b2AABB& b2DynamicTree::GetFatAABB(int32 proxyId) const
 	return m_nodes[proxyId].aabb;
 }
 
+inline const b2Filter& b2DynamicTree::GetFilter(int32 proxyId) const
+{
+	b2Assert(0 <= proxyId && proxyId < m_nodeCapacity);
+	return m_nodes[proxyId].filter;
+}
+
+// Can any leaf below the node pass the filter? A positive group collides
+// regardless of the bits, so it can only be tested at the leaves. This also
+// works on the nodes of b2QuerySnapshot.
+template <typename T>
+inline bool b2TestFilter(const T* node, const b2Filter* filter)
+{
+	if (filter == NULL)
+	{
+		return true;
+	}
+
+	if (node->IsLeaf())
+	{
+		return b2ShouldCollide(node->filter, *filter);
+	}
+
+	if (filter->groupIndex > 0)
+	{
+		return true;
+	}
+
+	return (node->filter.categoryBits & filter->maskBits) != 0 && (node->filter.maskBits & filter->categoryBits) != 0;
+}
+
 template <typename T>
 inline void b2DynamicTree::Query(T* callback, const b2AABB& aabb) const
+{
+	Query(callback, aabb, (const b2Filter*)NULL);
+}
+
+template <typename T>
+inline void b2DynamicTree::Query(T* callback, const b2AABB& aabb, const b2Filter& filter) const
+{
+	Query(callback, aabb, &filter);
+}
+
+template <typename T>
+inline void b2DynamicTree::RayCast(T* callback, const b2RayCastInput& input) const
+{
+	RayCast(callback, input, (const b2Filter*)NULL);
+}
+
+template <typename T>
+inline void b2DynamicTree::RayCast(T* callback, const b2RayCastInput& input, const b2Filter& filter) const
+{
+	RayCast(callback, input, &filter);
+}
+
+template <typename T>
+inline void b2DynamicTree::Query(T* callback, const b2AABB& aabb, const b2Filter* filter) const
 {
 	b2GrowableStack<int32, 256> stack;
 	stack.Push(m_root);
@@ -181,7 +273,7 @@ inline void b2DynamicTree::Query(T* callback, const b2AABB& aabb) const
 
 		const b2TreeNode* node = m_nodes + nodeId;
 
-		if (b2TestOverlap(node->aabb, aabb))
+		if (b2TestOverlap(node->aabb, aabb) && b2TestFilter(node, filter))
 		{
 			if (node->IsLeaf())
 			{
@@ -201,7 +293,7 @@ inline void b2DynamicTree::Query(T* callback, const b2AABB& aabb) const
 }
 
 template <typename T>
-inline void b2DynamicTree::RayCast(T* callback, const b2RayCastInput& input) const
+inline void b2DynamicTree::RayCast(T* callback, const b2RayCastInput& input, const b2Filter* filter) const
 {
 	b2Vec2 p1 = input.p1;
 	b2Vec2 p2 = input.p2;
@@ -239,7 +331,7 @@ inline void b2DynamicTree::RayCast(T* callback, const b2RayCastInput& input) con
 
 		const b2TreeNode* node = m_nodes + nodeId;
 
-		if (b2TestOverlap(node->aabb, segmentAABB) == false)
+		if (b2TestOverlap(node->aabb, segmentAABB) == false || b2TestFilter(node, filter) == false)
 		{
 			continue;
 		}
@@ -0,0 +1,171 @@
+/*
+* Copyright (c) 2006-2009 Erin Catto http://www.box2d.org
+*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include <Box2D/Collision/b2StaticTree.h>
+#include <Box2D/Collision/Shapes/b2Shape.h>
+#include <string.h>
+#include <algorithm>
+
+// Orders children by the center of their AABB along one axis.
+struct b2CenterLess
+{
+	bool operator()(int32 a, int32 b) const
+	{
+		return centers[a](axis) < centers[b](axis);
+	}
+
+	const b2Vec2* centers;
+	int32 axis;
+};
+
+b2StaticTree::b2StaticTree()
+{
+	m_nodes = NULL;
+	m_nodeCount = 0;
+}
+
+b2StaticTree::~b2StaticTree()
+{
+	b2Free(m_nodes);
+}
+
+void b2StaticTree::Build(const b2AABB* aabbs, int32 count)
+{
+	b2Assert(m_nodes == NULL);
+	b2Assert(count > 0);
+
+	int32* children = (int32*)b2Alloc(count * sizeof(int32));
+	b2Vec2* centers = (b2Vec2*)b2Alloc(count * sizeof(b2Vec2));
+	for (int32 i = 0; i < count; ++i)
+	{
+		children[i] = i;
+		centers[i] = aabbs[i].GetCenter();
+	}
+
+	// A binary tree with one child per leaf.
+	m_nodeCount = 0;
+	m_nodes = (b2StaticTreeNode*)b2Alloc((2 * count - 1) * sizeof(b2StaticTreeNode));
+	BuildRecursive(children, aabbs, centers, 0, count);
+	b2Assert(m_nodeCount == 2 * count - 1);
+
+	b2Free(centers);
+	b2Free(children);
+}
+
+// Build the subtree of the children in [begin, end). The children are split
+// at the median center along the longest axis of their centers.
+int32 b2StaticTree::BuildRecursive(int32* children, const b2AABB* aabbs, const b2Vec2* centers,
+								   int32 begin, int32 end)
+{
+	int32 nodeId = m_nodeCount++;
+	b2StaticTreeNode* node = m_nodes + nodeId;
+
+	if (end - begin == 1)
+	{
+		node->aabb = aabbs[children[begin]];
+		node->child1 = b2_nullNode;
+		node->child2 = children[begin];
+		return nodeId;
+	}
+
+	b2Vec2 lower = centers[children[begin]];
+	b2Vec2 upper = lower;
+	for (int32 i = begin + 1; i < end; ++i)
+	{
+		lower = b2Min(lower, centers[children[i]]);
+		upper = b2Max(upper, centers[children[i]]);
+	}
+
+	b2Vec2 d = upper - lower;
+
+	b2CenterLess less;
+	less.centers = centers;
+	less.axis = d.x >= d.y ? 0 : 1;
+
+	int32 middle = begin + (end - begin) / 2;
+	std::nth_element(children + begin, children + middle, children + end, less);
+
+	node->child1 = BuildRecursive(children, aabbs, centers, begin, middle);
+	node->child2 = BuildRecursive(children, aabbs, centers, middle, end);
+	node->aabb.Combine(m_nodes[node->child1].aabb, m_nodes[node->child2].aabb);
+	return nodeId;
+}
+
+void b2StaticTree::Copy(const b2StaticTree& other)
+{
+	b2Assert(m_nodes == NULL);
+	if (other.m_nodes == NULL)
+	{
+		return;
+	}
+
+	m_nodeCount = other.m_nodeCount;
+	m_nodes = (b2StaticTreeNode*)b2Alloc(m_nodeCount * sizeof(b2StaticTreeNode));
+	memcpy(m_nodes, other.m_nodes, m_nodeCount * sizeof(b2StaticTreeNode));
+}
+
+void b2StaticTree::ComputeAABB(b2AABB* aabb, const b2Transform& xf) const
+{
+	b2Assert(m_nodes != NULL);
+
+	// Rotate the extents of the root AABB.
+	const b2AABB& root = m_nodes[0].aabb;
+	b2Vec2 c = b2Mul(xf, root.GetCenter());
+	b2Vec2 h = root.GetExtents();
+	b2Vec2 r;
+	r.x = b2Abs(xf.q.c) * h.x + b2Abs(xf.q.s) * h.y;
+	r.y = b2Abs(xf.q.s) * h.x + b2Abs(xf.q.c) * h.y;
+
+	aabb->lowerBound = c - r;
+	aabb->upperBound = c + r;
+}
+
+// Forwards tree leaves to a child query callback.
+struct b2ChildQueryWrapper
+{
+	bool QueryCallback(int32 childIndex)
+	{
+		return callback->ReportChild(childIndex);
+	}
+
+	b2ChildQueryCallback* callback;
+};
+
+void b2StaticTree::QueryChildren(b2ChildQueryCallback* callback, const b2AABB& aabb) const
+{
+	b2ChildQueryWrapper wrapper;
+	wrapper.callback = callback;
+	Query(&wrapper, aabb);
+}
+
+struct b2ChildRayCastWrapper
+{
+	float32 RayCastCallback(const b2RayCastInput& input, int32 childIndex)
+	{
+		return callback->ReportChild(input, childIndex);
+	}
+
+	b2ChildRayCastCallback* callback;
+};
+
+void b2StaticTree::RayCastChildren(b2ChildRayCastCallback* callback, const b2RayCastInput& input) const
+{
+	b2ChildRayCastWrapper wrapper;
+	wrapper.callback = callback;
+	RayCast(&wrapper, input);
+}
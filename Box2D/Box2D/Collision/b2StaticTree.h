@@ -0,0 +1,213 @@
+/*
+* Copyright (c) 2006-2009 Erin Catto http://www.box2d.org
+*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#ifndef B2_STATIC_TREE_H
+#define B2_STATIC_TREE_H
+
+#include <Box2D/Collision/b2DynamicTree.h>
+
+class b2ChildQueryCallback;
+class b2ChildRayCastCallback;
+
+/// A node in a static tree. Leaves hold a child index in child2.
+struct b2StaticTreeNode
+{
+	bool IsLeaf() const
+	{
+		return child1 == b2_nullNode;
+	}
+
+	/// Tight AABB in the frame of the shape.
+	b2AABB aabb;
+
+	int32 child1;
+	int32 child2;
+};
+
+/// An immutable AABB tree over the children of a shape, used by shapes with many
+/// children so that a fixture needs only one broad-phase proxy. The tree is
+/// built once top-down and stored as a flat node array with the root first.
+/// Queries are done in the frame of the shape.
+class b2StaticTree
+{
+public:
+
+	/// Constructing the tree leaves it empty.
+	b2StaticTree();
+
+	/// Destroy the tree, freeing the node array.
+	~b2StaticTree();
+
+	/// Build the tree from the child AABBs. Each child becomes a leaf.
+	void Build(const b2AABB* aabbs, int32 count);
+
+	/// Copy the nodes of another tree.
+	void Copy(const b2StaticTree& other);
+
+	/// Has the tree been built?
+	bool IsBuilt() const { return m_nodes != NULL; }
+
+	/// Compute the AABB of all children in world coordinates. This rotates the
+	/// root AABB, so it is loose for rotated shapes.
+	void ComputeAABB(b2AABB* aabb, const b2Transform& transform) const;
+
+	/// Report the children that may overlap an AABB. Shapes use this to implement
+	/// b2Shape::QueryChildren.
+	void QueryChildren(b2ChildQueryCallback* callback, const b2AABB& aabb) const;
+
+	/// Report the children whose AABB a ray crosses. Shapes use this to implement
+	/// b2Shape::RayCastChildren.
+	void RayCastChildren(b2ChildRayCastCallback* callback, const b2RayCastInput& input) const;
+
+	/// Query the tree for children that may overlap the AABB. The callback
+	/// receives the child index and returns false to terminate the query.
+	template <typename T>
+	void Query(T* callback, const b2AABB& aabb) const;
+
+	/// Ray-cast against the children in the tree. The callback receives the child
+	/// index and returns the new max fraction, or 0 to terminate the ray cast.
+	template <typename T>
+	void RayCast(T* callback, const b2RayCastInput& input) const;
+
+	/// Get the number of nodes.
+	int32 GetNodeCount() const { return m_nodeCount; }
+
+private:
+
+	int32 BuildRecursive(int32* children, const b2AABB* aabbs, const b2Vec2* centers,
+						 int32 begin, int32 end);
+
+	b2StaticTreeNode* m_nodes;
+	int32 m_nodeCount;
+};
+
+template <typename T>
+inline void b2StaticTree::Query(T* callback, const b2AABB& aabb) const
+{
+	b2Assert(m_nodes != NULL);
+
+	b2GrowableStack<int32, 256> stack;
+	stack.Push(0);
+
+	while (stack.GetCount() > 0)
+	{
+		int32 nodeId = stack.Pop();
+		const b2StaticTreeNode* node = m_nodes + nodeId;
+
+		if (b2TestOverlap(node->aabb, aabb) == false)
+		{
+			continue;
+		}
+
+		if (node->IsLeaf())
+		{
+			bool proceed = callback->QueryCallback(node->child2);
+			if (proceed == false)
+			{
+				return;
+			}
+		}
+		else
+		{
+			stack.Push(node->child1);
+			stack.Push(node->child2);
+		}
+	}
+}
+
+template <typename T>
+inline void b2StaticTree::RayCast(T* callback, const b2RayCastInput& input) const
+{
+	b2Assert(m_nodes != NULL);
+
+	b2Vec2 p1 = input.p1;
+	b2Vec2 p2 = input.p2;
+	b2Vec2 r = p2 - p1;
+	b2Assert(r.LengthSquared() > 0.0f);
+	r.Normalize();
+
+	// v is perpendicular to the segment.
+	b2Vec2 v = b2Cross(1.0f, r);
+	b2Vec2 abs_v = b2Abs(v);
+
+	float32 maxFraction = input.maxFraction;
+
+	// Build a bounding box for the segment.
+	b2AABB segmentAABB;
+	{
+		b2Vec2 t = p1 + maxFraction * (p2 - p1);
+		segmentAABB.lowerBound = b2Min(p1, t);
+		segmentAABB.upperBound = b2Max(p1, t);
+	}
+
+	b2GrowableStack<int32, 256> stack;
+	stack.Push(0);
+
+	while (stack.GetCount() > 0)
+	{
+		int32 nodeId = stack.Pop();
+		const b2StaticTreeNode* node = m_nodes + nodeId;
+
+		if (b2TestOverlap(node->aabb, segmentAABB) == false)
+		{
+			continue;
+		}
+
+		// Separating axis for segment (Gino, p80).
+		// |dot(v, p1 - c)| > dot(|v|, h)
+		b2Vec2 c = node->aabb.GetCenter();
+		b2Vec2 h = node->aabb.GetExtents();
+		float32 separation = b2Abs(b2Dot(v, p1 - c)) - b2Dot(abs_v, h);
+		if (separation > 0.0f)
+		{
+			continue;
+		}
+
+		if (node->IsLeaf())
+		{
+			b2RayCastInput subInput;
+			subInput.p1 = input.p1;
+			subInput.p2 = input.p2;
+			subInput.maxFraction = maxFraction;
+
+			float32 value = callback->RayCastCallback(subInput, node->child2);
+
+			if (value == 0.0f)
+			{
+				// The client has terminated the ray cast.
+				return;
+			}
+
+			if (value > 0.0f)
+			{
+				// Update segment bounding box.
+				maxFraction = value;
+				b2Vec2 t = p1 + maxFraction * (p2 - p1);
+				segmentAABB.lowerBound = b2Min(p1, t);
+				segmentAABB.upperBound = b2Max(p1, t);
+			}
+		}
+		else
+		{
+			stack.Push(node->child1);
+			stack.Push(node->child2);
+		}
+	}
+}
+
+#endif
@@ -25,9 +25,9 @@
 
 #include <stdio.h>
 
-float32 b2_toiTime, b2_toiMaxTime;
-int32 b2_toiCalls, b2_toiIters, b2_toiMaxIters;
-int32 b2_toiRootIters, b2_toiMaxRootIters;
+B2_THREAD_LOCAL float32 b2_toiTime, b2_toiMaxTime;
+B2_THREAD_LOCAL int32 b2_toiCalls, b2_toiIters, b2_toiMaxIters;
+B2_THREAD_LOCAL int32 b2_toiRootIters, b2_toiMaxRootIters;
 
 //
 struct b2SeparationFunction
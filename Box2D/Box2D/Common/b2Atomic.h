@@ -0,0 +1,123 @@
+/*
+* Copyright (c) 2006-2009 Erin Catto http://www.box2d.org
+*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#ifndef B2_ATOMIC_H
+#define B2_ATOMIC_H
+
+#include <Box2D/Common/b2Settings.h>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+/// @file
+/// Sequentially consistent atomic operations on 32-bit integers and pointers.
+/// These are the only synchronization the library uses itself, everything
+/// else runs on the threads given to it through b2TaskExecutor.
+
+/// Add to an integer and return the new value.
+inline int32 b2AtomicAdd(volatile int32* value, int32 delta)
+{
+#if defined(_MSC_VER)
+	return _InterlockedExchangeAdd((volatile long*)value, delta) + delta;
+#else
+	return __atomic_add_fetch(value, delta, __ATOMIC_SEQ_CST);
+#endif
+}
+
+/// Read an integer.
+inline int32 b2AtomicLoad(const volatile int32* value)
+{
+#if defined(_MSC_VER)
+	return _InterlockedCompareExchange((volatile long*)value, 0, 0);
+#else
+	return __atomic_load_n(value, __ATOMIC_SEQ_CST);
+#endif
+}
+
+/// Write an integer.
+inline void b2AtomicStore(volatile int32* value, int32 newValue)
+{
+#if defined(_MSC_VER)
+	_InterlockedExchange((volatile long*)value, newValue);
+#else
+	__atomic_store_n(value, newValue, __ATOMIC_SEQ_CST);
+#endif
+}
+
+/// Replace an integer if it equals the expected value.
+/// @return true if the value was replaced.
+inline bool b2AtomicCompareExchange(volatile int32* value, int32 expected, int32 newValue)
+{
+#if defined(_MSC_VER)
+	return _InterlockedCompareExchange((volatile long*)value, newValue, expected) == expected;
+#else
+	return __atomic_compare_exchange_n(value, &expected, newValue, false, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST);
+#endif
+}
+
+/// Read a pointer.
+inline void* b2AtomicLoadPointer(void* const volatile* pointer)
+{
+#if defined(_MSC_VER)
+	return _InterlockedCompareExchangePointer((void* volatile*)pointer, NULL, NULL);
+#else
+	return __atomic_load_n(pointer, __ATOMIC_SEQ_CST);
+#endif
+}
+
+/// Write a pointer.
+inline void b2AtomicStorePointer(void* volatile* pointer, void* newValue)
+{
+#if defined(_MSC_VER)
+	_InterlockedExchangePointer(pointer, newValue);
+#else
+	__atomic_store_n(pointer, newValue, __ATOMIC_SEQ_CST);
+#endif
+}
+
+/// Call a function once, no matter how many threads get here. The flag must
+/// start at zero. Threads that lose the race wait until the call has finished,
+/// so this is only meant for short one-time setup of static tables.
+inline void b2CallOnce(volatile int32* flag, void (*fcn)())
+{
+	// 0 = not called, 1 = being called, 2 = done
+	if (b2AtomicLoad(flag) == 2)
+	{
+		return;
+	}
+
+	if (b2AtomicCompareExchange(flag, 0, 1))
+	{
+		fcn();
+		b2AtomicStore(flag, 2);
+		return;
+	}
+
+	while (b2AtomicLoad(flag) != 2)
+	{
+	}
+}
+
+/// Has the function of this flag been called by b2CallOnce?
+inline bool b2IsCalledOnce(const volatile int32* flag)
+{
+	return b2AtomicLoad(flag) == 2;
+}
+
+#endif
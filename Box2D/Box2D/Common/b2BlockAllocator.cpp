@@ -17,6 +17,7 @@
 */
 
 #include <Box2D/Common/b2BlockAllocator.h>
+#include <Box2D/Common/b2Atomic.h>
 #include <limits.h>
 #include <memory.h>
 #include <stddef.h>
@@ -39,7 +40,7 @@ int32 b2BlockAllocator::s_blockSizes[b2_blockSizes] =
 	640,	// 13
 };
 uint8 b2BlockAllocator::s_blockSizeLookup[b2_maxBlockSize + 1];
-bool b2BlockAllocator::s_blockSizeLookupInitialized;
+volatile int32 b2BlockAllocator::s_blockSizeLookupInitialized = 0;
 
 struct b2Chunk
 {
@@ -63,24 +64,24 @@ b2BlockAllocator::b2BlockAllocator()
 	memset(m_chunks, 0, m_chunkSpace * sizeof(b2Chunk));
 	memset(m_freeLists, 0, sizeof(m_freeLists));
 
-	if (s_blockSizeLookupInitialized == false)
+	b2CallOnce(&s_blockSizeLookupInitialized, InitializeBlockSizeLookup);
+}
+
+void b2BlockAllocator::InitializeBlockSizeLookup()
+{
+	int32 j = 0;
+	for (int32 i = 1; i <= b2_maxBlockSize; ++i)
 	{
-		int32 j = 0;
-		for (int32 i = 1; i <= b2_maxBlockSize; ++i)
+		b2Assert(j < b2_blockSizes);
+		if (i <= s_blockSizes[j])
 		{
-			b2Assert(j < b2_blockSizes);
-			if (i <= s_blockSizes[j])
-			{
-				s_blockSizeLookup[i] = (uint8)j;
-			}
-			else
-			{
-				++j;
-				s_blockSizeLookup[i] = (uint8)j;
-			}
+			s_blockSizeLookup[i] = (uint8)j;
+		}
+		else
+		{
+			++j;
+			s_blockSizeLookup[i] = (uint8)j;
 		}
-
-		s_blockSizeLookupInitialized = true;
 	}
 }
 
@@ -56,7 +56,9 @@ private:
 
 	static int32 s_blockSizes[b2_blockSizes];
 	static uint8 s_blockSizeLookup[b2_maxBlockSize + 1];
-	static bool s_blockSizeLookupInitialized;
+	static volatile int32 s_blockSizeLookupInitialized;
+
+	static void InitializeBlockSizeLookup();
 };
 
 #endif
@@ -39,6 +39,19 @@ typedef double float64;
 #define	b2_epsilon		FLT_EPSILON
 #define b2_pi			3.14159265359f
 
+/// The particle kernels use SSE2 when the target supports it. Define B2_NO_SIMD
+/// to force the scalar code paths.
+#if !defined(B2_NO_SIMD) && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#define B2_SIMD_SSE2
+#endif
+
+/// Storage class for globals that each thread keeps its own copy of.
+#if defined(_MSC_VER)
+#define B2_THREAD_LOCAL __declspec(thread)
+#else
+#define B2_THREAD_LOCAL __thread
+#endif
+
 /// @file
 /// Global tuning constants based on meters-kilograms-seconds (MKS) units.
 ///
@@ -113,6 +126,23 @@ typedef double float64;
 #define b2_baumgarte				0.2f
 #define b2_toiBaugarte				0.75f
 
+/// The number of time steps that the impulses of a contact point are kept after
+/// the point stops touching. A point that touches again within this time is warm
+/// started with its old impulses.
+#define b2_impulseCacheSteps		4
+
+/// The stiffness of contacts in the soft step solver, in cycles per second. This is
+/// lowered to a quarter of the sub-step rate if needed.
+#define b2_contactHertz				30.0f
+
+/// The damping ratio of contacts in the soft step solver. Contacts are heavily
+/// over-damped so that they don't bounce.
+#define b2_contactDampingRatio		10.0f
+
+/// The maximum speed used by the soft step solver to push apart overlapping shapes.
+/// This is in meters per second.
+#define b2_contactPushoutVelocity	3.0f
+
 
 // Sleep
 
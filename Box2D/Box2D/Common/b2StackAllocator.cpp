@@ -37,6 +37,10 @@ void* b2StackAllocator::Allocate(int32 size)
 {
 	b2Assert(m_entryCount < b2_maxStackEntries);
 
+	// Keep the next entry aligned for any type. Allocations of small types,
+	// such as bool arrays, would otherwise misalign everything above them.
+	size = (size + 7) & ~7;
+
 	b2StackEntry* entry = m_entries + m_entryCount;
 	entry->size = size;
 	if (m_index + size > b2_stackSize)
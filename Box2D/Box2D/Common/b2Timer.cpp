@@ -17,28 +17,32 @@
 */
 
 #include <Box2D/Common/b2Timer.h>
+#include <Box2D/Common/b2Atomic.h>
 
 #if defined(_WIN32)
 
 float64 b2Timer::s_invFrequency = 0.0f;
+volatile int32 b2Timer::s_frequencyInitialized = 0;
 
 #define WIN32_LEAN_AND_MEAN
 #include <windows.h>
 
-b2Timer::b2Timer()
+void b2Timer::InitializeFrequency()
 {
 	LARGE_INTEGER largeInteger;
-
-	if (s_invFrequency == 0.0f)
+	QueryPerformanceFrequency(&largeInteger);
+	s_invFrequency = float64(largeInteger.QuadPart);
+	if (s_invFrequency > 0.0f)
 	{
-		QueryPerformanceFrequency(&largeInteger);
-		s_invFrequency = float64(largeInteger.QuadPart);
-		if (s_invFrequency > 0.0f)
-		{
-			s_invFrequency = 1000.0f / s_invFrequency;
-		}
+		s_invFrequency = 1000.0f / s_invFrequency;
 	}
+}
 
+b2Timer::b2Timer()
+{
+	b2CallOnce(&s_frequencyInitialized, InitializeFrequency);
+
+	LARGE_INTEGER largeInteger;
 	QueryPerformanceCounter(&largeInteger);
 	m_start = float64(largeInteger.QuadPart);
 }
@@ -41,9 +41,11 @@ private:
 #if defined(_WIN32)
 	float64 m_start;
 	static float64 s_invFrequency;
+	static volatile int32 s_frequencyInitialized;
+	static void InitializeFrequency();
 #elif defined(__linux__) || defined (__APPLE__)
-	unsigned long m_start_sec;
-	unsigned long m_start_usec;
+	long m_start_sec;
+	long m_start_usec;
 #endif
 };
 
@@ -24,6 +24,13 @@
 #include <Box2D/Dynamics/Contacts/b2EdgeAndPolygonContact.h>
 #include <Box2D/Dynamics/Contacts/b2ChainAndCircleContact.h>
 #include <Box2D/Dynamics/Contacts/b2ChainAndPolygonContact.h>
+#include <Box2D/Dynamics/Contacts/b2CompoundAndCircleContact.h>
+#include <Box2D/Dynamics/Contacts/b2CompoundAndPolygonContact.h>
+#include <Box2D/Dynamics/Contacts/b2HeightFieldAndCircleContact.h>
+#include <Box2D/Dynamics/Contacts/b2HeightFieldAndPolygonContact.h>
+#include <Box2D/Dynamics/Contacts/b2CapsuleContact.h>
+#include <Box2D/Dynamics/Contacts/b2CapsuleAndCircleContact.h>
+#include <Box2D/Dynamics/Contacts/b2CapsuleAndPolygonContact.h>
 #include <Box2D/Dynamics/Contacts/b2ContactSolver.h>
 
 #include <Box2D/Collision/b2Collision.h>
@@ -33,9 +40,10 @@
 #include <Box2D/Dynamics/b2Body.h>
 #include <Box2D/Dynamics/b2Fixture.h>
 #include <Box2D/Dynamics/b2World.h>
+#include <Box2D/Common/b2Atomic.h>
 
 b2ContactRegister b2Contact::s_registers[b2Shape::e_typeCount][b2Shape::e_typeCount];
-bool b2Contact::s_initialized = false;
+volatile int32 b2Contact::s_initialized = 0;
 
 void b2Contact::InitializeRegisters()
 {
@@ -46,6 +54,13 @@ void b2Contact::InitializeRegisters()
 	AddType(b2EdgeAndPolygonContact::Create, b2EdgeAndPolygonContact::Destroy, b2Shape::e_edge, b2Shape::e_polygon);
 	AddType(b2ChainAndCircleContact::Create, b2ChainAndCircleContact::Destroy, b2Shape::e_chain, b2Shape::e_circle);
 	AddType(b2ChainAndPolygonContact::Create, b2ChainAndPolygonContact::Destroy, b2Shape::e_chain, b2Shape::e_polygon);
+	AddType(b2CompoundAndCircleContact::Create, b2CompoundAndCircleContact::Destroy, b2Shape::e_compound, b2Shape::e_circle);
+	AddType(b2CompoundAndPolygonContact::Create, b2CompoundAndPolygonContact::Destroy, b2Shape::e_compound, b2Shape::e_polygon);
+	AddType(b2HeightFieldAndCircleContact::Create, b2HeightFieldAndCircleContact::Destroy, b2Shape::e_heightField, b2Shape::e_circle);
+	AddType(b2HeightFieldAndPolygonContact::Create, b2HeightFieldAndPolygonContact::Destroy, b2Shape::e_heightField, b2Shape::e_polygon);
+	AddType(b2CapsuleContact::Create, b2CapsuleContact::Destroy, b2Shape::e_capsule, b2Shape::e_capsule);
+	AddType(b2CapsuleAndCircleContact::Create, b2CapsuleAndCircleContact::Destroy, b2Shape::e_capsule, b2Shape::e_circle);
+	AddType(b2CapsuleAndPolygonContact::Create, b2CapsuleAndPolygonContact::Destroy, b2Shape::e_capsule, b2Shape::e_polygon);
 }
 
 void b2Contact::AddType(b2ContactCreateFcn* createFcn, b2ContactDestroyFcn* destoryFcn,
@@ -68,11 +83,8 @@ void b2Contact::AddType(b2ContactCreateFcn* createFcn, b2ContactDestroyFcn* dest
 
 b2Contact* b2Contact::Create(b2Fixture* fixtureA, int32 indexA, b2Fixture* fixtureB, int32 indexB, b2BlockAllocator* allocator)
 {
-	if (s_initialized == false)
-	{
-		InitializeRegisters();
-		s_initialized = true;
-	}
+	// See b2ContactManager::b2ContactManager.
+	b2Assert(b2IsCalledOnce(&s_initialized));
 
 	b2Shape::Type type1 = fixtureA->GetType();
 	b2Shape::Type type2 = fixtureB->GetType();
@@ -100,12 +112,12 @@ b2Contact* b2Contact::Create(b2Fixture* fixtureA, int32 indexA, b2Fixture* fixtu
 
 void b2Contact::Destroy(b2Contact* contact, b2BlockAllocator* allocator)
 {
-	b2Assert(s_initialized == true);
+	b2Assert(b2IsCalledOnce(&s_initialized));
 
 	b2Fixture* fixtureA = contact->m_fixtureA;
 	b2Fixture* fixtureB = contact->m_fixtureB;
 
-	if (contact->m_manifold.pointCount > 0 &&
+	if (contact->m_state->manifold.pointCount > 0 &&
 		fixtureA->IsSensor() == false &&
 		fixtureB->IsSensor() == false)
 	{
@@ -125,7 +137,9 @@ void b2Contact::Destroy(b2Contact* contact, b2BlockAllocator* allocator)
 
 b2Contact::b2Contact(b2Fixture* fA, int32 indexA, b2Fixture* fB, int32 indexB)
 {
-	m_flags = e_enabledFlag;
+	m_state = NULL;
+	m_id = -1;
+	m_generation = 0;
 
 	m_fixtureA = fA;
 	m_fixtureB = fB;
@@ -133,11 +147,6 @@ b2Contact::b2Contact(b2Fixture* fA, int32 indexA, b2Fixture* fB, int32 indexB)
 	m_indexA = indexA;
 	m_indexB = indexB;
 
-	m_manifold.pointCount = 0;
-
-	m_prev = NULL;
-	m_next = NULL;
-
 	m_nodeA.contact = NULL;
 	m_nodeA.prev = NULL;
 	m_nodeA.next = NULL;
@@ -147,26 +156,19 @@ b2Contact::b2Contact(b2Fixture* fA, int32 indexA, b2Fixture* fB, int32 indexB)
 	m_nodeB.prev = NULL;
 	m_nodeB.next = NULL;
 	m_nodeB.other = NULL;
-
-	m_toiCount = 0;
-
-	m_friction = b2MixFriction(m_fixtureA->m_friction, m_fixtureB->m_friction);
-	m_restitution = b2MixRestitution(m_fixtureA->m_restitution, m_fixtureB->m_restitution);
-
-	m_tangentSpeed = 0.0f;
 }
 
 // Update the contact manifold and touching status.
 // Note: do not assume the fixture AABBs are overlapping or are valid.
-void b2Contact::Update(b2ContactListener* listener)
+void b2Contact::Update(b2ContactListener* listener, b2ImpulseCache* cache)
 {
-	b2Manifold oldManifold = m_manifold;
+	b2Manifold oldManifold = m_state->manifold;
 
 	// Re-enable this contact.
-	m_flags |= e_enabledFlag;
+	m_state->flags |= e_enabledFlag;
 
 	bool touching = false;
-	bool wasTouching = (m_flags & e_touchingFlag) == e_touchingFlag;
+	bool wasTouching = (m_state->flags & e_touchingFlag) == e_touchingFlag;
 
 	bool sensorA = m_fixtureA->IsSensor();
 	bool sensorB = m_fixtureB->IsSensor();
@@ -185,22 +187,24 @@ void b2Contact::Update(b2ContactListener* listener)
 		touching = b2TestOverlap(shapeA, m_indexA, shapeB, m_indexB, xfA, xfB);
 
 		// Sensors don't generate manifolds.
-		m_manifold.pointCount = 0;
+		m_state->manifold.pointCount = 0;
 	}
 	else
 	{
-		Evaluate(&m_manifold, xfA, xfB);
-		touching = m_manifold.pointCount > 0;
+		Evaluate(&m_state->manifold, xfA, xfB);
+		touching = m_state->manifold.pointCount > 0;
 
 		// Match old contact ids to new contact ids and copy the
-		// stored impulses to warm start the solver.
-		for (int32 i = 0; i < m_manifold.pointCount; ++i)
+		// stored impulses to warm start the solver. New points may
+		// have been lost recently.
+		for (int32 i = 0; i < m_state->manifold.pointCount; ++i)
 		{
-			b2ManifoldPoint* mp2 = m_manifold.points + i;
+			b2ManifoldPoint* mp2 = m_state->manifold.points + i;
 			mp2->normalImpulse = 0.0f;
 			mp2->tangentImpulse = 0.0f;
 			b2ContactID id2 = mp2->id;
 
+			bool found = false;
 			for (int32 j = 0; j < oldManifold.pointCount; ++j)
 			{
 				b2ManifoldPoint* mp1 = oldManifold.points + j;
@@ -209,9 +213,39 @@ void b2Contact::Update(b2ContactListener* listener)
 				{
 					mp2->normalImpulse = mp1->normalImpulse;
 					mp2->tangentImpulse = mp1->tangentImpulse;
+					found = true;
 					break;
 				}
 			}
+
+			if (found == false && cache)
+			{
+				cache->Restore(this, mp2);
+			}
+		}
+
+		// Keep the impulses of the lost points.
+		if (cache)
+		{
+			for (int32 j = 0; j < oldManifold.pointCount; ++j)
+			{
+				const b2ManifoldPoint* mp1 = oldManifold.points + j;
+
+				bool found = false;
+				for (int32 i = 0; i < m_state->manifold.pointCount; ++i)
+				{
+					if (m_state->manifold.points[i].id.key == mp1->id.key)
+					{
+						found = true;
+						break;
+					}
+				}
+
+				if (found == false)
+				{
+					cache->Store(this, mp1);
+				}
+			}
 		}
 
 		if (touching != wasTouching)
@@ -219,15 +253,26 @@ void b2Contact::Update(b2ContactListener* listener)
 			bodyA->SetAwake(true);
 			bodyB->SetAwake(true);
 		}
+
+		// Keep the persistent islands connected. This also catches contacts that
+		// were touching as sensors before a fixture became solid.
+		if (touching)
+		{
+			bodyA->m_world->m_islandManager.LinkBodies(bodyA, bodyB);
+		}
+		else if (wasTouching)
+		{
+			bodyA->m_world->m_islandManager.UnlinkBodies(bodyA, bodyB);
+		}
 	}
 
 	if (touching)
 	{
-		m_flags |= e_touchingFlag;
+		m_state->flags |= e_touchingFlag;
 	}
 	else
 	{
-		m_flags &= ~e_touchingFlag;
+		m_state->flags &= ~e_touchingFlag;
 	}
 
 	if (wasTouching == false && touching == true && listener)
@@ -31,6 +31,7 @@ class b2World;
 class b2BlockAllocator;
 class b2StackAllocator;
 class b2ContactListener;
+class b2ImpulseCache;
 
 /// Friction mixing law. The idea is to allow either fixture to drive the restitution to zero.
 /// For example, anything slides on ice.
@@ -71,6 +72,39 @@ struct b2ContactEdge
 	b2ContactEdge* next;	///< the next contact edge in the body's contact list
 };
 
+#define b2_nullActiveIndex (-1)
+
+/// A weak reference to a contact. Contacts come and go with the broad-phase and their
+/// memory is recycled, so keep a handle rather than a contact pointer across time steps.
+/// See b2World::GetContact.
+struct b2ContactHandle
+{
+	int32 id;
+	uint32 generation;
+};
+
+/// The frequently accessed part of a contact. The contact manager keeps these in a
+/// contiguous array that stays dense: a removed entry is replaced by the last one.
+/// The fixtures and child indices are copies of the ones in b2Contact. This holds
+/// everything the narrow-phase, the solvers and TOI read. The b2Contact objects are
+/// still block allocated, and the body contact lists still link b2ContactEdge pointers.
+struct b2ContactState
+{
+	b2Contact* contact;
+	uint32 flags;
+	b2Fixture* fixtureA;
+	b2Fixture* fixtureB;
+	int32 indexA;
+	int32 indexB;
+	int32 toiCount;
+	float32 toi;
+	int32 activeIndex;		///< index in the active contact array or b2_nullActiveIndex
+	float32 friction;
+	float32 restitution;
+	float32 tangentSpeed;
+	b2Manifold manifold;
+};
+
 /// The class manages contact between two shapes. A contact exists for each overlapping
 /// AABB in the broad-phase (except if filtered). Therefore a contact object may exist
 /// that has no contact points.
@@ -101,6 +135,9 @@ public:
 	b2Contact* GetNext();
 	const b2Contact* GetNext() const;
 
+	/// Get a handle that can be used to look this contact up later.
+	b2ContactHandle GetHandle() const;
+
 	/// Get fixture A in this contact.
 	b2Fixture* GetFixtureA();
 	const b2Fixture* GetFixtureA() const;
@@ -148,10 +185,11 @@ protected:
 	friend class b2ContactManager;
 	friend class b2World;
 	friend class b2ContactSolver;
+	friend class b2SoftContactSolver;
 	friend class b2Body;
 	friend class b2Fixture;
 
-	// Flags stored in m_flags
+	// Flags stored in b2ContactState::flags
 	enum
 	{
 		// Used when crawling contact graph when forming islands.
@@ -169,7 +207,7 @@ protected:
 		// This bullet contact had a TOI event
 		e_bulletHitFlag		= 0x0010,
 
-		// This contact has a valid TOI in m_toi
+		// This contact has a valid TOI in b2ContactState::toi
 		e_toiFlag			= 0x0020
 	};
 
@@ -187,16 +225,17 @@ protected:
 	b2Contact(b2Fixture* fixtureA, int32 indexA, b2Fixture* fixtureB, int32 indexB);
 	virtual ~b2Contact() {}
 
-	void Update(b2ContactListener* listener);
+	void Update(b2ContactListener* listener, b2ImpulseCache* cache);
 
 	static b2ContactRegister s_registers[b2Shape::e_typeCount][b2Shape::e_typeCount];
-	static bool s_initialized;
+	static volatile int32 s_initialized;
 
-	uint32 m_flags;
+	// Hot data in the contact manager's pool. The pool keeps this pointer current.
+	b2ContactState* m_state;
 
-	// World pool and list pointers.
-	b2Contact* m_prev;
-	b2Contact* m_next;
+	// Slot in the contact manager's handle table.
+	int32 m_id;
+	uint32 m_generation;
 
 	// Nodes for connecting bodies.
 	b2ContactEdge m_nodeA;
@@ -207,26 +246,16 @@ protected:
 
 	int32 m_indexA;
 	int32 m_indexB;
-
-	b2Manifold m_manifold;
-
-	int32 m_toiCount;
-	float32 m_toi;
-
-	float32 m_friction;
-	float32 m_restitution;
-
-	float32 m_tangentSpeed;
 };
 
 inline b2Manifold* b2Contact::GetManifold()
 {
-	return &m_manifold;
+	return &m_state->manifold;
 }
 
 inline const b2Manifold* b2Contact::GetManifold() const
 {
-	return &m_manifold;
+	return &m_state->manifold;
 }
 
 inline void b2Contact::GetWorldManifold(b2WorldManifold* worldManifold) const
@@ -236,39 +265,48 @@ inline void b2Contact::GetWorldManifold(b2WorldManifold* worldManifold) const
 	const b2Shape* shapeA = m_fixtureA->GetShape();
 	const b2Shape* shapeB = m_fixtureB->GetShape();
 
-	worldManifold->Initialize(&m_manifold, bodyA->GetTransform(), shapeA->m_radius, bodyB->GetTransform(), shapeB->m_radius);
+	worldManifold->Initialize(&m_state->manifold, bodyA->GetTransform(), shapeA->m_radius, bodyB->GetTransform(), shapeB->m_radius);
 }
 
 inline void b2Contact::SetEnabled(bool flag)
 {
 	if (flag)
 	{
-		m_flags |= e_enabledFlag;
+		m_state->flags |= e_enabledFlag;
 	}
 	else
 	{
-		m_flags &= ~e_enabledFlag;
+		m_state->flags &= ~e_enabledFlag;
 	}
 }
 
 inline bool b2Contact::IsEnabled() const
 {
-	return (m_flags & e_enabledFlag) == e_enabledFlag;
+	return (m_state->flags & e_enabledFlag) == e_enabledFlag;
 }
 
 inline bool b2Contact::IsTouching() const
 {
-	return (m_flags & e_touchingFlag) == e_touchingFlag;
+	return (m_state->flags & e_touchingFlag) == e_touchingFlag;
 }
 
+// The pool always holds a terminating entry with a NULL contact.
 inline b2Contact* b2Contact::GetNext()
 {
-	return m_next;
+	return (m_state + 1)->contact;
 }
 
 inline const b2Contact* b2Contact::GetNext() const
 {
-	return m_next;
+	return (m_state + 1)->contact;
+}
+
+inline b2ContactHandle b2Contact::GetHandle() const
+{
+	b2ContactHandle handle;
+	handle.id = m_id;
+	handle.generation = m_generation;
+	return handle;
 }
 
 inline b2Fixture* b2Contact::GetFixtureA()
@@ -303,47 +341,47 @@ inline int32 b2Contact::GetChildIndexB() const
 
 inline void b2Contact::FlagForFiltering()
 {
-	m_flags |= e_filterFlag;
+	m_state->flags |= e_filterFlag;
 }
 
 inline void b2Contact::SetFriction(float32 friction)
 {
-	m_friction = friction;
+	m_state->friction = friction;
 }
 
 inline float32 b2Contact::GetFriction() const
 {
-	return m_friction;
+	return m_state->friction;
 }
 
 inline void b2Contact::ResetFriction()
 {
-	m_friction = b2MixFriction(m_fixtureA->m_friction, m_fixtureB->m_friction);
+	m_state->friction = b2MixFriction(m_fixtureA->m_friction, m_fixtureB->m_friction);
 }
 
 inline void b2Contact::SetRestitution(float32 restitution)
 {
-	m_restitution = restitution;
+	m_state->restitution = restitution;
 }
 
 inline float32 b2Contact::GetRestitution() const
 {
-	return m_restitution;
+	return m_state->restitution;
 }
 
 inline void b2Contact::ResetRestitution()
 {
-	m_restitution = b2MixRestitution(m_fixtureA->m_restitution, m_fixtureB->m_restitution);
+	m_state->restitution = b2MixRestitution(m_fixtureA->m_restitution, m_fixtureB->m_restitution);
 }
 
 inline void b2Contact::SetTangentSpeed(float32 speed)
 {
-	m_tangentSpeed = speed;
+	m_state->tangentSpeed = speed;
 }
 
 inline float32 b2Contact::GetTangentSpeed() const
 {
-	return m_tangentSpeed;
+	return m_state->tangentSpeed;
 }
 
 #endif
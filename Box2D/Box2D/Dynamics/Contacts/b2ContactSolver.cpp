@@ -55,25 +55,25 @@ b2ContactSolver::b2ContactSolver(b2ContactSolverDef* def)
 	// Initialize position independent portions of the constraints.
 	for (int32 i = 0; i < m_count; ++i)
 	{
-		b2Contact* contact = m_contacts[i];
+		const b2ContactState* state = m_contacts[i]->m_state;
 
-		b2Fixture* fixtureA = contact->m_fixtureA;
-		b2Fixture* fixtureB = contact->m_fixtureB;
+		b2Fixture* fixtureA = state->fixtureA;
+		b2Fixture* fixtureB = state->fixtureB;
 		b2Shape* shapeA = fixtureA->GetShape();
 		b2Shape* shapeB = fixtureB->GetShape();
 		float32 radiusA = shapeA->m_radius;
 		float32 radiusB = shapeB->m_radius;
 		b2Body* bodyA = fixtureA->GetBody();
 		b2Body* bodyB = fixtureB->GetBody();
-		b2Manifold* manifold = contact->GetManifold();
+		const b2Manifold* manifold = &state->manifold;
 
 		int32 pointCount = manifold->pointCount;
 		b2Assert(pointCount > 0);
 
 		b2ContactVelocityConstraint* vc = m_velocityConstraints + i;
-		vc->friction = contact->m_friction;
-		vc->restitution = contact->m_restitution;
-		vc->tangentSpeed = contact->m_tangentSpeed;
+		vc->friction = state->friction;
+		vc->restitution = state->restitution;
+		vc->tangentSpeed = state->tangentSpeed;
 		vc->indexA = bodyA->m_islandIndex;
 		vc->indexB = bodyB->m_islandIndex;
 		vc->invMassA = bodyA->m_invMass;
@@ -103,7 +103,7 @@ b2ContactSolver::b2ContactSolver(b2ContactSolverDef* def)
 
 		for (int32 j = 0; j < pointCount; ++j)
 		{
-			b2ManifoldPoint* cp = manifold->points + j;
+			const b2ManifoldPoint* cp = manifold->points + j;
 			b2VelocityConstraintPoint* vcp = vc->points + j;
 	
 			if (m_step.warmStarting)
@@ -137,7 +137,12 @@ b2ContactSolver::~b2ContactSolver()
 // Initialize position dependent portions of the velocity constraints.
 void b2ContactSolver::InitializeVelocityConstraints()
 {
-	for (int32 i = 0; i < m_count; ++i)
+	InitializeVelocityConstraints(0, m_count);
+}
+
+void b2ContactSolver::InitializeVelocityConstraints(int32 begin, int32 end)
+{
+	for (int32 i = begin; i < end; ++i)
 	{
 		b2ContactVelocityConstraint* vc = m_velocityConstraints + i;
 		b2ContactPositionConstraint* pc = m_positionConstraints + i;
@@ -247,9 +252,14 @@ void b2ContactSolver::InitializeVelocityConstraints()
 }
 
 void b2ContactSolver::WarmStart()
+{
+	WarmStart(0, m_count);
+}
+
+void b2ContactSolver::WarmStart(int32 begin, int32 end)
 {
 	// Warm start.
-	for (int32 i = 0; i < m_count; ++i)
+	for (int32 i = begin; i < end; ++i)
 	{
 		b2ContactVelocityConstraint* vc = m_velocityConstraints + i;
 
@@ -279,16 +289,30 @@ void b2ContactSolver::WarmStart()
 			vB += mB * P;
 		}
 
-		m_velocities[indexA].v = vA;
-		m_velocities[indexA].w = wA;
-		m_velocities[indexB].v = vB;
-		m_velocities[indexB].w = wB;
+		// Bodies that can't move are shared by constraints solved in parallel,
+		// so they are never written.
+		if (mA != 0.0f || iA != 0.0f)
+		{
+			m_velocities[indexA].v = vA;
+			m_velocities[indexA].w = wA;
+		}
+
+		if (mB != 0.0f || iB != 0.0f)
+		{
+			m_velocities[indexB].v = vB;
+			m_velocities[indexB].w = wB;
+		}
 	}
 }
 
 void b2ContactSolver::SolveVelocityConstraints()
 {
-	for (int32 i = 0; i < m_count; ++i)
+	SolveVelocityConstraints(0, m_count);
+}
+
+void b2ContactSolver::SolveVelocityConstraints(int32 begin, int32 end)
+{
+	for (int32 i = begin; i < end; ++i)
 	{
 		b2ContactVelocityConstraint* vc = m_velocityConstraints + i;
 
@@ -589,10 +613,18 @@ void b2ContactSolver::SolveVelocityConstraints()
 			}
 		}
 
-		m_velocities[indexA].v = vA;
-		m_velocities[indexA].w = wA;
-		m_velocities[indexB].v = vB;
-		m_velocities[indexB].w = wB;
+		// See WarmStart.
+		if (mA != 0.0f || iA != 0.0f)
+		{
+			m_velocities[indexA].v = vA;
+			m_velocities[indexA].w = wA;
+		}
+
+		if (mB != 0.0f || iB != 0.0f)
+		{
+			m_velocities[indexB].v = vB;
+			m_velocities[indexB].w = wB;
+		}
 	}
 }
 
@@ -664,10 +696,19 @@ struct b2PositionSolverManifold
 
 // Sequential solver.
 bool b2ContactSolver::SolvePositionConstraints()
+{
+	float32 minSeparation = SolvePositionConstraints(0, m_count);
+
+	// We can't expect minSpeparation >= -b2_linearSlop because we don't
+	// push the separation above -b2_linearSlop.
+	return minSeparation >= -3.0f * b2_linearSlop;
+}
+
+float32 b2ContactSolver::SolvePositionConstraints(int32 begin, int32 end)
 {
 	float32 minSeparation = 0.0f;
 
-	for (int32 i = 0; i < m_count; ++i)
+	for (int32 i = begin; i < end; ++i)
 	{
 		b2ContactPositionConstraint* pc = m_positionConstraints + i;
 
@@ -729,16 +770,21 @@ bool b2ContactSolver::SolvePositionConstraints()
 			aB += iB * b2Cross(rB, P);
 		}
 
-		m_positions[indexA].c = cA;
-		m_positions[indexA].a = aA;
+		// See WarmStart.
+		if (mA != 0.0f || iA != 0.0f)
+		{
+			m_positions[indexA].c = cA;
+			m_positions[indexA].a = aA;
+		}
 
-		m_positions[indexB].c = cB;
-		m_positions[indexB].a = aB;
+		if (mB != 0.0f || iB != 0.0f)
+		{
+			m_positions[indexB].c = cB;
+			m_positions[indexB].a = aB;
+		}
 	}
 
-	// We can't expect minSpeparation >= -b2_linearSlop because we don't
-	// push the separation above -b2_linearSlop.
-	return minSeparation >= -3.0f * b2_linearSlop;
+	return minSeparation;
 }
 
 // Sequential position solver for position constraints.
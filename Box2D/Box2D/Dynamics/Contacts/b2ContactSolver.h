@@ -79,6 +79,15 @@ public:
 	void StoreImpulses();
 
 	bool SolvePositionConstraints();
+
+	// Solve a range of constraints. The colored island solver calls these
+	// concurrently on ranges that don't share a dynamic body.
+	void InitializeVelocityConstraints(int32 begin, int32 end);
+	void WarmStart(int32 begin, int32 end);
+	void SolveVelocityConstraints(int32 begin, int32 end);
+
+	// Returns the minimum separation of the range.
+	float32 SolvePositionConstraints(int32 begin, int32 end);
 	bool SolveTOIPositionConstraints(int32 toiIndexA, int32 toiIndexB);
 
 	b2TimeStep m_step;
@@ -0,0 +1,406 @@
+/*
+* Copyright (c) 2006-2009 Erin Catto http://www.box2d.org
+*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include <Box2D/Dynamics/Contacts/b2SoftContactSolver.h>
+
+#include <Box2D/Dynamics/Contacts/b2Contact.h>
+#include <Box2D/Dynamics/b2Body.h>
+#include <Box2D/Dynamics/b2Fixture.h>
+#include <Box2D/Dynamics/b2World.h>
+#include <Box2D/Common/b2StackAllocator.h>
+
+// A spring with a damper that is stiff in relation to the sub-step. The mass
+// and impulse scales come from solving the spring implicitly.
+static b2Softness b2MakeSoftness(float32 hertz, float32 dampingRatio, float32 h)
+{
+	float32 omega = 2.0f * b2_pi * hertz;
+	float32 a1 = 2.0f * dampingRatio + h * omega;
+	float32 a2 = h * omega * a1;
+	float32 a3 = 1.0f / (1.0f + a2);
+
+	b2Softness softness;
+	softness.biasRate = a1 > 0.0f ? omega / a1 : 0.0f;
+	softness.massScale = a2 * a3;
+	softness.impulseScale = a3;
+	return softness;
+}
+
+b2SoftContactSolver::b2SoftContactSolver(b2ContactSolverDef* def, int32 subStepCount)
+{
+	b2Assert(subStepCount > 0);
+
+	m_step = def->step;
+	m_allocator = def->allocator;
+	m_count = def->count;
+	m_constraints = (b2SoftContactConstraint*)m_allocator->Allocate(m_count * sizeof(b2SoftContactConstraint));
+	m_positions = def->positions;
+	m_velocities = def->velocities;
+	m_contacts = def->contacts;
+	m_minSeparation = 0.0f;
+
+	float32 h = m_step.dt / subStepCount;
+	m_inv_h = h > 0.0f ? 1.0f / h : 0.0f;
+
+	float32 hertz = b2Min(b2_contactHertz, 0.25f * m_inv_h);
+	m_softness = b2MakeSoftness(hertz, b2_contactDampingRatio, h);
+	m_staticSoftness = b2MakeSoftness(2.0f * hertz, b2_contactDampingRatio, h);
+}
+
+b2SoftContactSolver::~b2SoftContactSolver()
+{
+	m_allocator->Free(m_constraints);
+}
+
+void b2SoftContactSolver::Prepare()
+{
+	for (int32 i = 0; i < m_count; ++i)
+	{
+		const b2ContactState* state = m_contacts[i]->m_state;
+
+		b2Fixture* fixtureA = state->fixtureA;
+		b2Fixture* fixtureB = state->fixtureB;
+		float32 radiusA = fixtureA->GetShape()->m_radius;
+		float32 radiusB = fixtureB->GetShape()->m_radius;
+		b2Body* bodyA = fixtureA->GetBody();
+		b2Body* bodyB = fixtureB->GetBody();
+		const b2Manifold* manifold = &state->manifold;
+
+		int32 pointCount = manifold->pointCount;
+		b2Assert(pointCount > 0);
+
+		b2SoftContactConstraint* sc = m_constraints + i;
+		sc->friction = state->friction;
+		sc->restitution = state->restitution;
+		sc->tangentSpeed = state->tangentSpeed;
+		sc->indexA = bodyA->m_islandIndex;
+		sc->indexB = bodyB->m_islandIndex;
+		sc->invMassA = bodyA->m_invMass;
+		sc->invMassB = bodyB->m_invMass;
+		sc->invIA = bodyA->m_invI;
+		sc->invIB = bodyB->m_invI;
+		sc->pointCount = pointCount;
+
+		bool staticContact = bodyA->m_type == b2_staticBody || bodyB->m_type == b2_staticBody;
+		sc->softness = staticContact ? m_staticSoftness : m_softness;
+
+		float32 mA = sc->invMassA;
+		float32 mB = sc->invMassB;
+		float32 iA = sc->invIA;
+		float32 iB = sc->invIB;
+
+		b2Vec2 cA = m_positions[sc->indexA].c;
+		float32 aA = m_positions[sc->indexA].a;
+		b2Vec2 vA = m_velocities[sc->indexA].v;
+		float32 wA = m_velocities[sc->indexA].w;
+
+		b2Vec2 cB = m_positions[sc->indexB].c;
+		float32 aB = m_positions[sc->indexB].a;
+		b2Vec2 vB = m_velocities[sc->indexB].v;
+		float32 wB = m_velocities[sc->indexB].w;
+
+		sc->cA0 = cA;
+		sc->aA0 = aA;
+		sc->cB0 = cB;
+		sc->aB0 = aB;
+
+		b2Transform xfA, xfB;
+		xfA.q.Set(aA);
+		xfB.q.Set(aB);
+		xfA.p = cA - b2Mul(xfA.q, bodyA->m_sweep.localCenter);
+		xfB.p = cB - b2Mul(xfB.q, bodyB->m_sweep.localCenter);
+
+		b2WorldManifold worldManifold;
+		worldManifold.Initialize(manifold, xfA, radiusA, xfB, radiusB);
+
+		b2Vec2 normal = worldManifold.normal;
+		b2Vec2 tangent = b2Cross(normal, 1.0f);
+		sc->normal = normal;
+
+		for (int32 j = 0; j < pointCount; ++j)
+		{
+			const b2ManifoldPoint* mp = manifold->points + j;
+			b2SoftContactPoint* cp = sc->points + j;
+
+			if (m_step.warmStarting)
+			{
+				cp->normalImpulse = m_step.dtRatio * mp->normalImpulse;
+				cp->tangentImpulse = m_step.dtRatio * mp->tangentImpulse;
+			}
+			else
+			{
+				cp->normalImpulse = 0.0f;
+				cp->tangentImpulse = 0.0f;
+			}
+
+			cp->totalNormalImpulse = 0.0f;
+			cp->totalTangentImpulse = 0.0f;
+			cp->maxNormalImpulse = 0.0f;
+
+			cp->rA = worldManifold.points[j] - cA;
+			cp->rB = worldManifold.points[j] - cB;
+
+			// The separation is tracked relative to the anchors at the start of the step.
+			cp->baseSeparation = worldManifold.separations[j] - b2Dot(cp->rB - cp->rA, normal);
+
+			float32 rnA = b2Cross(cp->rA, normal);
+			float32 rnB = b2Cross(cp->rB, normal);
+			float32 kNormal = mA + mB + iA * rnA * rnA + iB * rnB * rnB;
+			cp->normalMass = kNormal > 0.0f ? 1.0f / kNormal : 0.0f;
+
+			float32 rtA = b2Cross(cp->rA, tangent);
+			float32 rtB = b2Cross(cp->rB, tangent);
+			float32 kTangent = mA + mB + iA * rtA * rtA + iB * rtB * rtB;
+			cp->tangentMass = kTangent > 0.0f ? 1.0f / kTangent : 0.0f;
+
+			// Save the approach speed for restitution.
+			cp->relativeVelocity = b2Dot(normal, vB + b2Cross(wB, cp->rB) - vA - b2Cross(wA, cp->rA));
+		}
+	}
+}
+
+void b2SoftContactSolver::WarmStart()
+{
+	for (int32 i = 0; i < m_count; ++i)
+	{
+		b2SoftContactConstraint* sc = m_constraints + i;
+
+		int32 indexA = sc->indexA;
+		int32 indexB = sc->indexB;
+		float32 mA = sc->invMassA;
+		float32 iA = sc->invIA;
+		float32 mB = sc->invMassB;
+		float32 iB = sc->invIB;
+
+		b2Vec2 vA = m_velocities[indexA].v;
+		float32 wA = m_velocities[indexA].w;
+		b2Vec2 vB = m_velocities[indexB].v;
+		float32 wB = m_velocities[indexB].w;
+
+		b2Vec2 normal = sc->normal;
+		b2Vec2 tangent = b2Cross(normal, 1.0f);
+
+		for (int32 j = 0; j < sc->pointCount; ++j)
+		{
+			b2SoftContactPoint* cp = sc->points + j;
+			b2Vec2 P = cp->normalImpulse * normal + cp->tangentImpulse * tangent;
+			wA -= iA * b2Cross(cp->rA, P);
+			vA -= mA * P;
+			wB += iB * b2Cross(cp->rB, P);
+			vB += mB * P;
+		}
+
+		m_velocities[indexA].v = vA;
+		m_velocities[indexA].w = wA;
+		m_velocities[indexB].v = vB;
+		m_velocities[indexB].w = wB;
+	}
+}
+
+void b2SoftContactSolver::Solve(bool useBias)
+{
+	float32 minSeparation = 0.0f;
+
+	for (int32 i = 0; i < m_count; ++i)
+	{
+		b2SoftContactConstraint* sc = m_constraints + i;
+
+		int32 indexA = sc->indexA;
+		int32 indexB = sc->indexB;
+		float32 mA = sc->invMassA;
+		float32 iA = sc->invIA;
+		float32 mB = sc->invMassB;
+		float32 iB = sc->invIB;
+		int32 pointCount = sc->pointCount;
+
+		b2Vec2 vA = m_velocities[indexA].v;
+		float32 wA = m_velocities[indexA].w;
+		b2Vec2 vB = m_velocities[indexB].v;
+		float32 wB = m_velocities[indexB].w;
+
+		// Body motion since the start of the step.
+		b2Vec2 dc = (m_positions[indexB].c - sc->cB0) - (m_positions[indexA].c - sc->cA0);
+		b2Rot qA(m_positions[indexA].a - sc->aA0);
+		b2Rot qB(m_positions[indexB].a - sc->aB0);
+
+		b2Vec2 normal = sc->normal;
+		b2Vec2 tangent = b2Cross(normal, 1.0f);
+
+		// Solve normal constraints
+		for (int32 j = 0; j < pointCount; ++j)
+		{
+			b2SoftContactPoint* cp = sc->points + j;
+
+			// Compute the current separation.
+			b2Vec2 d = dc + b2Mul(qB, cp->rB) - b2Mul(qA, cp->rA);
+			float32 separation = b2Dot(d, normal) + cp->baseSeparation;
+			minSeparation = b2Min(minSeparation, separation);
+
+			float32 bias = 0.0f;
+			float32 massScale = 1.0f;
+			float32 impulseScale = 0.0f;
+			if (separation > 0.0f)
+			{
+				// Speculative contact: only remove the approach speed that would close the gap.
+				bias = separation * m_inv_h;
+			}
+			else if (useBias)
+			{
+				bias = b2Max(sc->softness.biasRate * separation, -b2_contactPushoutVelocity);
+				massScale = sc->softness.massScale;
+				impulseScale = sc->softness.impulseScale;
+			}
+
+			// Relative velocity at contact
+			b2Vec2 dv = vB + b2Cross(wB, cp->rB) - vA - b2Cross(wA, cp->rA);
+			float32 vn = b2Dot(dv, normal);
+
+			// Compute the normal impulse and clamp the accumulated impulse.
+			float32 impulse = -cp->normalMass * massScale * (vn + bias) - impulseScale * cp->normalImpulse;
+			float32 newImpulse = b2Max(cp->normalImpulse + impulse, 0.0f);
+			impulse = newImpulse - cp->normalImpulse;
+			cp->normalImpulse = newImpulse;
+			cp->maxNormalImpulse = b2Max(cp->maxNormalImpulse, impulse);
+
+			// Apply contact impulse
+			b2Vec2 P = impulse * normal;
+			vA -= mA * P;
+			wA -= iA * b2Cross(cp->rA, P);
+
+			vB += mB * P;
+			wB += iB * b2Cross(cp->rB, P);
+		}
+
+		// Solve tangent constraints
+		float32 friction = sc->friction;
+		for (int32 j = 0; j < pointCount; ++j)
+		{
+			b2SoftContactPoint* cp = sc->points + j;
+
+			b2Vec2 dv = vB + b2Cross(wB, cp->rB) - vA - b2Cross(wA, cp->rA);
+			float32 vt = b2Dot(dv, tangent) - sc->tangentSpeed;
+			float32 lambda = cp->tangentMass * (-vt);
+
+			// b2Clamp the accumulated force
+			float32 maxFriction = friction * cp->normalImpulse;
+			float32 newImpulse = b2Clamp(cp->tangentImpulse + lambda, -maxFriction, maxFriction);
+			lambda = newImpulse - cp->tangentImpulse;
+			cp->tangentImpulse = newImpulse;
+
+			// Apply contact impulse
+			b2Vec2 P = lambda * tangent;
+
+			vA -= mA * P;
+			wA -= iA * b2Cross(cp->rA, P);
+
+			vB += mB * P;
+			wB += iB * b2Cross(cp->rB, P);
+		}
+
+		if (useBias == false)
+		{
+			// The sub-step is done. Its impulses add up to the impulse of the step.
+			for (int32 j = 0; j < pointCount; ++j)
+			{
+				b2SoftContactPoint* cp = sc->points + j;
+				cp->totalNormalImpulse += cp->normalImpulse;
+				cp->totalTangentImpulse += cp->tangentImpulse;
+			}
+		}
+
+		m_velocities[indexA].v = vA;
+		m_velocities[indexA].w = wA;
+		m_velocities[indexB].v = vB;
+		m_velocities[indexB].w = wB;
+	}
+
+	m_minSeparation = minSeparation;
+}
+
+void b2SoftContactSolver::ApplyRestitution()
+{
+	for (int32 i = 0; i < m_count; ++i)
+	{
+		b2SoftContactConstraint* sc = m_constraints + i;
+		if (sc->restitution == 0.0f)
+		{
+			continue;
+		}
+
+		int32 indexA = sc->indexA;
+		int32 indexB = sc->indexB;
+		float32 mA = sc->invMassA;
+		float32 iA = sc->invIA;
+		float32 mB = sc->invMassB;
+		float32 iB = sc->invIB;
+
+		b2Vec2 vA = m_velocities[indexA].v;
+		float32 wA = m_velocities[indexA].w;
+		b2Vec2 vB = m_velocities[indexB].v;
+		float32 wB = m_velocities[indexB].w;
+
+		b2Vec2 normal = sc->normal;
+
+		for (int32 j = 0; j < sc->pointCount; ++j)
+		{
+			b2SoftContactPoint* cp = sc->points + j;
+
+			// Only bounce points that were approaching fast and were actually pushed.
+			if (cp->relativeVelocity > -b2_velocityThreshold || cp->maxNormalImpulse == 0.0f)
+			{
+				continue;
+			}
+
+			b2Vec2 dv = vB + b2Cross(wB, cp->rB) - vA - b2Cross(wA, cp->rA);
+			float32 vn = b2Dot(dv, normal);
+
+			float32 impulse = -cp->normalMass * (vn + sc->restitution * cp->relativeVelocity);
+			float32 newImpulse = b2Max(cp->normalImpulse + impulse, 0.0f);
+			impulse = newImpulse - cp->normalImpulse;
+			cp->normalImpulse = newImpulse;
+			cp->maxNormalImpulse = b2Max(cp->maxNormalImpulse, impulse);
+			cp->totalNormalImpulse += impulse;
+
+			b2Vec2 P = impulse * normal;
+			vA -= mA * P;
+			wA -= iA * b2Cross(cp->rA, P);
+
+			vB += mB * P;
+			wB += iB * b2Cross(cp->rB, P);
+		}
+
+		m_velocities[indexA].v = vA;
+		m_velocities[indexA].w = wA;
+		m_velocities[indexB].v = vB;
+		m_velocities[indexB].w = wB;
+	}
+}
+
+void b2SoftContactSolver::StoreImpulses()
+{
+	for (int32 i = 0; i < m_count; ++i)
+	{
+		b2SoftContactConstraint* sc = m_constraints + i;
+		b2Manifold* manifold = m_contacts[i]->GetManifold();
+
+		for (int32 j = 0; j < sc->pointCount; ++j)
+		{
+			manifold->points[j].normalImpulse = sc->points[j].normalImpulse;
+			manifold->points[j].tangentImpulse = sc->points[j].tangentImpulse;
+		}
+	}
+}
@@ -0,0 +1,112 @@
+/*
+* Copyright (c) 2006-2009 Erin Catto http://www.box2d.org
+*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#ifndef B2_SOFT_CONTACT_SOLVER_H
+#define B2_SOFT_CONTACT_SOLVER_H
+
+#include <Box2D/Dynamics/Contacts/b2ContactSolver.h>
+
+/// The coefficients of a soft constraint for a given sub-step.
+struct b2Softness
+{
+	float32 biasRate;
+	float32 massScale;
+	float32 impulseScale;
+};
+
+struct b2SoftContactPoint
+{
+	b2Vec2 rA;
+	b2Vec2 rB;
+	float32 baseSeparation;
+	float32 normalImpulse;
+	float32 tangentImpulse;
+	float32 totalNormalImpulse;
+	float32 totalTangentImpulse;
+	float32 maxNormalImpulse;
+	float32 normalMass;
+	float32 tangentMass;
+	float32 relativeVelocity;
+};
+
+struct b2SoftContactConstraint
+{
+	b2SoftContactPoint points[b2_maxManifoldPoints];
+	b2Vec2 normal;
+	b2Vec2 cA0, cB0;
+	float32 aA0, aB0;
+	int32 indexA;
+	int32 indexB;
+	float32 invMassA, invMassB;
+	float32 invIA, invIB;
+	float32 friction;
+	float32 restitution;
+	float32 tangentSpeed;
+	b2Softness softness;
+	int32 pointCount;
+};
+
+/// Contact solver for the soft step. Each step is divided into sub-steps that
+/// solve the contacts once with a soft constraint and then relax them once without
+/// the position bias. The contact anchors and normal are fixed at the start of
+/// the step, and the separation is updated from the body motion, so no position
+/// iterations are needed.
+/// This is an internal class.
+class b2SoftContactSolver
+{
+public:
+	/// The step in the definition is the full step.
+	b2SoftContactSolver(b2ContactSolverDef* def, int32 subStepCount);
+	~b2SoftContactSolver();
+
+	/// Compute the anchors and masses from the body state at the start of the step.
+	void Prepare();
+
+	void WarmStart();
+
+	/// Solve the contacts for one sub-step. The position bias is only applied
+	/// if useBias is true. Without it the pass ends the sub-step.
+	void Solve(bool useBias);
+
+	/// Apply restitution once the sub-steps are done.
+	void ApplyRestitution();
+
+	void StoreImpulses();
+
+	/// The smallest separation found by the last pass.
+	float32 GetMinSeparation() const { return m_minSeparation; }
+
+	b2SoftContactConstraint* m_constraints;
+	b2Position* m_positions;
+	b2Velocity* m_velocities;
+	b2StackAllocator* m_allocator;
+	b2Contact** m_contacts;
+	int32 m_count;
+
+	b2TimeStep m_step;
+	float32 m_inv_h;
+
+	// Contact softness. Contacts with a static body are twice as stiff since
+	// only one body can move.
+	b2Softness m_softness;
+	b2Softness m_staticSoftness;
+
+	float32 m_minSeparation;
+};
+
+#endif
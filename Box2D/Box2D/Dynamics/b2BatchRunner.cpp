@@ -0,0 +1,607 @@
+/*
+* Copyright (c) 2006-2009 Erin Catto http://www.box2d.org
+*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include <Box2D/Dynamics/b2BatchRunner.h>
+#include <Box2D/Dynamics/b2BodyPrefab.h>
+#include <Box2D/Dynamics/b2Fixture.h>
+#include <Box2D/Dynamics/b2World.h>
+#include <Box2D/Collision/Shapes/b2ChainShape.h>
+#include <Box2D/Collision/Shapes/b2CircleShape.h>
+#include <Box2D/Collision/Shapes/b2EdgeShape.h>
+#include <Box2D/Collision/Shapes/b2PolygonShape.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <new>
+
+class b2BatchTask : public b2Task
+{
+public:
+	void Execute(int32 begin, int32 end, int32 workerIndex)
+	{
+		B2_NOT_USED(workerIndex);
+		for (int32 i = begin; i < end; ++i)
+		{
+			m_runner->GetParameters(i, m_runner->m_outcomes + i);
+			m_runner->Simulate(m_runner->m_outcomes + i);
+		}
+	}
+
+	const b2BatchRunner* m_runner;
+};
+
+// Read the next word of the scene, skipping white space and comments.
+static bool b2ReadWord(FILE* file, char* word, int32 size)
+{
+	int32 c = fgetc(file);
+	for (;;)
+	{
+		while (c == ' ' || c == '\t' || c == '\r' || c == '\n')
+		{
+			c = fgetc(file);
+		}
+
+		if (c != '#')
+		{
+			break;
+		}
+
+		while (c != '\n' && c != EOF)
+		{
+			c = fgetc(file);
+		}
+	}
+
+	int32 length = 0;
+	while (c != EOF && c != ' ' && c != '\t' && c != '\r' && c != '\n')
+	{
+		if (length < size - 1)
+		{
+			word[length++] = (char)c;
+		}
+		c = fgetc(file);
+	}
+
+	word[length] = 0;
+	return length > 0;
+}
+
+static bool b2ReadFloats(FILE* file, float32* values, int32 count)
+{
+	char word[32];
+	for (int32 i = 0; i < count; ++i)
+	{
+		char* end;
+		if (b2ReadWord(file, word, sizeof(word)) == false)
+		{
+			return false;
+		}
+
+		values[i] = (float32)strtod(word, &end);
+		if (*end != 0)
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+// Read a vertex count followed by the vertices. The caller frees the vertices.
+static b2Vec2* b2ReadVertices(FILE* file, int32 minCount, int32 maxCount, int32* count)
+{
+	float32 value;
+	if (b2ReadFloats(file, &value, 1) == false || value < minCount || value > maxCount)
+	{
+		return NULL;
+	}
+
+	*count = (int32)value;
+	b2Vec2* vertices = (b2Vec2*)b2Alloc(*count * sizeof(b2Vec2));
+	for (int32 i = 0; i < *count; ++i)
+	{
+		float32 v[2];
+		if (b2ReadFloats(file, v, 2) == false)
+		{
+			b2Free(vertices);
+			return NULL;
+		}
+
+		vertices[i].Set(v[0], v[1]);
+	}
+
+	return vertices;
+}
+
+// A random number in [0, 1) that only depends on the seed, the run and the parameter.
+static float32 b2BatchRandom(uint32 seed, int32 run, int32 parameter)
+{
+	uint32 x = seed ^ ((uint32)run * 0x9E3779B9u) ^ ((uint32)parameter * 0x85EBCA6Bu);
+	x ^= x >> 16;
+	x *= 0x7FEB352Du;
+	x ^= x >> 15;
+	x *= 0x846CA68Bu;
+	x ^= x >> 16;
+	return (float32)(x >> 8) / 16777216.0f;
+}
+
+b2BatchRunner::b2BatchRunner(const b2BatchDef* def)
+{
+	b2Assert(def->timeStep > 0.0f);
+	b2Assert(def->spawnTime.count >= 1 && def->restitution.count >= 1 && def->friction.count >= 1);
+
+	m_def = *def;
+
+	m_bodyCount = 0;
+	m_bodyCapacity = 0;
+	m_bodyDefs = NULL;
+	m_prefabs = NULL;
+
+	m_outcomes = NULL;
+	m_outcomeCount = 0;
+
+	Clear();
+}
+
+b2BatchRunner::~b2BatchRunner()
+{
+	Clear();
+	b2Free(m_bodyDefs);
+	b2Free(m_prefabs);
+	b2Free(m_outcomes);
+}
+
+void b2BatchRunner::Clear()
+{
+	for (int32 i = 0; i < m_bodyCount; ++i)
+	{
+		if (m_prefabs[i])
+		{
+			m_prefabs[i]->~b2BodyPrefab();
+			b2Free(m_prefabs[i]);
+		}
+	}
+
+	m_bodyCount = 0;
+	m_bounds.lowerBound.Set(b2_maxFloat, b2_maxFloat);
+	m_bounds.upperBound.Set(-b2_maxFloat, -b2_maxFloat);
+
+	m_gravity.Set(0.0f, -10.0f);
+	m_ballPosition.SetZero();
+	m_ballRadius = 0.0f;
+	m_ballDensity = 0.0f;
+	m_goal.lowerBound.SetZero();
+	m_goal.upperBound.SetZero();
+	m_hasBall = false;
+	m_hasGoal = false;
+}
+
+void b2BatchRunner::AddFixture(const b2Shape* shape, const b2FixtureDef& material)
+{
+	int32 index = m_bodyCount - 1;
+	if (m_prefabs[index] == NULL)
+	{
+		void* mem = b2Alloc(sizeof(b2BodyPrefab));
+		m_prefabs[index] = new (mem) b2BodyPrefab(m_bodyDefs + index);
+	}
+
+	b2FixtureDef fd = material;
+	fd.shape = shape;
+	m_prefabs[index]->AddFixture(&fd);
+
+	b2Transform xf(m_bodyDefs[index].position, b2Rot(m_bodyDefs[index].angle));
+	for (int32 i = 0; i < shape->GetChildCount(); ++i)
+	{
+		b2AABB aabb;
+		shape->ComputeAABB(&aabb, xf, i);
+		m_bounds.Combine(aabb);
+	}
+}
+
+bool b2BatchRunner::LoadScene(const char* fileName)
+{
+	Clear();
+
+	FILE* file = fopen(fileName, "r");
+	if (file == NULL)
+	{
+		b2Log("Can't open the scene %s\n", fileName);
+		return false;
+	}
+
+	b2FixtureDef material;
+	material.density = 1.0f;
+
+	bool ok = true;
+	char word[32];
+	while (ok && b2ReadWord(file, word, sizeof(word)))
+	{
+		float32 v[5];
+		bool needsBody = false;
+
+		if (strcmp(word, "gravity") == 0)
+		{
+			ok = b2ReadFloats(file, v, 2);
+			m_gravity.Set(v[0], v[1]);
+		}
+		else if (strcmp(word, "body") == 0)
+		{
+			b2BodyDef bd;
+			ok = b2ReadWord(file, word, sizeof(word));
+			if (strcmp(word, "static") == 0)
+			{
+				bd.type = b2_staticBody;
+			}
+			else if (strcmp(word, "kinematic") == 0)
+			{
+				bd.type = b2_kinematicBody;
+			}
+			else if (strcmp(word, "dynamic") == 0)
+			{
+				bd.type = b2_dynamicBody;
+			}
+			else
+			{
+				ok = false;
+			}
+
+			ok = ok && b2ReadFloats(file, v, 3);
+			if (ok)
+			{
+				bd.position.Set(v[0], v[1]);
+				bd.angle = v[2];
+
+				if (m_bodyCount == m_bodyCapacity)
+				{
+					m_bodyCapacity = b2Max(2 * m_bodyCapacity, 16);
+					b2BodyDef* defs = (b2BodyDef*)b2Alloc(m_bodyCapacity * sizeof(b2BodyDef));
+					b2BodyPrefab** prefabs = (b2BodyPrefab**)b2Alloc(m_bodyCapacity * sizeof(b2BodyPrefab*));
+					if (m_bodyCount > 0)
+					{
+						memcpy(defs, m_bodyDefs, m_bodyCount * sizeof(b2BodyDef));
+						memcpy(prefabs, m_prefabs, m_bodyCount * sizeof(b2BodyPrefab*));
+					}
+					b2Free(m_bodyDefs);
+					b2Free(m_prefabs);
+					m_bodyDefs = defs;
+					m_prefabs = prefabs;
+				}
+
+				m_bodyDefs[m_bodyCount] = bd;
+				m_prefabs[m_bodyCount] = NULL;
+				++m_bodyCount;
+			}
+		}
+		else if (strcmp(word, "velocity") == 0)
+		{
+			// The prefab copies the body definition at the first shape.
+			ok = m_bodyCount > 0 && m_prefabs[m_bodyCount - 1] == NULL && b2ReadFloats(file, v, 3);
+			if (ok)
+			{
+				m_bodyDefs[m_bodyCount - 1].linearVelocity.Set(v[0], v[1]);
+				m_bodyDefs[m_bodyCount - 1].angularVelocity = v[2];
+			}
+		}
+		else if (strcmp(word, "material") == 0)
+		{
+			ok = b2ReadFloats(file, v, 3);
+			material.density = v[0];
+			material.friction = v[1];
+			material.restitution = v[2];
+		}
+		else if (strcmp(word, "circle") == 0)
+		{
+			ok = needsBody = b2ReadFloats(file, v, 3);
+			if (ok && m_bodyCount > 0)
+			{
+				b2CircleShape shape;
+				shape.m_radius = v[0];
+				shape.m_p.Set(v[1], v[2]);
+				AddFixture(&shape, material);
+			}
+		}
+		else if (strcmp(word, "box") == 0)
+		{
+			ok = needsBody = b2ReadFloats(file, v, 5);
+			if (ok && m_bodyCount > 0)
+			{
+				b2PolygonShape shape;
+				shape.SetAsBox(v[0], v[1], b2Vec2(v[2], v[3]), v[4]);
+				AddFixture(&shape, material);
+			}
+		}
+		else if (strcmp(word, "edge") == 0)
+		{
+			ok = needsBody = b2ReadFloats(file, v, 4);
+			if (ok && m_bodyCount > 0)
+			{
+				b2EdgeShape shape;
+				shape.Set(b2Vec2(v[0], v[1]), b2Vec2(v[2], v[3]));
+				AddFixture(&shape, material);
+			}
+		}
+		else if (strcmp(word, "polygon") == 0 || strcmp(word, "chain") == 0 || strcmp(word, "loop") == 0)
+		{
+			int32 count;
+			bool polygon = strcmp(word, "polygon") == 0;
+			b2Vec2* vertices = polygon ? b2ReadVertices(file, 3, b2_maxPolygonVertices, &count) : b2ReadVertices(file, 2, 1 << 20, &count);
+			ok = needsBody = vertices != NULL;
+			if (ok && m_bodyCount > 0)
+			{
+				if (polygon)
+				{
+					b2PolygonShape shape;
+					shape.Set(vertices, count);
+					AddFixture(&shape, material);
+				}
+				else
+				{
+					b2ChainShape shape;
+					if (strcmp(word, "chain") == 0)
+					{
+						shape.CreateChain(vertices, count);
+					}
+					else
+					{
+						shape.CreateLoop(vertices, count);
+					}
+					AddFixture(&shape, material);
+				}
+			}
+
+			if (vertices)
+			{
+				b2Free(vertices);
+			}
+		}
+		else if (strcmp(word, "ball") == 0)
+		{
+			ok = b2ReadFloats(file, v, 4) && v[2] > 0.0f;
+			m_ballPosition.Set(v[0], v[1]);
+			m_ballRadius = v[2];
+			m_ballDensity = v[3];
+			m_hasBall = ok;
+		}
+		else if (strcmp(word, "goal") == 0)
+		{
+			ok = b2ReadFloats(file, v, 4);
+			m_goal.lowerBound.Set(v[0], v[1]);
+			m_goal.upperBound.Set(v[2], v[3]);
+			m_hasGoal = ok;
+		}
+		else
+		{
+			ok = false;
+		}
+
+		if (needsBody && m_bodyCount == 0)
+		{
+			b2Log("The shape before the first body in the scene %s\n", fileName);
+			ok = false;
+		}
+		else if (ok == false)
+		{
+			b2Log("Bad '%s' in the scene %s\n", word, fileName);
+		}
+	}
+
+	fclose(file);
+
+	if (ok && (m_hasBall == false || m_hasGoal == false))
+	{
+		b2Log("The scene %s needs a ball and a goal\n", fileName);
+		ok = false;
+	}
+
+	if (ok == false)
+	{
+		Clear();
+		return false;
+	}
+
+	b2AABB ballAABB;
+	ballAABB.lowerBound = m_ballPosition - b2Vec2(m_ballRadius, m_ballRadius);
+	ballAABB.upperBound = m_ballPosition + b2Vec2(m_ballRadius, m_ballRadius);
+	m_bounds.Combine(ballAABB);
+	m_bounds.Combine(m_goal);
+
+	return true;
+}
+
+int32 b2BatchRunner::GetRunCount() const
+{
+	if (m_def.sampleCount > 0)
+	{
+		return m_def.sampleCount;
+	}
+
+	return m_def.spawnTime.count * m_def.restitution.count * m_def.friction.count;
+}
+
+void b2BatchRunner::GetParameters(int32 run, b2BatchOutcome* outcome) const
+{
+	const b2BatchRange* ranges[3] = {&m_def.spawnTime, &m_def.restitution, &m_def.friction};
+	float32 values[3];
+
+	// The grid runs through the spawn times first.
+	int32 index = run;
+	for (int32 i = 0; i < 3; ++i)
+	{
+		const b2BatchRange* range = ranges[i];
+
+		float32 alpha;
+		if (m_def.sampleCount > 0)
+		{
+			alpha = b2BatchRandom(m_def.seed, run, i);
+		}
+		else
+		{
+			alpha = range->count > 1 ? (float32)(index % range->count) / (float32)(range->count - 1) : 0.0f;
+			index /= range->count;
+		}
+
+		values[i] = range->lower + alpha * (range->upper - range->lower);
+	}
+
+	outcome->spawnTime = values[0];
+	outcome->restitution = values[1];
+	outcome->friction = values[2];
+}
+
+void b2BatchRunner::Simulate(b2BatchOutcome* outcome) const
+{
+	b2World world(m_gravity);
+
+	for (int32 i = 0; i < m_bodyCount; ++i)
+	{
+		if (m_prefabs[i])
+		{
+			b2Transform xf(m_bodyDefs[i].position, b2Rot(m_bodyDefs[i].angle));
+			world.CreateBodies(m_prefabs[i], &xf, 1, NULL);
+		}
+	}
+
+	b2CircleShape shape;
+	shape.m_radius = m_ballRadius;
+
+	b2FixtureDef fd;
+	fd.shape = &shape;
+	fd.density = m_ballDensity;
+	fd.friction = outcome->friction;
+	fd.restitution = outcome->restitution;
+
+	b2BodyDef bd;
+	bd.type = b2_dynamicBody;
+	bd.position = m_ballPosition;
+	bd.bullet = true;
+
+	outcome->reachedGoal = false;
+	outcome->time = 0.0f;
+	outcome->position = m_ballPosition;
+
+	b2Body* ball = NULL;
+	float32 time = 0.0f;
+	float32 spawnTime = 0.0f;
+	float32 slowTime = 0.0f;
+	for (;;)
+	{
+		if (ball == NULL && time >= outcome->spawnTime)
+		{
+			ball = world.CreateBody(&bd);
+			ball->CreateFixture(&fd);
+			spawnTime = time;
+		}
+
+		world.Step(m_def.timeStep, m_def.velocityIterations, m_def.positionIterations);
+		time += m_def.timeStep;
+
+		if (ball == NULL)
+		{
+			continue;
+		}
+
+		b2Vec2 p = ball->GetWorldCenter();
+		outcome->time = time - spawnTime;
+		outcome->position = p;
+
+		if (m_goal.lowerBound.x <= p.x && p.x <= m_goal.upperBound.x &&
+			m_goal.lowerBound.y <= p.y && p.y <= m_goal.upperBound.y)
+		{
+			outcome->reachedGoal = true;
+			break;
+		}
+
+		if (ball->GetLinearVelocity().LengthSquared() < m_def.stuckSpeed * m_def.stuckSpeed)
+		{
+			slowTime += m_def.timeStep;
+		}
+		else
+		{
+			slowTime = 0.0f;
+		}
+
+		bool outside = p.x < m_bounds.lowerBound.x || p.x > m_bounds.upperBound.x ||
+			p.y < m_bounds.lowerBound.y || p.y > m_bounds.upperBound.y;
+
+		if (slowTime >= m_def.stuckTime || ball->IsAwake() == false || outside || outcome->time >= m_def.maxTime)
+		{
+			break;
+		}
+	}
+}
+
+void b2BatchRunner::Run(b2TaskExecutor* executor)
+{
+	int32 count = GetRunCount();
+	if (count != m_outcomeCount)
+	{
+		b2Free(m_outcomes);
+		m_outcomes = (b2BatchOutcome*)b2Alloc(count * sizeof(b2BatchOutcome));
+		m_outcomeCount = count;
+	}
+
+	if (m_hasBall == false)
+	{
+		// No scene was loaded.
+		for (int32 i = 0; i < count; ++i)
+		{
+			b2BatchOutcome* outcome = m_outcomes + i;
+			outcome->spawnTime = 0.0f;
+			outcome->restitution = 0.0f;
+			outcome->friction = 0.0f;
+			outcome->reachedGoal = false;
+			outcome->time = 0.0f;
+			outcome->position.SetZero();
+		}
+		return;
+	}
+
+	b2BatchTask task;
+	task.m_runner = this;
+
+	if (executor)
+	{
+		executor->ParallelFor(&task, count);
+	}
+	else
+	{
+		task.Execute(0, count, 0);
+	}
+}
+
+bool b2BatchRunner::WriteCSV(const char* fileName) const
+{
+	FILE* file = fopen(fileName, "w");
+	if (file == NULL)
+	{
+		b2Log("Can't write %s\n", fileName);
+		return false;
+	}
+
+	fprintf(file, "run,spawn_time,restitution,friction,reached_goal,time,x,y\n");
+	for (int32 i = 0; i < m_outcomeCount; ++i)
+	{
+		const b2BatchOutcome* o = m_outcomes + i;
+		fprintf(file, "%d,%g,%g,%g,%d,%g,%g,%g\n", i, o->spawnTime, o->restitution, o->friction,
+			o->reachedGoal ? 1 : 0, o->time, o->position.x, o->position.y);
+	}
+
+	bool ok = ferror(file) == 0;
+	fclose(file);
+	return ok;
+}
@@ -0,0 +1,206 @@
+/*
+* Copyright (c) 2006-2009 Erin Catto http://www.box2d.org
+*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#ifndef B2_BATCH_RUNNER_H
+#define B2_BATCH_RUNNER_H
+
+#include <Box2D/Dynamics/b2Body.h>
+
+class b2BodyPrefab;
+class b2Shape;
+class b2TaskExecutor;
+struct b2FixtureDef;
+
+/// A range of values for one parameter of a batch.
+struct b2BatchRange
+{
+	b2BatchRange()
+	{
+		lower = 0.0f;
+		upper = 0.0f;
+		count = 1;
+	}
+
+	void Set(float32 lowerValue, float32 upperValue, int32 valueCount)
+	{
+		lower = lowerValue;
+		upper = upperValue;
+		count = valueCount;
+	}
+
+	float32 lower;
+	float32 upper;
+
+	/// The number of evenly spaced values in [lower, upper] when the batch is a
+	/// grid. A single value is the lower bound.
+	int32 count;
+};
+
+/// A batch definition is used to construct a b2BatchRunner.
+struct b2BatchDef
+{
+	/// This constructor sets the definition default values.
+	b2BatchDef()
+	{
+		friction.Set(0.2f, 0.2f, 1);
+		sampleCount = 0;
+		seed = 0;
+		timeStep = 1.0f / 60.0f;
+		velocityIterations = 8;
+		positionIterations = 3;
+		maxTime = 60.0f;
+		stuckSpeed = 0.05f;
+		stuckTime = 2.0f;
+	}
+
+	/// The time at which the ball is spawned, in seconds.
+	b2BatchRange spawnTime;
+
+	/// The restitution of the ball.
+	b2BatchRange restitution;
+
+	/// The friction of the ball.
+	b2BatchRange friction;
+
+	/// Zero runs the grid of all parameter values. Otherwise this is the number
+	/// of runs, each with random values drawn uniformly from the ranges.
+	int32 sampleCount;
+
+	/// The seed of the random values. A run gets the same values no matter
+	/// which thread simulates it.
+	uint32 seed;
+
+	/// The time step and iterations, see b2World::Step.
+	float32 timeStep;
+	int32 velocityIterations;
+	int32 positionIterations;
+
+	/// A run ends this long after the ball was spawned.
+	float32 maxTime;
+
+	/// The ball is stuck when it was slower than stuckSpeed for stuckTime
+	/// seconds, or when it fell asleep.
+	float32 stuckSpeed;
+	float32 stuckTime;
+};
+
+/// The outcome of one run of a batch.
+struct b2BatchOutcome
+{
+	float32 spawnTime;
+	float32 restitution;
+	float32 friction;
+
+	/// Did the center of the ball get into the goal?
+	bool reachedGoal;
+
+	/// The time from the spawn until the ball reached the goal, got stuck, left
+	/// the scene or the run timed out.
+	float32 time;
+
+	/// Where the ball was at that time. This is the stuck location of a run
+	/// that didn't reach the goal.
+	b2Vec2 position;
+};
+
+/// A batch runner simulates many variants of a scene, for example to find
+/// the parameters for which a ball gets stuck in a machine. Every run
+/// builds its own b2World, so the runs can be simulated on separate threads.
+///
+/// The scene is a text file of whitespace separated words. A '#' starts a
+/// comment that runs to the end of the line.
+/// - gravity gx gy
+/// - body static|kinematic|dynamic x y angle: starts a body.
+/// - velocity vx vy w: the velocity of the body, before its shapes.
+/// - material density friction restitution: used by the shapes that follow.
+/// - circle radius x y
+/// - box hx hy x y angle
+/// - polygon count x1 y1 ... xn yn
+/// - edge x1 y1 x2 y2
+/// - chain count x1 y1 ... xn yn
+/// - loop count x1 y1 ... xn yn
+/// - ball x y radius density: the spawn point of the ball.
+/// - goal lowerX lowerY upperX upperY: the ball succeeds when its center gets
+///   into this box.
+/// The shapes are in body coordinates. There are no joints, moving parts of
+/// the machine are kinematic bodies. A ball that leaves the AABB of the scene
+/// counts as stuck where it left.
+class b2BatchRunner
+{
+public:
+	b2BatchRunner(const b2BatchDef* def);
+	~b2BatchRunner();
+
+	/// Load the scene, replacing the previous one. Errors are written with b2Log.
+	/// @return false if the file couldn't be read or has no ball or goal.
+	bool LoadScene(const char* fileName);
+
+	/// Get the number of runs of the batch.
+	int32 GetRunCount() const;
+
+	/// Simulate all runs. The runs are spread over the threads of the executor,
+	/// give it one worker per core to use the whole machine. Without an
+	/// executor the runs are simulated on the calling thread. The worlds of the
+	/// runs don't get the executor.
+	void Run(b2TaskExecutor* executor);
+
+	/// Get the outcomes of the last call to Run, one per run.
+	const b2BatchOutcome* GetOutcomes() const;
+
+	/// Write the outcomes of the last call to Run as comma separated values
+	/// with a header line.
+	/// @return false if the file couldn't be written.
+	bool WriteCSV(const char* fileName) const;
+
+private:
+
+	friend class b2BatchTask;
+
+	void Clear();
+	void AddFixture(const b2Shape* shape, const b2FixtureDef& material);
+	void GetParameters(int32 run, b2BatchOutcome* outcome) const;
+	void Simulate(b2BatchOutcome* outcome) const;
+
+	b2BatchDef m_def;
+
+	b2Vec2 m_gravity;
+
+	// The scene bodies. A body gets its prefab at its first shape.
+	b2BodyDef* m_bodyDefs;
+	b2BodyPrefab** m_prefabs;
+	int32 m_bodyCount;
+	int32 m_bodyCapacity;
+	b2AABB m_bounds;
+
+	b2Vec2 m_ballPosition;
+	float32 m_ballRadius;
+	float32 m_ballDensity;
+	b2AABB m_goal;
+	bool m_hasBall;
+	bool m_hasGoal;
+
+	b2BatchOutcome* m_outcomes;
+	int32 m_outcomeCount;
+};
+
+inline const b2BatchOutcome* b2BatchRunner::GetOutcomes() const
+{
+	return m_outcomes;
+}
+
+#endif
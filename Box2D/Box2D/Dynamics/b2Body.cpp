@@ -71,6 +71,10 @@ b2Body::b2Body(const b2BodyDef* bd, b2World* world)
 	m_prev = NULL;
 	m_next = NULL;
 
+	m_island = NULL;
+	m_islandPrev = NULL;
+	m_islandNext = NULL;
+
 	m_linearVelocity = bd->linearVelocity;
 	m_angularVelocity = bd->angularVelocity;
 
@@ -101,6 +105,19 @@ b2Body::b2Body(const b2BodyDef* bd, b2World* world)
 
 	m_userData = bd->userData;
 
+	b2Assert(bd->updateRate >= 1);
+	m_updateRate = bd->updateRate;
+	m_updateStep = world->m_stepCount - 1;
+	m_updateInterval = 1;
+	m_interpolationCenter = m_sweep.c;
+	m_interpolationAngle = m_sweep.a;
+	if (m_updateRate > 1)
+	{
+		world->m_multiRate = true;
+	}
+
+	m_transformRecord = -1;
+
 	m_fixtureList = NULL;
 	m_fixtureCount = 0;
 }
@@ -151,6 +168,16 @@ void b2Body::SetType(b2BodyType type)
 	}
 	m_contactList = NULL;
 
+	// Static bodies don't belong to islands.
+	if (m_type == b2_staticBody)
+	{
+		m_world->m_islandManager.RemoveBody(this);
+	}
+	else if (m_island == NULL && IsActive())
+	{
+		LinkIsland();
+	}
+
 	// Touch the proxies so that new contacts will be created (when appropriate)
 	b2BroadPhase* broadPhase = &m_world->m_contactManager.m_broadPhase;
 	for (b2Fixture* f = m_fixtureList; f; f = f->m_next)
@@ -266,6 +293,8 @@ void b2Body::DestroyFixture(b2Fixture* fixture)
 		fixture->DestroyProxies(broadPhase);
 	}
 
+	m_world->m_contactManager.m_impulseCache.RemoveFixture(fixture);
+
 	fixture->Destroy(allocator);
 	fixture->m_body = NULL;
 	fixture->m_next = NULL;
@@ -422,6 +451,9 @@ void b2Body::SetTransform(const b2Vec2& position, float32 angle)
 		return;
 	}
 
+	b2Vec2 position0 = m_xf.p;
+	float32 angle0 = m_sweep.a;
+
 	m_xf.q.Set(angle);
 	m_xf.p = position;
 
@@ -431,11 +463,47 @@ void b2Body::SetTransform(const b2Vec2& position, float32 angle)
 	m_sweep.c0 = m_sweep.c;
 	m_sweep.a0 = angle;
 
+	// Don't interpolate from the old transform.
+	m_updateInterval = 1;
+
 	b2BroadPhase* broadPhase = &m_world->m_contactManager.m_broadPhase;
 	for (b2Fixture* f = m_fixtureList; f; f = f->m_next)
 	{
 		f->Synchronize(broadPhase, m_xf, m_xf);
 	}
+
+	if (m_world->m_transformExport)
+	{
+		m_world->RecordTransform(this, position0, angle0, false);
+	}
+}
+
+void b2Body::SetUpdateRate(int32 rate)
+{
+	b2Assert(rate >= 1);
+	m_updateRate = rate;
+	if (rate > 1)
+	{
+		m_world->m_multiRate = true;
+	}
+}
+
+b2Transform b2Body::GetInterpolatedTransform() const
+{
+	int32 steps = m_world->m_stepCount - m_updateStep;
+	if (steps >= m_updateInterval)
+	{
+		return m_xf;
+	}
+
+	float32 alpha = float32(steps) / float32(m_updateInterval);
+	b2Vec2 c = (1.0f - alpha) * m_interpolationCenter + alpha * m_sweep.c;
+	float32 a = (1.0f - alpha) * m_interpolationAngle + alpha * m_sweep.a;
+
+	b2Transform xf;
+	xf.q.Set(a);
+	xf.p = c - b2Mul(xf.q, m_sweep.localCenter);
+	return xf;
 }
 
 void b2Body::SynchronizeFixtures()
@@ -471,6 +539,11 @@ void b2Body::SetActive(bool flag)
 			f->CreateProxies(broadPhase, m_xf);
 		}
 
+		if (m_type != b2_staticBody)
+		{
+			LinkIsland();
+		}
+
 		// Contacts are created the next time step.
 	}
 	else
@@ -493,6 +566,58 @@ void b2Body::SetActive(bool flag)
 			m_world->m_contactManager.Destroy(ce0->contact);
 		}
 		m_contactList = NULL;
+
+		m_world->m_islandManager.RemoveBody(this);
+	}
+}
+
+void b2Body::SetAwake(bool flag)
+{
+	if (flag)
+	{
+		if ((m_flags & e_awakeFlag) == 0)
+		{
+			m_flags |= e_awakeFlag;
+			m_sleepTime = 0.0f;
+
+			if (m_island != NULL)
+			{
+				m_world->m_islandManager.WakeIsland(m_island);
+			}
+
+			if (m_type != b2_staticBody)
+			{
+				m_world->m_contactManager.ActivateContacts(this);
+			}
+		}
+	}
+	else
+	{
+		bool wasAwake = (m_flags & e_awakeFlag) == e_awakeFlag;
+
+		m_flags &= ~e_awakeFlag;
+		m_sleepTime = 0.0f;
+		m_linearVelocity.SetZero();
+		m_angularVelocity = 0.0f;
+		m_force.SetZero();
+		m_torque = 0.0f;
+
+		if (wasAwake && m_type != b2_staticBody)
+		{
+			m_world->m_contactManager.DeactivateContacts(this);
+		}
+	}
+}
+
+void b2Body::LinkIsland()
+{
+	b2IslandManager* islandManager = &m_world->m_islandManager;
+	islandManager->AddBody(this);
+
+	// Joints persist while a body is static or inactive.
+	for (b2JointEdge* je = m_jointList; je; je = je->next)
+	{
+		islandManager->LinkBodies(this, je->other);
 	}
 }
 
@@ -537,6 +662,7 @@ void b2Body::Dump()
 	b2Log("  bd.bullet = bool(%d);\n", m_flags & e_bulletFlag);
 	b2Log("  bd.active = bool(%d);\n", m_flags & e_activeFlag);
 	b2Log("  bd.gravityScale = %.15lef;\n", m_gravityScale);
+	b2Log("  bd.updateRate = %d;\n", m_updateRate);
 	b2Log("  bodies[%d] = m_world->CreateBody(&bd);\n", m_islandIndex);
 	b2Log("\n");
 	for (b2Fixture* f = m_fixtureList; f; f = f->m_next)
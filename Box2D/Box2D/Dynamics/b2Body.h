@@ -28,6 +28,7 @@ class b2Joint;
 class b2Contact;
 class b2Controller;
 class b2World;
+struct b2PersistentIsland;
 struct b2FixtureDef;
 struct b2JointEdge;
 struct b2ContactEdge;
@@ -67,6 +68,7 @@ struct b2BodyDef
 		type = b2_staticBody;
 		active = true;
 		gravityScale = 1.0f;
+		updateRate = 1;
 	}
 
 	/// The body type: static, kinematic, or dynamic.
@@ -120,6 +122,9 @@ struct b2BodyDef
 
 	/// Scale the gravity applied to this body.
 	float32 gravityScale;
+
+	/// The number of steps between the updates of the body, see b2Body::SetUpdateRate.
+	int32 updateRate;
 };
 
 /// A rigid body. These are created via b2World::CreateBody.
@@ -172,6 +177,12 @@ public:
 	/// @return the current world rotation angle in radians.
 	float32 GetAngle() const;
 
+	/// Get the body transform for rendering. A body that isn't updated every
+	/// step moves by several steps at once, this interpolates its transform
+	/// between the last two updates. The result lags the simulation by up to
+	/// the update rate of the body.
+	b2Transform GetInterpolatedTransform() const;
+
 	/// Get the world position of the center of mass.
 	const b2Vec2& GetWorldCenter() const;
 
@@ -311,6 +322,16 @@ public:
 	/// Is this body treated like a bullet for continuous collision detection?
 	bool IsBullet() const;
 
+	/// Set the update rate class of the body: the number of steps between its
+	/// updates, for example 1, 2 or 4. A body that is updated less often is
+	/// integrated with a larger time step. An island is updated at the rate of
+	/// its most frequently updated body, so a body joins the rate of what it
+	/// touches. See also b2World::SetUpdateRateFilter and SetUpdateRateView.
+	void SetUpdateRate(int32 rate);
+
+	/// Get the update rate class of the body.
+	int32 GetUpdateRate() const;
+
 	/// You can disable sleeping on this body. If you disable sleeping, the
 	/// body will be woken.
 	void SetSleepingAllowed(bool flag);
@@ -339,7 +360,8 @@ public:
 	/// not participate in collisions, ray-casts, or queries.
 	/// Joints connected to an inactive body are implicitly inactive.
 	/// An inactive body is still owned by a b2World object and remains
-	/// in the body list.
+	/// in the body list. This is the cheapest way to park a body in a pool
+	/// for reuse: the proxy nodes come back from the free list of the tree.
 	void SetActive(bool flag);
 
 	/// Get the active state of the body.
@@ -387,8 +409,12 @@ private:
 
 	friend class b2World;
 	friend class b2Island;
+	friend class b2IslandManager;
+	friend class b2ColoredSolver;
 	friend class b2ContactManager;
+	friend class b2ParticleSystem;
 	friend class b2ContactSolver;
+	friend class b2SoftContactSolver;
 	friend class b2Contact;
 	
 	friend class b2DistanceJoint;
@@ -421,6 +447,9 @@ private:
 	void SynchronizeFixtures();
 	void SynchronizeTransform();
 
+	// Give this body an island and join the islands of its joints.
+	void LinkIsland();
+
 	// This is used to prevent connected bodies from colliding.
 	// It may lie, depending on the collideConnected flag.
 	bool ShouldCollide(const b2Body* other) const;
@@ -433,6 +462,9 @@ private:
 
 	int32 m_islandIndex;
 
+	// The index of the transform record, see b2World::RecordTransform.
+	int32 m_transformRecord;
+
 	b2Transform m_xf;		// the body origin transform
 	b2Sweep m_sweep;		// the swept motion for CCD
 
@@ -446,6 +478,11 @@ private:
 	b2Body* m_prev;
 	b2Body* m_next;
 
+	// Persistent island membership. NULL for static and inactive bodies.
+	b2PersistentIsland* m_island;
+	b2Body* m_islandPrev;
+	b2Body* m_islandNext;
+
 	b2Fixture* m_fixtureList;
 	int32 m_fixtureCount;
 
@@ -463,6 +500,14 @@ private:
 
 	float32 m_sleepTime;
 
+	// The update rate class and the last update, see b2World::Solve. The
+	// interpolation starts at the center and angle before the last update.
+	int32 m_updateRate;
+	int32 m_updateStep;
+	int32 m_updateInterval;
+	b2Vec2 m_interpolationCenter;
+	float32 m_interpolationAngle;
+
 	void* m_userData;
 };
 
@@ -630,25 +675,9 @@ inline bool b2Body::IsBullet() const
 	return (m_flags & e_bulletFlag) == e_bulletFlag;
 }
 
-inline void b2Body::SetAwake(bool flag)
+inline int32 b2Body::GetUpdateRate() const
 {
-	if (flag)
-	{
-		if ((m_flags & e_awakeFlag) == 0)
-		{
-			m_flags |= e_awakeFlag;
-			m_sleepTime = 0.0f;
-		}
-	}
-	else
-	{
-		m_flags &= ~e_awakeFlag;
-		m_sleepTime = 0.0f;
-		m_linearVelocity.SetZero();
-		m_angularVelocity = 0.0f;
-		m_force.SetZero();
-		m_torque = 0.0f;
-	}
+	return m_updateRate;
 }
 
 inline bool b2Body::IsAwake() const
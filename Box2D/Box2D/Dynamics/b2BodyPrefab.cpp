@@ -0,0 +1,180 @@
+/*
+* Copyright (c) 2006-2011 Erin Catto http://www.box2d.org
+*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include <Box2D/Dynamics/b2BodyPrefab.h>
+#include <string.h>
+
+b2BodyPrefab::b2BodyPrefab(const b2BodyDef* def)
+{
+	m_def = *def;
+	m_def.position.SetZero();
+	m_def.angle = 0.0f;
+
+	m_fixtures = NULL;
+	m_fixtureCount = 0;
+	m_fixtureCapacity = 0;
+	m_proxyCount = 0;
+
+	ResetMassData();
+}
+
+b2BodyPrefab::~b2BodyPrefab()
+{
+	// The allocator frees the shape memory.
+	for (int32 i = 0; i < m_fixtureCount; ++i)
+	{
+		b2Shape* shape = (b2Shape*)m_fixtures[i].shape;
+		shape->~b2Shape();
+	}
+
+	b2Free(m_fixtures);
+}
+
+void b2BodyPrefab::AddFixture(const b2FixtureDef* def)
+{
+	if (m_fixtureCount == m_fixtureCapacity)
+	{
+		b2FixtureDef* oldFixtures = m_fixtures;
+		m_fixtureCapacity = b2Max(4, 2 * m_fixtureCapacity);
+		m_fixtures = (b2FixtureDef*)b2Alloc(m_fixtureCapacity * sizeof(b2FixtureDef));
+		if (oldFixtures)
+		{
+			memcpy(m_fixtures, oldFixtures, m_fixtureCount * sizeof(b2FixtureDef));
+			b2Free(oldFixtures);
+		}
+	}
+
+	b2FixtureDef* fixture = m_fixtures + m_fixtureCount;
+	*fixture = *def;
+	fixture->shape = def->shape->Clone(&m_allocator);
+	++m_fixtureCount;
+
+	// A shape with a child query has one proxy for all of its children.
+	const b2Shape* shape = fixture->shape;
+	m_proxyCount += shape->HasChildQuery() ? 1 : shape->GetChildCount();
+
+	ResetMassData();
+}
+
+void b2BodyPrefab::AddFixture(const b2Shape* shape, float32 density)
+{
+	b2FixtureDef def;
+	def.shape = shape;
+	def.density = density;
+
+	AddFixture(&def);
+}
+
+void b2BodyPrefab::GetMassData(b2MassData* data) const
+{
+	data->mass = m_mass;
+	data->I = m_I + m_mass * b2Dot(m_localCenter, m_localCenter);
+	data->center = m_localCenter;
+}
+
+void b2BodyPrefab::ComputeAABB(b2AABB* aabb, const b2Transform& xf) const
+{
+	aabb->lowerBound = xf.p;
+	aabb->upperBound = xf.p;
+
+	for (int32 i = 0; i < m_fixtureCount; ++i)
+	{
+		const b2Shape* shape = m_fixtures[i].shape;
+		int32 childCount = shape->HasChildQuery() ? 1 : shape->GetChildCount();
+		for (int32 j = 0; j < childCount; ++j)
+		{
+			b2AABB childAABB;
+			if (shape->HasChildQuery())
+			{
+				shape->ComputeChildrenAABB(&childAABB, xf);
+			}
+			else
+			{
+				shape->ComputeAABB(&childAABB, xf, j);
+			}
+
+			if (i == 0 && j == 0)
+			{
+				*aabb = childAABB;
+			}
+			else
+			{
+				aabb->Combine(childAABB);
+			}
+		}
+	}
+}
+
+// Same as b2Body::ResetMassData. The rotational inertia is kept about the
+// center of mass.
+void b2BodyPrefab::ResetMassData()
+{
+	m_mass = 0.0f;
+	m_invMass = 0.0f;
+	m_I = 0.0f;
+	m_invI = 0.0f;
+	m_localCenter.SetZero();
+
+	// Static and kinematic bodies have zero mass.
+	if (m_def.type != b2_dynamicBody)
+	{
+		return;
+	}
+
+	// Accumulate mass over all fixtures.
+	for (int32 i = 0; i < m_fixtureCount; ++i)
+	{
+		const b2FixtureDef* fixture = m_fixtures + i;
+		if (fixture->density == 0.0f)
+		{
+			continue;
+		}
+
+		b2MassData massData;
+		fixture->shape->ComputeMass(&massData, fixture->density);
+		m_mass += massData.mass;
+		m_localCenter += massData.mass * massData.center;
+		m_I += massData.I;
+	}
+
+	// Compute center of mass.
+	if (m_mass > 0.0f)
+	{
+		m_invMass = 1.0f / m_mass;
+		m_localCenter *= m_invMass;
+	}
+	else
+	{
+		// Force all dynamic bodies to have a positive mass.
+		m_mass = 1.0f;
+		m_invMass = 1.0f;
+	}
+
+	if (m_I > 0.0f && m_def.fixedRotation == false)
+	{
+		// Center the inertia about the center of mass.
+		m_I -= m_mass * b2Dot(m_localCenter, m_localCenter);
+		b2Assert(m_I > 0.0f);
+		m_invI = 1.0f / m_I;
+	}
+	else
+	{
+		m_I = 0.0f;
+		m_invI = 0.0f;
+	}
+}
@@ -0,0 +1,89 @@
+/*
+* Copyright (c) 2006-2011 Erin Catto http://www.box2d.org
+*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#ifndef B2_BODY_PREFAB_H
+#define B2_BODY_PREFAB_H
+
+#include <Box2D/Common/b2BlockAllocator.h>
+#include <Box2D/Dynamics/b2Body.h>
+#include <Box2D/Dynamics/b2Fixture.h>
+
+/// A body prefab is a body definition with its fixtures, used to create many
+/// identical bodies with b2World::CreateBodies. The shapes are cloned and the
+/// mass is computed once, when the fixtures are added.
+class b2BodyPrefab
+{
+public:
+	/// The body definition is copied. Its position and angle are ignored,
+	/// each body gets a transform in b2World::CreateBodies.
+	b2BodyPrefab(const b2BodyDef* def);
+	~b2BodyPrefab();
+
+	/// Add a fixture to the prefab. The shape is cloned.
+	void AddFixture(const b2FixtureDef* def);
+
+	/// Add a fixture from a shape. The shape is cloned.
+	void AddFixture(const b2Shape* shape, float32 density);
+
+	/// Get the body definition.
+	const b2BodyDef& GetBodyDef() const;
+
+	/// Get the number of fixtures.
+	int32 GetFixtureCount() const;
+
+	/// Get the mass data every body of this prefab gets.
+	void GetMassData(b2MassData* data) const;
+
+	/// Compute the AABB of a body of this prefab with the given transform.
+	/// Without fixtures this is the body origin.
+	void ComputeAABB(b2AABB* aabb, const b2Transform& xf) const;
+
+protected:
+
+	friend class b2World;
+
+	void ResetMassData();
+
+	b2BodyDef m_def;
+
+	b2FixtureDef* m_fixtures;
+	int32 m_fixtureCount;
+	int32 m_fixtureCapacity;
+
+	// The number of broad-phase proxies of one body.
+	int32 m_proxyCount;
+
+	float32 m_mass, m_invMass;
+	float32 m_I, m_invI;
+	b2Vec2 m_localCenter;
+
+	// Holds the shape clones.
+	b2BlockAllocator m_allocator;
+};
+
+inline const b2BodyDef& b2BodyPrefab::GetBodyDef() const
+{
+	return m_def;
+}
+
+inline int32 b2BodyPrefab::GetFixtureCount() const
+{
+	return m_fixtureCount;
+}
+
+#endif
@@ -0,0 +1,313 @@
+/*
+* Copyright (c) 2006-2009 Erin Catto http://www.box2d.org
+*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include <Box2D/Dynamics/b2ColoredSolver.h>
+#include <Box2D/Dynamics/b2Island.h>
+#include <Box2D/Dynamics/b2Body.h>
+#include <Box2D/Dynamics/b2Fixture.h>
+#include <Box2D/Dynamics/Contacts/b2Contact.h>
+#include <Box2D/Dynamics/Contacts/b2ContactSolver.h>
+#include <Box2D/Dynamics/Joints/b2Joint.h>
+#include <Box2D/Common/b2StackAllocator.h>
+#include <string.h>
+
+// Find the first color that is free on both bodies and claim it on the bodies
+// the constraint writes. Returns the group of the constraint.
+static int32 b2AssignColor(uint32* colorMasks, int32 indexA, bool writeA, int32 indexB, bool writeB)
+{
+	uint32 used = colorMasks[indexA] | colorMasks[indexB];
+	for (int32 i = 0; i < b2ColoredSolver::e_colorCount; ++i)
+	{
+		uint32 bit = 1u << i;
+		if (used & bit)
+		{
+			continue;
+		}
+
+		if (writeA)
+		{
+			colorMasks[indexA] |= bit;
+		}
+
+		if (writeB)
+		{
+			colorMasks[indexB] |= bit;
+		}
+
+		return i + 1;
+	}
+
+	return 0;
+}
+
+// Sort items by group using a counting sort, which keeps the island order
+// within a group.
+template <typename T>
+static void b2SortByGroup(T* items, const int32* groups, int32 count, int32* starts, b2StackAllocator* allocator)
+{
+	memset(starts, 0, (b2ColoredSolver::e_groupCount + 1) * sizeof(int32));
+	for (int32 i = 0; i < count; ++i)
+	{
+		++starts[groups[i] + 1];
+	}
+
+	for (int32 i = 0; i < b2ColoredSolver::e_groupCount; ++i)
+	{
+		starts[i + 1] += starts[i];
+	}
+
+	T* sorted = (T*)allocator->Allocate(count * sizeof(T));
+	int32 offsets[b2ColoredSolver::e_groupCount];
+	memcpy(offsets, starts, b2ColoredSolver::e_groupCount * sizeof(int32));
+	for (int32 i = 0; i < count; ++i)
+	{
+		sorted[offsets[groups[i]]++] = items[i];
+	}
+
+	memcpy(items, sorted, count * sizeof(T));
+	allocator->Free(sorted);
+}
+
+b2ColoredSolver::b2ColoredSolver()
+{
+	m_island = NULL;
+	m_executor = NULL;
+	m_contactSolver = NULL;
+	m_workerCount = 0;
+	m_minSeparations = NULL;
+	m_jointsOkay = NULL;
+}
+
+b2ColoredSolver::~b2ColoredSolver()
+{
+	if (m_island)
+	{
+		b2StackAllocator* allocator = m_island->m_allocator;
+		allocator->Free(m_jointsOkay);
+		allocator->Free(m_minSeparations);
+	}
+}
+
+void b2ColoredSolver::Create(b2Island* island, b2TaskExecutor* executor)
+{
+	b2Assert(m_island == NULL);
+
+	m_island = island;
+	m_executor = executor;
+
+	b2StackAllocator* allocator = island->m_allocator;
+
+	m_workerCount = executor ? b2Max(executor->GetWorkerCount(), 1) : 1;
+	m_minSeparations = (float32*)allocator->Allocate(m_workerCount * sizeof(float32));
+	m_jointsOkay = (bool*)allocator->Allocate(m_workerCount * sizeof(bool));
+
+	int32 bodyCount = island->m_bodyCount;
+	int32 jointCount = island->m_jointCount;
+	int32 contactCount = island->m_contactCount;
+
+	uint32* colorMasks = (uint32*)allocator->Allocate(bodyCount * sizeof(uint32));
+	memset(colorMasks, 0, bodyCount * sizeof(uint32));
+
+	int32* jointGroups = (int32*)allocator->Allocate(jointCount * sizeof(int32));
+	int32* contactGroups = (int32*)allocator->Allocate(contactCount * sizeof(int32));
+
+	// Joints write both bodies, even static ones. They are colored first so
+	// that contacts can see which static bodies a color writes.
+	for (int32 i = 0; i < jointCount; ++i)
+	{
+		b2Joint* joint = island->m_joints[i];
+
+		// Gear joints write four bodies.
+		if (joint->GetType() == e_gearJoint)
+		{
+			jointGroups[i] = 0;
+			continue;
+		}
+
+		int32 indexA = joint->GetBodyA()->m_islandIndex;
+		int32 indexB = joint->GetBodyB()->m_islandIndex;
+		jointGroups[i] = b2AssignColor(colorMasks, indexA, true, indexB, true);
+	}
+
+	// Contacts only write dynamic bodies. See b2ContactSolver::WarmStart.
+	for (int32 i = 0; i < contactCount; ++i)
+	{
+		b2Contact* contact = island->m_contacts[i];
+		b2Body* bodyA = contact->GetFixtureA()->GetBody();
+		b2Body* bodyB = contact->GetFixtureB()->GetBody();
+		contactGroups[i] = b2AssignColor(colorMasks,
+			bodyA->m_islandIndex, bodyA->GetType() == b2_dynamicBody,
+			bodyB->m_islandIndex, bodyB->GetType() == b2_dynamicBody);
+	}
+
+	b2SortByGroup(island->m_joints, jointGroups, jointCount, m_jointStarts, allocator);
+	b2SortByGroup(island->m_contacts, contactGroups, contactCount, m_contactStarts, allocator);
+
+	allocator->Free(contactGroups);
+	allocator->Free(jointGroups);
+	allocator->Free(colorMasks);
+}
+
+void b2ColoredSolver::InitializeVelocityConstraints(b2ContactSolver* contactSolver, const b2SolverData& data)
+{
+	m_contactSolver = contactSolver;
+	m_data = data;
+
+	// The contact constraints are independent at this point.
+	m_stage = e_initialize;
+	int32 contactCount = m_island->m_contactCount;
+	if (m_executor && contactCount > 0)
+	{
+		m_executor->ParallelFor(this, contactCount);
+	}
+	else
+	{
+		Execute(0, contactCount, 0);
+	}
+
+	Run(e_warmStart);
+}
+
+void b2ColoredSolver::SolveVelocityConstraints()
+{
+	Run(e_solveVelocity);
+}
+
+bool b2ColoredSolver::SolvePositionConstraints()
+{
+	for (int32 i = 0; i < m_workerCount; ++i)
+	{
+		m_minSeparations[i] = 0.0f;
+		m_jointsOkay[i] = true;
+	}
+
+	Run(e_solvePosition);
+
+	float32 minSeparation = 0.0f;
+	bool jointsOkay = true;
+	for (int32 i = 0; i < m_workerCount; ++i)
+	{
+		minSeparation = b2Min(minSeparation, m_minSeparations[i]);
+		jointsOkay = jointsOkay && m_jointsOkay[i];
+	}
+
+	// See b2ContactSolver::SolvePositionConstraints.
+	bool contactsOkay = minSeparation >= -3.0f * b2_linearSlop;
+	return contactsOkay && jointsOkay;
+}
+
+void b2ColoredSolver::Run(Stage stage)
+{
+	m_stage = stage;
+
+	for (int32 i = 0; i < e_groupCount; ++i)
+	{
+		int32 jointCount = m_jointStarts[i + 1] - m_jointStarts[i];
+		int32 contactCount = m_contactStarts[i + 1] - m_contactStarts[i];
+		int32 count = jointCount + contactCount;
+		if (count == 0)
+		{
+			continue;
+		}
+
+		m_group = i;
+
+		if (i == 0 || m_executor == NULL)
+		{
+			Execute(0, count, 0);
+		}
+		else
+		{
+			m_executor->ParallelFor(this, count);
+		}
+	}
+}
+
+void b2ColoredSolver::Execute(int32 begin, int32 end, int32 workerIndex)
+{
+	b2Assert(0 <= workerIndex && workerIndex < m_workerCount);
+
+	if (m_stage == e_initialize)
+	{
+		m_contactSolver->InitializeVelocityConstraints(begin, end);
+		return;
+	}
+
+	// The joints of the group come first, then its contacts.
+	int32 jointStart = m_jointStarts[m_group];
+	int32 jointCount = m_jointStarts[m_group + 1] - jointStart;
+	b2Joint** joints = m_island->m_joints + jointStart;
+
+	for (int32 i = begin; i < b2Min(end, jointCount); ++i)
+	{
+		b2Joint* joint = joints[i];
+		switch (m_stage)
+		{
+		case e_warmStart:
+			joint->InitVelocityConstraints(m_data);
+			break;
+
+		case e_solveVelocity:
+			joint->SolveVelocityConstraints(m_data);
+			break;
+
+		case e_solvePosition:
+			{
+				bool jointOkay = joint->SolvePositionConstraints(m_data);
+				m_jointsOkay[workerIndex] = m_jointsOkay[workerIndex] && jointOkay;
+			}
+			break;
+
+		default:
+			b2Assert(false);
+			break;
+		}
+	}
+
+	int32 contactBegin = m_contactStarts[m_group] + b2Max(begin - jointCount, 0);
+	int32 contactEnd = m_contactStarts[m_group] + end - jointCount;
+	if (contactBegin >= contactEnd)
+	{
+		return;
+	}
+
+	switch (m_stage)
+	{
+	case e_warmStart:
+		if (m_data.step.warmStarting)
+		{
+			m_contactSolver->WarmStart(contactBegin, contactEnd);
+		}
+		break;
+
+	case e_solveVelocity:
+		m_contactSolver->SolveVelocityConstraints(contactBegin, contactEnd);
+		break;
+
+	case e_solvePosition:
+		{
+			float32 minSeparation = m_contactSolver->SolvePositionConstraints(contactBegin, contactEnd);
+			m_minSeparations[workerIndex] = b2Min(m_minSeparations[workerIndex], minSeparation);
+		}
+		break;
+
+	default:
+		b2Assert(false);
+		break;
+	}
+}
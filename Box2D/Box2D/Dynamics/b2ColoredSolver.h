@@ -0,0 +1,87 @@
+/*
+* Copyright (c) 2006-2009 Erin Catto http://www.box2d.org
+*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#ifndef B2_COLORED_SOLVER_H
+#define B2_COLORED_SOLVER_H
+
+#include <Box2D/Dynamics/b2TimeStep.h>
+#include <Box2D/Dynamics/b2WorldCallbacks.h>
+
+class b2Island;
+class b2ContactSolver;
+
+/// Solves the constraints of a large island in parallel. The joints and contacts
+/// are partitioned by graph coloring so that no two constraints of a color write
+/// the same body. The constraints of a color are split across the threads of the
+/// task executor, and the colors are solved one after another. Constraints that
+/// don't get a color are solved first on the calling thread. The result only
+/// depends on the coloring, not on the executor.
+/// This is an internal class.
+class b2ColoredSolver : public b2Task
+{
+public:
+	enum
+	{
+		e_colorCount = 12,
+
+		// Group zero holds the constraints without a color.
+		e_groupCount = e_colorCount + 1
+	};
+
+	b2ColoredSolver();
+	~b2ColoredSolver();
+
+	/// Color the constraints of the island and sort the island's joints and contacts
+	/// by color. This must be called before the contact solver is created.
+	void Create(b2Island* island, b2TaskExecutor* executor);
+
+	void InitializeVelocityConstraints(b2ContactSolver* contactSolver, const b2SolverData& data);
+	void SolveVelocityConstraints();
+	bool SolvePositionConstraints();
+
+	void Execute(int32 begin, int32 end, int32 workerIndex);
+
+private:
+	enum Stage
+	{
+		e_initialize,
+		e_warmStart,
+		e_solveVelocity,
+		e_solvePosition
+	};
+
+	void Run(Stage stage);
+
+	b2Island* m_island;
+	b2TaskExecutor* m_executor;
+	b2ContactSolver* m_contactSolver;
+	b2SolverData m_data;
+
+	int32 m_jointStarts[e_groupCount + 1];
+	int32 m_contactStarts[e_groupCount + 1];
+
+	Stage m_stage;
+	int32 m_group;
+
+	// Position solver results per worker.
+	int32 m_workerCount;
+	float32* m_minSeparations;
+	bool* m_jointsOkay;
+};
+
+#endif
@@ -18,20 +18,52 @@
 
 #include <Box2D/Dynamics/b2ContactManager.h>
 #include <Box2D/Dynamics/b2Body.h>
+#include <Box2D/Dynamics/b2World.h>
 #include <Box2D/Dynamics/b2Fixture.h>
 #include <Box2D/Dynamics/b2WorldCallbacks.h>
 #include <Box2D/Dynamics/Contacts/b2Contact.h>
+#include <Box2D/Collision/b2Collision.h>
+#include <Box2D/Common/b2Atomic.h>
 
 b2ContactFilter b2_defaultFilter;
 b2ContactListener b2_defaultListener;
 
 b2ContactManager::b2ContactManager()
 {
-	m_contactList = NULL;
+	// Set up the contact registers before the world can be stepped on
+	// another thread, instead of when the first contact is created. Worlds
+	// may be built on several threads at once.
+	b2CallOnce(&b2Contact::s_initialized, b2Contact::InitializeRegisters);
+
 	m_contactCount = 0;
+	m_contactCapacity = 16;
+	m_contacts = (b2ContactState*)b2Alloc(m_contactCapacity * sizeof(b2ContactState));
+	m_contacts[0].contact = NULL;
+
+	m_activeCount = 0;
+	m_activeCapacity = 16;
+	m_activeContacts = (int32*)b2Alloc(m_activeCapacity * sizeof(int32));
+
+	m_slotCount = 0;
+	m_slotCapacity = 16;
+	m_slots = (b2ContactSlot*)b2Alloc(m_slotCapacity * sizeof(b2ContactSlot));
+	m_freeSlot = -1;
+
 	m_contactFilter = &b2_defaultFilter;
+	m_broadPhase.SetFilterPairs(true);
 	m_contactListener = &b2_defaultListener;
 	m_allocator = NULL;
+
+	m_skipSensors = false;
+
+	m_impulseCaching = false;
+}
+
+b2ContactManager::~b2ContactManager()
+{
+	b2Free(m_contacts);
+	b2Free(m_activeContacts);
+	b2Free(m_slots);
 }
 
 void b2ContactManager::Destroy(b2Contact* c)
@@ -46,20 +78,25 @@ void b2ContactManager::Destroy(b2Contact* c)
 		m_contactListener->EndContact(c);
 	}
 
-	// Remove from the world.
-	if (c->m_prev)
+	if (c->IsTouching() && fixtureA->IsSensor() == false && fixtureB->IsSensor() == false)
 	{
-		c->m_prev->m_next = c->m_next;
-	}
+		// Keep the impulses in case the contact comes back.
+		if (m_impulseCaching)
+		{
+			const b2Manifold* manifold = &c->m_state->manifold;
+			for (int32 i = 0; i < manifold->pointCount; ++i)
+			{
+				m_impulseCache.Store(c, manifold->points + i);
+			}
+		}
 
-	if (c->m_next)
-	{
-		c->m_next->m_prev = c->m_prev;
+		// The island may fall apart.
+		bodyA->m_world->m_islandManager.UnlinkBodies(bodyA, bodyB);
 	}
 
-	if (c == m_contactList)
+	if (c->m_state->activeIndex != b2_nullActiveIndex)
 	{
-		m_contactList = c->m_next;
+		RemoveActive(c);
 	}
 
 	// Remove from body 1
@@ -94,78 +131,213 @@ void b2ContactManager::Destroy(b2Contact* c)
 		bodyB->m_contactList = c->m_nodeB.next;
 	}
 
-	// Call the factory.
+	// Remove from the world. The last contact fills the hole.
+	int32 index = int32(c->m_state - m_contacts);
+	int32 id = c->m_id;
+
+	// Call the factory. This wakes the bodies of a touching contact, which
+	// appends their contacts to the active array. Collide may be walking it.
 	b2Contact::Destroy(c, m_allocator);
 	--m_contactCount;
+
+	if (index < m_contactCount)
+	{
+		b2ContactState* moved = m_contacts + index;
+		*moved = m_contacts[m_contactCount];
+		moved->contact->m_state = moved;
+		if (moved->activeIndex != b2_nullActiveIndex)
+		{
+			m_activeContacts[moved->activeIndex] = index;
+		}
+	}
+	m_contacts[m_contactCount].contact = NULL;
+
+	// Free the handle.
+	b2ContactSlot* slot = m_slots + id;
+	slot->contact = NULL;
+	++slot->generation;
+	slot->next = m_freeSlot;
+	m_freeSlot = id;
 }
 
-// This is the top level collision call for the time step. Here
-// all the narrow phase collision is processed for the world
-// contact list.
-void b2ContactManager::Collide()
+void b2ContactManager::AddActive(b2Contact* c)
+{
+	b2ContactState* state = c->m_state;
+	b2Assert(state->activeIndex == b2_nullActiveIndex);
+
+	if (m_activeCount == m_activeCapacity)
+	{
+		int32* oldContacts = m_activeContacts;
+		m_activeCapacity *= 2;
+		m_activeContacts = (int32*)b2Alloc(m_activeCapacity * sizeof(int32));
+		memcpy(m_activeContacts, oldContacts, m_activeCount * sizeof(int32));
+		b2Free(oldContacts);
+	}
+
+	// The contact may have been asleep since the last TOI reset.
+	state->flags &= ~(b2Contact::e_toiFlag | b2Contact::e_islandFlag);
+	state->toiCount = 0;
+	state->toi = 1.0f;
+
+	state->activeIndex = m_activeCount;
+	m_activeContacts[m_activeCount] = int32(state - m_contacts);
+	++m_activeCount;
+}
+
+void b2ContactManager::RemoveActive(b2Contact* c)
+{
+	b2ContactState* state = c->m_state;
+	int32 index = state->activeIndex;
+	b2Assert(0 <= index && index < m_activeCount);
+
+	--m_activeCount;
+	if (index < m_activeCount)
+	{
+		int32 moved = m_activeContacts[m_activeCount];
+		m_activeContacts[index] = moved;
+		m_contacts[moved].activeIndex = index;
+	}
+
+	state->activeIndex = b2_nullActiveIndex;
+}
+
+void b2ContactManager::ActivateContacts(b2Body* body)
 {
-	// Update awake contacts.
-	b2Contact* c = m_contactList;
-	while (c)
-	{
-		b2Fixture* fixtureA = c->GetFixtureA();
-		b2Fixture* fixtureB = c->GetFixtureB();
-		int32 indexA = c->GetChildIndexA();
-		int32 indexB = c->GetChildIndexB();
-		b2Body* bodyA = fixtureA->GetBody();
-		b2Body* bodyB = fixtureB->GetBody();
-		 
-		// Is this contact flagged for filtering?
-		if (c->m_flags & b2Contact::e_filterFlag)
+	for (b2ContactEdge* ce = body->m_contactList; ce; ce = ce->next)
+	{
+		if (ce->contact->m_state->activeIndex == b2_nullActiveIndex)
 		{
-			// Should these bodies collide?
-			if (bodyB->ShouldCollide(bodyA) == false)
-			{
-				b2Contact* cNuke = c;
-				c = cNuke->GetNext();
-				Destroy(cNuke);
-				continue;
-			}
+			AddActive(ce->contact);
+		}
+	}
+}
 
-			// Check user filtering.
-			if (m_contactFilter && m_contactFilter->ShouldCollide(fixtureA, fixtureB) == false)
-			{
-				b2Contact* cNuke = c;
-				c = cNuke->GetNext();
-				Destroy(cNuke);
-				continue;
-			}
+void b2ContactManager::DeactivateContacts(b2Body* body)
+{
+	for (b2ContactEdge* ce = body->m_contactList; ce; ce = ce->next)
+	{
+		b2Body* other = ce->other;
+		if (other->IsAwake() && other->m_type != b2_staticBody)
+		{
+			continue;
+		}
 
-			// Clear the filtering flag.
-			c->m_flags &= ~b2Contact::e_filterFlag;
+		if (ce->contact->m_state->activeIndex != b2_nullActiveIndex)
+		{
+			RemoveActive(ce->contact);
 		}
+	}
+}
 
-		bool activeA = bodyA->IsAwake() && bodyA->m_type != b2_staticBody;
-		bool activeB = bodyB->IsAwake() && bodyB->m_type != b2_staticBody;
+b2Contact* b2ContactManager::GetContact(const b2ContactHandle& handle) const
+{
+	if (handle.id < 0 || handle.id >= m_slotCount)
+	{
+		return NULL;
+	}
 
-		// At least one body must be awake and it must be dynamic or kinematic.
-		if (activeA == false && activeB == false)
+	const b2ContactSlot* slot = m_slots + handle.id;
+	if (slot->generation != handle.generation)
+	{
+		return NULL;
+	}
+
+	return slot->contact;
+}
+
+bool b2ContactManager::Persist(b2ContactState* state)
+{
+	b2Fixture* fixtureA = state->fixtureA;
+	b2Fixture* fixtureB = state->fixtureB;
+	b2Body* bodyA = fixtureA->GetBody();
+	b2Body* bodyB = fixtureB->GetBody();
+
+	// Is this contact flagged for filtering?
+	if (state->flags & b2Contact::e_filterFlag)
+	{
+		// Should these bodies collide?
+		if (bodyB->ShouldCollide(bodyA) == false)
+		{
+			Destroy(state->contact);
+			return false;
+		}
+
+		// Check user filtering.
+		if (m_contactFilter && m_contactFilter->ShouldCollide(fixtureA, fixtureB) == false)
+		{
+			Destroy(state->contact);
+			return false;
+		}
+
+		// Clear the filtering flag.
+		state->flags &= ~b2Contact::e_filterFlag;
+	}
+
+	// At least one body must be awake and it must be dynamic or kinematic.
+	b2Assert((bodyA->IsAwake() && bodyA->m_type != b2_staticBody) ||
+			 (bodyB->IsAwake() && bodyB->m_type != b2_staticBody));
+
+	// The children of a shape with a child query have no proxies. The contact
+	// factory makes such a shape fixture A.
+	bool overlap;
+	if (fixtureA->m_shape->HasChildQuery())
+	{
+		b2Assert(fixtureB->m_shape->HasChildQuery() == false);
+		b2AABB childAABB;
+		fixtureA->m_shape->ComputeAABB(&childAABB, bodyA->GetTransform(), state->indexA);
+		int32 proxyIdB = fixtureB->m_proxies[state->indexB].proxyId;
+		overlap = b2TestOverlap(childAABB, m_broadPhase.GetFatAABB(proxyIdB));
+	}
+	else
+	{
+		int32 proxyIdA = fixtureA->m_proxies[state->indexA].proxyId;
+		int32 proxyIdB = fixtureB->m_proxies[state->indexB].proxyId;
+		overlap = m_broadPhase.TestOverlap(proxyIdA, proxyIdB);
+	}
+
+	// Here we destroy contacts that cease to overlap in the broad-phase.
+	if (overlap == false)
+	{
+		Destroy(state->contact);
+		return false;
+	}
+
+	return true;
+}
+
+static inline bool b2IsSensorContact(const b2ContactState* state)
+{
+	return state->fixtureA->IsSensor() || state->fixtureB->IsSensor();
+}
+
+// This is the top level collision call for the time step. Here
+// all the narrow phase collision is processed for the active
+// contacts. Contacts between sleeping or static bodies are not visited.
+void b2ContactManager::Collide()
+{
+	m_impulseCache.Step();
+	b2ImpulseCache* cache = m_impulseCaching ? &m_impulseCache : NULL;
+
+	// Destroying a contact moves the last active contact into its place, so
+	// only advance past contacts that persist. Wake-ups append to the active
+	// array, so the count is read on every pass.
+	int32 index = 0;
+	while (index < m_activeCount)
+	{
+		b2ContactState* state = m_contacts + m_activeContacts[index];
+		if (Persist(state) == false)
 		{
-			c = c->GetNext();
 			continue;
 		}
 
-		int32 proxyIdA = fixtureA->m_proxies[indexA].proxyId;
-		int32 proxyIdB = fixtureB->m_proxies[indexB].proxyId;
-		bool overlap = m_broadPhase.TestOverlap(proxyIdA, proxyIdB);
+		++index;
 
-		// Here we destroy contacts that cease to overlap in the broad-phase.
-		if (overlap == false)
+		if (m_skipSensors && b2IsSensorContact(state))
 		{
-			b2Contact* cNuke = c;
-			c = cNuke->GetNext();
-			Destroy(cNuke);
 			continue;
 		}
 
-		// The contact persists.
-		c->Update(m_contactListener);
-		c = c->GetNext();
+		state->contact->Update(m_contactListener, cache);
 	}
 }
 
@@ -174,17 +346,98 @@ void b2ContactManager::FindNewContacts()
 	m_broadPhase.UpdatePairs(this);
 }
 
+void b2ContactManager::SetContactFilter(b2ContactFilter* filter)
+{
+	m_contactFilter = filter;
+
+	// A custom filter may accept the pairs that the default filter rejects.
+	m_broadPhase.SetFilterPairs(filter == &b2_defaultFilter);
+}
+
 void b2ContactManager::AddPair(void* proxyUserDataA, void* proxyUserDataB)
 {
 	b2FixtureProxy* proxyA = (b2FixtureProxy*)proxyUserDataA;
 	b2FixtureProxy* proxyB = (b2FixtureProxy*)proxyUserDataB;
 
-	b2Fixture* fixtureA = proxyA->fixture;
-	b2Fixture* fixtureB = proxyB->fixture;
+	if (proxyA->fixture->m_shape->HasChildQuery())
+	{
+		AddChildPair(proxyA, proxyB);
+		return;
+	}
 
-	int32 indexA = proxyA->childIndex;
-	int32 indexB = proxyB->childIndex;
+	if (proxyB->fixture->m_shape->HasChildQuery())
+	{
+		AddChildPair(proxyB, proxyA);
+		return;
+	}
 
+	AddContact(proxyA->fixture, proxyA->childIndex, proxyB->fixture, proxyB->childIndex);
+}
+
+// Adds a contact for each child of a shape that overlaps the fat AABB of a proxy.
+class b2ChildPairCallback : public b2ChildQueryCallback
+{
+public:
+	bool ReportChild(int32 childIndex)
+	{
+		// The children were queried in the frame of the shape with a looser box.
+		b2AABB childAABB;
+		parentFixture->GetShape()->ComputeAABB(&childAABB, *transform, childIndex);
+		if (b2TestOverlap(childAABB, *fatAABB))
+		{
+			contactManager->AddContact(parentFixture, childIndex, otherFixture, otherIndex);
+		}
+
+		return true;
+	}
+
+	b2ContactManager* contactManager;
+	const b2Transform* transform;
+	const b2AABB* fatAABB;
+	b2Fixture* parentFixture;
+	b2Fixture* otherFixture;
+	int32 otherIndex;
+};
+
+void b2ContactManager::AddChildPair(b2FixtureProxy* parentProxy, b2FixtureProxy* otherProxy)
+{
+	b2Fixture* parentFixture = parentProxy->fixture;
+	b2Fixture* otherFixture = otherProxy->fixture;
+
+	// Shapes with child queries don't collide with each other. There are no
+	// contacts between chains either.
+	if (otherFixture->m_shape->HasChildQuery() || otherFixture->GetType() == b2Shape::e_chain ||
+		parentFixture->GetBody() == otherFixture->GetBody())
+	{
+		return;
+	}
+
+	const b2Transform& xf = parentFixture->GetBody()->GetTransform();
+	const b2AABB& fatAABB = m_broadPhase.GetFatAABB(otherProxy->proxyId);
+
+	// Bound the fat AABB in the frame of the shape.
+	b2Vec2 c = b2MulT(xf, fatAABB.GetCenter());
+	b2Vec2 h = fatAABB.GetExtents();
+	b2Vec2 r;
+	r.x = b2Abs(xf.q.c) * h.x + b2Abs(xf.q.s) * h.y;
+	r.y = b2Abs(xf.q.s) * h.x + b2Abs(xf.q.c) * h.y;
+
+	b2AABB localAABB;
+	localAABB.lowerBound = c - r;
+	localAABB.upperBound = c + r;
+
+	b2ChildPairCallback callback;
+	callback.contactManager = this;
+	callback.transform = &xf;
+	callback.fatAABB = &fatAABB;
+	callback.parentFixture = parentFixture;
+	callback.otherFixture = otherFixture;
+	callback.otherIndex = otherProxy->childIndex;
+	parentFixture->m_shape->QueryChildren(&callback, localAABB);
+}
+
+void b2ContactManager::AddContact(b2Fixture* fixtureA, int32 indexA, b2Fixture* fixtureB, int32 indexB)
+{
 	b2Body* bodyA = fixtureA->GetBody();
 	b2Body* bodyB = fixtureB->GetBody();
 
@@ -251,13 +504,62 @@ void b2ContactManager::AddPair(void* proxyUserDataA, void* proxyUserDataB)
 	bodyB = fixtureB->GetBody();
 
 	// Insert into the world.
-	c->m_prev = NULL;
-	c->m_next = m_contactList;
-	if (m_contactList != NULL)
+	if (m_contactCount + 1 == m_contactCapacity)
 	{
-		m_contactList->m_prev = c;
+		b2ContactState* oldContacts = m_contacts;
+		m_contactCapacity *= 2;
+		m_contacts = (b2ContactState*)b2Alloc(m_contactCapacity * sizeof(b2ContactState));
+		memcpy(m_contacts, oldContacts, m_contactCount * sizeof(b2ContactState));
+		b2Free(oldContacts);
+
+		for (int32 i = 0; i < m_contactCount; ++i)
+		{
+			m_contacts[i].contact->m_state = m_contacts + i;
+		}
 	}
-	m_contactList = c;
+
+	b2ContactState* state = m_contacts + m_contactCount;
+	state->contact = c;
+	state->flags = b2Contact::e_enabledFlag;
+	state->fixtureA = fixtureA;
+	state->fixtureB = fixtureB;
+	state->indexA = indexA;
+	state->indexB = indexB;
+	state->toiCount = 0;
+	state->toi = 1.0f;
+	state->activeIndex = b2_nullActiveIndex;
+	state->friction = b2MixFriction(fixtureA->m_friction, fixtureB->m_friction);
+	state->restitution = b2MixRestitution(fixtureA->m_restitution, fixtureB->m_restitution);
+	state->tangentSpeed = 0.0f;
+	state->manifold.pointCount = 0;
+	c->m_state = state;
+
+	++m_contactCount;
+	m_contacts[m_contactCount].contact = NULL;
+
+	// Assign a handle.
+	if (m_freeSlot == -1)
+	{
+		if (m_slotCount == m_slotCapacity)
+		{
+			b2ContactSlot* oldSlots = m_slots;
+			m_slotCapacity *= 2;
+			m_slots = (b2ContactSlot*)b2Alloc(m_slotCapacity * sizeof(b2ContactSlot));
+			memcpy(m_slots, oldSlots, m_slotCount * sizeof(b2ContactSlot));
+			b2Free(oldSlots);
+		}
+
+		m_slots[m_slotCount].generation = 0;
+		m_freeSlot = m_slotCount;
+		m_slots[m_slotCount].next = -1;
+		++m_slotCount;
+	}
+
+	int32 id = m_freeSlot;
+	m_freeSlot = m_slots[id].next;
+	m_slots[id].contact = c;
+	c->m_id = id;
+	c->m_generation = m_slots[id].generation;
 
 	// Connect to island graph.
 
@@ -292,5 +594,11 @@ void b2ContactManager::AddPair(void* proxyUserDataA, void* proxyUserDataB)
 		bodyB->SetAwake(true);
 	}
 
-	++m_contactCount;
+	// Waking a body activates its contacts, but sensors don't wake bodies.
+	bool activeA = bodyA->IsAwake() && bodyA->m_type != b2_staticBody;
+	bool activeB = bodyB->IsAwake() && bodyB->m_type != b2_staticBody;
+	if (state->activeIndex == b2_nullActiveIndex && (activeA || activeB))
+	{
+		AddActive(c);
+	}
 }
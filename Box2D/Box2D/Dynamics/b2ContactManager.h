@@ -20,33 +20,93 @@
 #define B2_CONTACT_MANAGER_H
 
 #include <Box2D/Collision/b2BroadPhase.h>
+#include <Box2D/Dynamics/b2ImpulseCache.h>
 
 class b2Contact;
 class b2ContactFilter;
 class b2ContactListener;
 class b2BlockAllocator;
+class b2Body;
+class b2Fixture;
+struct b2FixtureProxy;
+struct b2ContactState;
+struct b2ContactHandle;
+
+// Entry in the contact handle table.
+struct b2ContactSlot
+{
+	b2Contact* contact;		// NULL if the slot is free
+	int32 next;				// next free slot
+	uint32 generation;		// incremented when the slot is freed
+};
 
 // Delegate of b2World.
 class b2ContactManager
 {
 public:
 	b2ContactManager();
+	~b2ContactManager();
 
 	// Broad-phase callback.
 	void AddPair(void* proxyUserDataA, void* proxyUserDataB);
 
+	// Create a contact for these fixture children unless one exists.
+	void AddContact(b2Fixture* fixtureA, int32 indexA, b2Fixture* fixtureB, int32 indexB);
+
+	// A shape with a child query pairs with the children near the other proxy.
+	void AddChildPair(b2FixtureProxy* parentProxy, b2FixtureProxy* otherProxy);
+
 	void FindNewContacts();
 
+	// The broad-phase prunes the pairs by filter while the default filter is used.
+	void SetContactFilter(b2ContactFilter* filter);
+
 	void Destroy(b2Contact* c);
 
+	// Returns NULL if the contact has been destroyed.
+	b2Contact* GetContact(const b2ContactHandle& handle) const;
+
 	void Collide();
+
+	// Apply filtering and the broad-phase overlap test. Returns false if the
+	// contact was destroyed.
+	bool Persist(b2ContactState* state);
+
+	// Called when a body wakes up or falls asleep.
+	void ActivateContacts(b2Body* body);
+	void DeactivateContacts(b2Body* body);
+
+	void AddActive(b2Contact* c);
+	void RemoveActive(b2Contact* c);
             
 	b2BroadPhase m_broadPhase;
-	b2Contact* m_contactList;
+
+	// The contact pool, in world list order. The entry at m_contactCount has a
+	// NULL contact to terminate the list.
+	b2ContactState* m_contacts;
 	int32 m_contactCount;
+	int32 m_contactCapacity;
+
+	// Pool indices of the contacts with at least one awake, non-static body.
+	int32* m_activeContacts;
+	int32 m_activeCount;
+	int32 m_activeCapacity;
+
+	b2ContactSlot* m_slots;
+	int32 m_slotCount;
+	int32 m_slotCapacity;
+	int32 m_freeSlot;
+
 	b2ContactFilter* m_contactFilter;
 	b2ContactListener* m_contactListener;
 	b2BlockAllocator* m_allocator;
+
+	// Impulses of contact points that stopped touching.
+	b2ImpulseCache m_impulseCache;
+	bool m_impulseCaching;
+
+	// Leave the sensor contacts for the next step, see b2World::Step.
+	bool m_skipSensors;
 };
 
 #endif
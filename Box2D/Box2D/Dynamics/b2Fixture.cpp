@@ -23,10 +23,24 @@
 #include <Box2D/Collision/Shapes/b2EdgeShape.h>
 #include <Box2D/Collision/Shapes/b2PolygonShape.h>
 #include <Box2D/Collision/Shapes/b2ChainShape.h>
+#include <Box2D/Collision/Shapes/b2CompoundShape.h>
+#include <Box2D/Collision/Shapes/b2HeightFieldShape.h>
+#include <Box2D/Collision/Shapes/b2CapsuleShape.h>
 #include <Box2D/Collision/b2BroadPhase.h>
 #include <Box2D/Collision/b2Collision.h>
 #include <Box2D/Common/b2BlockAllocator.h>
 
+// A shape with a child query has one proxy for all of its children.
+static int32 b2GetProxyCapacity(const b2Shape* shape)
+{
+	if (shape->HasChildQuery())
+	{
+		return 1;
+	}
+
+	return shape->GetChildCount();
+}
+
 b2Fixture::b2Fixture()
 {
 	m_userData = NULL;
@@ -54,9 +68,9 @@ void b2Fixture::Create(b2BlockAllocator* allocator, b2Body* body, const b2Fixtur
 	m_shape = def->shape->Clone(allocator);
 
 	// Reserve proxy space
-	int32 childCount = m_shape->GetChildCount();
-	m_proxies = (b2FixtureProxy*)allocator->Allocate(childCount * sizeof(b2FixtureProxy));
-	for (int32 i = 0; i < childCount; ++i)
+	int32 proxyCapacity = b2GetProxyCapacity(m_shape);
+	m_proxies = (b2FixtureProxy*)allocator->Allocate(proxyCapacity * sizeof(b2FixtureProxy));
+	for (int32 i = 0; i < proxyCapacity; ++i)
 	{
 		m_proxies[i].fixture = NULL;
 		m_proxies[i].proxyId = b2BroadPhase::e_nullProxy;
@@ -72,16 +86,26 @@ void b2Fixture::Destroy(b2BlockAllocator* allocator)
 	b2Assert(m_proxyCount == 0);
 
 	// Free the proxy array.
-	int32 childCount = m_shape->GetChildCount();
-	allocator->Free(m_proxies, childCount * sizeof(b2FixtureProxy));
+	int32 proxyCapacity = b2GetProxyCapacity(m_shape);
+	allocator->Free(m_proxies, proxyCapacity * sizeof(b2FixtureProxy));
 	m_proxies = NULL;
 
-	// Free the child shape.
-	switch (m_shape->m_type)
+	// Free the child shape, unless a query snapshot may still use it.
+	if (m_body->GetWorld()->RetireShape(m_shape) == false)
+	{
+		DestroyShape(allocator, m_shape);
+	}
+
+	m_shape = NULL;
+}
+
+void b2Fixture::DestroyShape(b2BlockAllocator* allocator, b2Shape* shape)
+{
+	switch (shape->m_type)
 	{
 	case b2Shape::e_circle:
 		{
-			b2CircleShape* s = (b2CircleShape*)m_shape;
+			b2CircleShape* s = (b2CircleShape*)shape;
 			s->~b2CircleShape();
 			allocator->Free(s, sizeof(b2CircleShape));
 		}
@@ -89,7 +113,7 @@ void b2Fixture::Destroy(b2BlockAllocator* allocator)
 
 	case b2Shape::e_edge:
 		{
-			b2EdgeShape* s = (b2EdgeShape*)m_shape;
+			b2EdgeShape* s = (b2EdgeShape*)shape;
 			s->~b2EdgeShape();
 			allocator->Free(s, sizeof(b2EdgeShape));
 		}
@@ -97,7 +121,7 @@ void b2Fixture::Destroy(b2BlockAllocator* allocator)
 
 	case b2Shape::e_polygon:
 		{
-			b2PolygonShape* s = (b2PolygonShape*)m_shape;
+			b2PolygonShape* s = (b2PolygonShape*)shape;
 			s->~b2PolygonShape();
 			allocator->Free(s, sizeof(b2PolygonShape));
 		}
@@ -105,37 +129,80 @@ void b2Fixture::Destroy(b2BlockAllocator* allocator)
 
 	case b2Shape::e_chain:
 		{
-			b2ChainShape* s = (b2ChainShape*)m_shape;
+			b2ChainShape* s = (b2ChainShape*)shape;
 			s->~b2ChainShape();
 			allocator->Free(s, sizeof(b2ChainShape));
 		}
 		break;
 
+	case b2Shape::e_compound:
+		{
+			b2CompoundShape* s = (b2CompoundShape*)shape;
+			s->~b2CompoundShape();
+			allocator->Free(s, sizeof(b2CompoundShape));
+		}
+		break;
+
+	case b2Shape::e_heightField:
+		{
+			b2HeightFieldShape* s = (b2HeightFieldShape*)shape;
+			s->~b2HeightFieldShape();
+			allocator->Free(s, sizeof(b2HeightFieldShape));
+		}
+		break;
+
+	case b2Shape::e_capsule:
+		{
+			b2CapsuleShape* s = (b2CapsuleShape*)shape;
+			s->~b2CapsuleShape();
+			allocator->Free(s, sizeof(b2CapsuleShape));
+		}
+		break;
+
 	default:
 		b2Assert(false);
 		break;
 	}
-
-	m_shape = NULL;
 }
 
 void b2Fixture::CreateProxies(b2BroadPhase* broadPhase, const b2Transform& xf)
 {
 	b2Assert(m_proxyCount == 0);
 
+	InitializeProxies(xf);
+
 	// Create proxies in the broad-phase.
-	m_proxyCount = m_shape->GetChildCount();
+	for (int32 i = 0; i < m_proxyCount; ++i)
+	{
+		b2FixtureProxy* proxy = m_proxies + i;
+		proxy->proxyId = broadPhase->CreateProxy(proxy->aabb, proxy, m_filter);
+	}
+}
+
+void b2Fixture::InitializeProxies(const b2Transform& xf)
+{
+	m_proxyCount = b2GetProxyCapacity(m_shape);
 
 	for (int32 i = 0; i < m_proxyCount; ++i)
 	{
 		b2FixtureProxy* proxy = m_proxies + i;
-		m_shape->ComputeAABB(&proxy->aabb, xf, i);
-		proxy->proxyId = broadPhase->CreateProxy(proxy->aabb, proxy);
+		ComputeProxyAABB(&proxy->aabb, xf, i);
 		proxy->fixture = this;
 		proxy->childIndex = i;
 	}
 }
 
+void b2Fixture::ComputeProxyAABB(b2AABB* aabb, const b2Transform& xf, int32 childIndex) const
+{
+	if (m_shape->HasChildQuery())
+	{
+		m_shape->ComputeChildrenAABB(aabb, xf);
+		return;
+	}
+
+	m_shape->ComputeAABB(aabb, xf, childIndex);
+}
+
 void b2Fixture::DestroyProxies(b2BroadPhase* broadPhase)
 {
 	// Destroy proxies in the broad-phase.
@@ -162,8 +229,8 @@ void b2Fixture::Synchronize(b2BroadPhase* broadPhase, const b2Transform& transfo
 
 		// Compute an AABB that covers the swept shape (may miss some rotation effect).
 		b2AABB aabb1, aabb2;
-		m_shape->ComputeAABB(&aabb1, transform1, proxy->childIndex);
-		m_shape->ComputeAABB(&aabb2, transform2, proxy->childIndex);
+		ComputeProxyAABB(&aabb1, transform1, proxy->childIndex);
+		ComputeProxyAABB(&aabb2, transform2, proxy->childIndex);
 	
 		proxy->aabb.Combine(aabb1, aabb2);
 
@@ -209,10 +276,12 @@ void b2Fixture::Refilter()
 		return;
 	}
 
-	// Touch each proxy so that new pairs may be created
+	// Update the filter in the tree and touch each proxy so that new pairs
+	// may be created.
 	b2BroadPhase* broadPhase = &world->m_contactManager.m_broadPhase;
 	for (int32 i = 0; i < m_proxyCount; ++i)
 	{
+		broadPhase->SetFilter(m_proxies[i].proxyId, m_filter);
 		broadPhase->TouchProxy(m_proxies[i].proxyId);
 	}
 }
@@ -289,6 +358,56 @@ void b2Fixture::Dump(int32 bodyIndex)
 			b2Log("    shape.m_nextVertex.Set(%.15lef, %.15lef);\n", s->m_nextVertex.x, s->m_nextVertex.y);
 			b2Log("    shape.m_hasPrevVertex = bool(%d);\n", s->m_hasPrevVertex);
 			b2Log("    shape.m_hasNextVertex = bool(%d);\n", s->m_hasNextVertex);
+			if (s->HasTree())
+			{
+				b2Log("    shape.BuildTree();\n");
+			}
+		}
+		break;
+
+	case b2Shape::e_compound:
+		{
+			b2CompoundShape* s = (b2CompoundShape*)m_shape;
+			b2Log("    b2CompoundShape shape;\n");
+			b2Log("    b2PolygonShape* polygons = new b2PolygonShape[%d];\n", s->m_childCount);
+			for (int32 i = 0; i < s->m_childCount; ++i)
+			{
+				const b2CompoundChild* child = s->m_children + i;
+				b2Log("    {\n");
+				b2Log("      b2Vec2 vs[%d];\n", b2_maxPolygonVertices);
+				for (int32 j = 0; j < child->count; ++j)
+				{
+					const b2Vec2& v = s->m_vertices[child->firstVertex + j];
+					b2Log("      vs[%d].Set(%.15lef, %.15lef);\n", j, v.x, v.y);
+				}
+				b2Log("      polygons[%d].Set(vs, %d);\n", i, child->count);
+				b2Log("    }\n");
+			}
+			b2Log("    shape.Create(polygons, %d);\n", s->m_childCount);
+			b2Log("    delete [] polygons;\n");
+		}
+		break;
+
+	case b2Shape::e_heightField:
+		{
+			b2HeightFieldShape* s = (b2HeightFieldShape*)m_shape;
+			b2Log("    b2HeightFieldShape shape;\n");
+			b2Log("    float32 heights[%d];\n", s->m_count);
+			for (int32 i = 0; i < s->m_count; ++i)
+			{
+				b2Log("    heights[%d] = %.15lef;\n", i, s->m_heights[i]);
+			}
+			b2Log("    shape.Create(heights, %d, %.15lef);\n", s->m_count, s->m_cellWidth);
+		}
+		break;
+
+	case b2Shape::e_capsule:
+		{
+			b2CapsuleShape* s = (b2CapsuleShape*)m_shape;
+			b2Log("    b2CapsuleShape shape;\n");
+			b2Log("    shape.m_radius = %.15lef;\n", s->m_radius);
+			b2Log("    shape.m_vertex1.Set(%.15lef, %.15lef);\n", s->m_vertex1.x, s->m_vertex1.y);
+			b2Log("    shape.m_vertex2.Set(%.15lef, %.15lef);\n", s->m_vertex2.x, s->m_vertex2.y);
 		}
 		break;
 
@@ -28,29 +28,6 @@ class b2Body;
 class b2BroadPhase;
 class b2Fixture;
 
-/// This holds contact filtering data.
-struct b2Filter
-{
-	b2Filter()
-	{
-		categoryBits = 0x0001;
-		maskBits = 0xFFFF;
-		groupIndex = 0;
-	}
-
-	/// The collision category bits. Normally you would just set one bit.
-	uint16 categoryBits;
-
-	/// The collision mask bits. This states the categories that this
-	/// shape would accept for collision.
-	uint16 maskBits;
-
-	/// Collision groups allow a certain group of objects to never collide (negative)
-	/// or always collide (positive). Zero means no collision group. Non-zero group
-	/// filtering always wins against the mask bits.
-	int16 groupIndex;
-};
-
 /// A fixture definition is used to create a fixture. This class defines an
 /// abstract fixture definition. You can reuse fixture definitions safely.
 struct b2FixtureDef
@@ -189,7 +166,7 @@ public:
 
 	/// Get the fixture's AABB. This AABB may be enlarge and/or stale.
 	/// If you need a more accurate AABB, compute it using the shape and
-	/// the body transform.
+	/// the body transform. A shape with a child tree has a single AABB.
 	const b2AABB& GetAABB(int32 childIndex) const;
 
 	/// Dump this fixture to the log file.
@@ -201,6 +178,7 @@ protected:
 	friend class b2World;
 	friend class b2Contact;
 	friend class b2ContactManager;
+	friend class b2QuerySnapshot;
 
 	b2Fixture();
 
@@ -209,12 +187,20 @@ protected:
 	void Create(b2BlockAllocator* allocator, b2Body* body, const b2FixtureDef* def);
 	void Destroy(b2BlockAllocator* allocator);
 
+	// Free a shape of a fixture.
+	static void DestroyShape(b2BlockAllocator* allocator, b2Shape* shape);
+
 	// These support body activation/deactivation.
 	void CreateProxies(b2BroadPhase* broadPhase, const b2Transform& xf);
 	void DestroyProxies(b2BroadPhase* broadPhase);
 
+	// Compute the proxy AABBs without creating the proxies in the broad-phase.
+	void InitializeProxies(const b2Transform& xf);
+
 	void Synchronize(b2BroadPhase* broadPhase, const b2Transform& xf1, const b2Transform& xf2);
 
+	void ComputeProxyAABB(b2AABB* aabb, const b2Transform& xf, int32 childIndex) const;
+
 	float32 m_density;
 
 	b2Fixture* m_next;
@@ -0,0 +1,195 @@
+/*
+* Copyright (c) 2006-2009 Erin Catto http://www.box2d.org
+*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include <Box2D/Dynamics/b2ImpulseCache.h>
+#include <Box2D/Dynamics/Contacts/b2Contact.h>
+#include <string.h>
+
+static inline uint32 b2HashCombine(uint32 hash, uint32 value)
+{
+	hash ^= value + 0x9e3779b9 + (hash << 6) + (hash >> 2);
+	return hash;
+}
+
+static inline uint32 b2HashPointer(const void* p)
+{
+	// Fold the high bits of 64 bit pointers.
+	size_t x = (size_t)p;
+	return uint32(x) ^ uint32((x >> 16) >> 16);
+}
+
+static inline uint32 b2HashKey(const b2Fixture* fixtureA, int32 indexA,
+							   const b2Fixture* fixtureB, int32 indexB, uint32 id)
+{
+	uint32 hash = b2HashPointer(fixtureA);
+	hash = b2HashCombine(hash, b2HashPointer(fixtureB));
+	hash = b2HashCombine(hash, uint32(indexA));
+	hash = b2HashCombine(hash, uint32(indexB));
+	hash = b2HashCombine(hash, id);
+
+	// Final mix so that the low bits depend on all of the key.
+	hash ^= hash >> 16;
+	hash *= 0x85ebca6b;
+	hash ^= hash >> 13;
+	hash *= 0xc2b2ae35;
+	hash ^= hash >> 16;
+	return hash;
+}
+
+b2ImpulseCache::b2ImpulseCache()
+{
+	m_entries = NULL;
+	m_capacity = 0;
+	m_count = 0;
+	m_stamp = 0;
+	m_rebuildStamp = 0;
+}
+
+b2ImpulseCache::~b2ImpulseCache()
+{
+	b2Free(m_entries);
+}
+
+void b2ImpulseCache::Step()
+{
+	++m_stamp;
+
+	if (m_count > 0 && m_stamp - m_rebuildStamp > b2_impulseCacheSteps)
+	{
+		Rebuild(m_capacity);
+	}
+}
+
+b2ImpulseCacheEntry* b2ImpulseCache::Find(const b2Fixture* fixtureA, int32 indexA,
+										  const b2Fixture* fixtureB, int32 indexB, uint32 id) const
+{
+	b2Assert(m_capacity > 0);
+
+	// The table is never more than half full, so the probe ends on an empty entry.
+	uint32 mask = uint32(m_capacity - 1);
+	uint32 i = b2HashKey(fixtureA, indexA, fixtureB, indexB, id) & mask;
+	for (;;)
+	{
+		b2ImpulseCacheEntry* entry = m_entries + i;
+		if (entry->fixtureA == NULL)
+		{
+			return entry;
+		}
+
+		if (entry->fixtureA == fixtureA && entry->fixtureB == fixtureB &&
+			entry->indexA == indexA && entry->indexB == indexB && entry->id == id)
+		{
+			return entry;
+		}
+
+		i = (i + 1) & mask;
+	}
+}
+
+void b2ImpulseCache::Store(const b2Contact* contact, const b2ManifoldPoint* point)
+{
+	if (2 * (m_count + 1) > m_capacity)
+	{
+		Rebuild(b2Max(32, 2 * m_capacity));
+	}
+
+	const b2Fixture* fixtureA = contact->GetFixtureA();
+	const b2Fixture* fixtureB = contact->GetFixtureB();
+	int32 indexA = contact->GetChildIndexA();
+	int32 indexB = contact->GetChildIndexB();
+
+	b2ImpulseCacheEntry* entry = Find(fixtureA, indexA, fixtureB, indexB, point->id.key);
+	if (entry->fixtureA == NULL)
+	{
+		entry->fixtureA = fixtureA;
+		entry->fixtureB = fixtureB;
+		entry->indexA = indexA;
+		entry->indexB = indexB;
+		entry->id = point->id.key;
+		++m_count;
+	}
+
+	entry->stamp = m_stamp;
+	entry->normalImpulse = point->normalImpulse;
+	entry->tangentImpulse = point->tangentImpulse;
+}
+
+bool b2ImpulseCache::Restore(const b2Contact* contact, b2ManifoldPoint* point) const
+{
+	if (m_count == 0)
+	{
+		return false;
+	}
+
+	const b2ImpulseCacheEntry* entry = Find(contact->GetFixtureA(), contact->GetChildIndexA(),
+											contact->GetFixtureB(), contact->GetChildIndexB(), point->id.key);
+	if (entry->fixtureA == NULL || IsExpired(entry))
+	{
+		return false;
+	}
+
+	point->normalImpulse = entry->normalImpulse;
+	point->tangentImpulse = entry->tangentImpulse;
+	return true;
+}
+
+void b2ImpulseCache::RemoveFixture(const b2Fixture* fixture)
+{
+	if (m_count == 0)
+	{
+		return;
+	}
+
+	// Expire the entries. The next rebuild drops them.
+	for (int32 i = 0; i < m_capacity; ++i)
+	{
+		b2ImpulseCacheEntry* entry = m_entries + i;
+		if (entry->fixtureA == fixture || entry->fixtureB == fixture)
+		{
+			entry->stamp = m_stamp - b2_impulseCacheSteps - 1;
+		}
+	}
+}
+
+void b2ImpulseCache::Rebuild(int32 capacity)
+{
+	b2ImpulseCacheEntry* oldEntries = m_entries;
+	int32 oldCapacity = m_capacity;
+
+	m_capacity = capacity;
+	m_entries = (b2ImpulseCacheEntry*)b2Alloc(m_capacity * sizeof(b2ImpulseCacheEntry));
+	memset(m_entries, 0, m_capacity * sizeof(b2ImpulseCacheEntry));
+	m_count = 0;
+	m_rebuildStamp = m_stamp;
+
+	for (int32 i = 0; i < oldCapacity; ++i)
+	{
+		const b2ImpulseCacheEntry* oldEntry = oldEntries + i;
+		if (oldEntry->fixtureA == NULL || IsExpired(oldEntry))
+		{
+			continue;
+		}
+
+		b2ImpulseCacheEntry* entry = Find(oldEntry->fixtureA, oldEntry->indexA,
+										  oldEntry->fixtureB, oldEntry->indexB, oldEntry->id);
+		*entry = *oldEntry;
+		++m_count;
+	}
+
+	b2Free(oldEntries);
+}
@@ -0,0 +1,88 @@
+/*
+* Copyright (c) 2006-2009 Erin Catto http://www.box2d.org
+*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#ifndef B2_IMPULSE_CACHE_H
+#define B2_IMPULSE_CACHE_H
+
+#include <Box2D/Common/b2Settings.h>
+
+class b2Contact;
+class b2Fixture;
+struct b2ManifoldPoint;
+
+// A cache entry. An entry with a NULL fixtureA is empty.
+struct b2ImpulseCacheEntry
+{
+	const b2Fixture* fixtureA;
+	const b2Fixture* fixtureB;
+	int32 indexA;
+	int32 indexB;
+	uint32 id;
+	int32 stamp;
+	float32 normalImpulse;
+	float32 tangentImpulse;
+};
+
+// Keeps the impulses of contact points that stopped touching for a few time
+// steps, keyed by the fixtures, the child indices and the contact id. A point
+// that comes back within that time is warm started with its old impulses, even
+// if its contact was destroyed and created again in the meantime.
+// This is a hash table with linear probing. Entries are never removed one by one,
+// instead the table is rebuilt without the expired entries every few steps.
+class b2ImpulseCache
+{
+public:
+	b2ImpulseCache();
+	~b2ImpulseCache();
+
+	// Advance the time stamp. Call this once per time step.
+	void Step();
+
+	// Keep the impulses of a point that the contact lost.
+	void Store(const b2Contact* contact, const b2ManifoldPoint* point);
+
+	// Copy the impulses of a lost point with the same key. Returns false
+	// if there is none.
+	bool Restore(const b2Contact* contact, b2ManifoldPoint* point) const;
+
+	// Forget the points of a fixture that is being destroyed.
+	void RemoveFixture(const b2Fixture* fixture);
+
+	int32 GetCount() const { return m_count; }
+
+private:
+
+	b2ImpulseCacheEntry* Find(const b2Fixture* fixtureA, int32 indexA,
+							  const b2Fixture* fixtureB, int32 indexB, uint32 id) const;
+
+	// Rebuild the table with the given capacity, dropping expired entries.
+	void Rebuild(int32 capacity);
+
+	bool IsExpired(const b2ImpulseCacheEntry* entry) const
+	{
+		return m_stamp - entry->stamp > b2_impulseCacheSteps;
+	}
+
+	b2ImpulseCacheEntry* m_entries;
+	int32 m_capacity;
+	int32 m_count;
+	int32 m_stamp;
+	int32 m_rebuildStamp;
+};
+
+#endif
@@ -18,14 +18,17 @@
 
 #include <Box2D/Collision/b2Distance.h>
 #include <Box2D/Dynamics/b2Island.h>
+#include <Box2D/Dynamics/b2ColoredSolver.h>
 #include <Box2D/Dynamics/b2Body.h>
 #include <Box2D/Dynamics/b2Fixture.h>
 #include <Box2D/Dynamics/b2World.h>
 #include <Box2D/Dynamics/Contacts/b2Contact.h>
 #include <Box2D/Dynamics/Contacts/b2ContactSolver.h>
+#include <Box2D/Dynamics/Contacts/b2SoftContactSolver.h>
 #include <Box2D/Dynamics/Joints/b2Joint.h>
 #include <Box2D/Common/b2StackAllocator.h>
 #include <Box2D/Common/b2Timer.h>
+#include <string.h>
 
 /*
 Position Correction Notes
@@ -162,6 +165,9 @@ b2Island::b2Island(
 	m_allocator = allocator;
 	m_listener = listener;
 
+	m_executor = NULL;
+	m_parallelThreshold = 0;
+
 	m_bodies = (b2Body**)m_allocator->Allocate(bodyCapacity * sizeof(b2Body*));
 	m_contacts = (b2Contact**)m_allocator->Allocate(contactCapacity	 * sizeof(b2Contact*));
 	m_joints = (b2Joint**)m_allocator->Allocate(jointCapacity * sizeof(b2Joint*));
@@ -182,6 +188,12 @@ b2Island::~b2Island()
 
 void b2Island::Solve(b2Profile* profile, const b2TimeStep& step, const b2Vec2& gravity, bool allowSleep)
 {
+	if (step.solverSubSteps > 0)
+	{
+		SolveSoft(profile, step, gravity, allowSleep);
+		return;
+	}
+
 	b2Timer timer;
 
 	float32 h = step.dt;
@@ -231,6 +243,15 @@ void b2Island::Solve(b2Profile* profile, const b2TimeStep& step, const b2Vec2& g
 	solverData.positions = m_positions;
 	solverData.velocities = m_velocities;
 
+	// Large islands are partitioned by graph coloring. This sorts the contacts
+	// and joints, so it comes before the contact solver.
+	bool colored = m_parallelThreshold > 0 && m_bodyCount >= m_parallelThreshold;
+	b2ColoredSolver coloredSolver;
+	if (colored)
+	{
+		coloredSolver.Create(this, m_executor);
+	}
+
 	// Initialize velocity constraints.
 	b2ContactSolverDef contactSolverDef;
 	contactSolverDef.step = step;
@@ -241,32 +262,75 @@ void b2Island::Solve(b2Profile* profile, const b2TimeStep& step, const b2Vec2& g
 	contactSolverDef.allocator = m_allocator;
 
 	b2ContactSolver contactSolver(&contactSolverDef);
-	contactSolver.InitializeVelocityConstraints();
-
-	if (step.warmStarting)
+	if (colored)
 	{
-		contactSolver.WarmStart();
+		coloredSolver.InitializeVelocityConstraints(&contactSolver, solverData);
 	}
-	
-	for (int32 i = 0; i < m_jointCount; ++i)
+	else
 	{
-		m_joints[i]->InitVelocityConstraints(solverData);
+		contactSolver.InitializeVelocityConstraints();
+
+		if (step.warmStarting)
+		{
+			contactSolver.WarmStart();
+		}
+
+		for (int32 i = 0; i < m_jointCount; ++i)
+		{
+			m_joints[i]->InitVelocityConstraints(solverData);
+		}
 	}
 
 	profile->solveInit = timer.GetMilliseconds();
 
-	// Solve velocity constraints
+	// Solve velocity constraints. With a tolerance the iterations stop as soon as
+	// an iteration changes the momentum of every body by less than the tolerance.
 	timer.Reset();
-	for (int32 i = 0; i < step.velocityIterations; ++i)
+	bool adaptive = step.velocityTolerance > 0.0f;
+	b2Velocity* oldVelocities = NULL;
+	if (adaptive)
 	{
-		for (int32 j = 0; j < m_jointCount; ++j)
+		oldVelocities = (b2Velocity*)m_allocator->Allocate(m_bodyCount * sizeof(b2Velocity));
+	}
+
+	int32 velocityIterations = 0;
+	while (velocityIterations < step.velocityIterations)
+	{
+		if (adaptive)
 		{
-			m_joints[j]->SolveVelocityConstraints(solverData);
+			memcpy(oldVelocities, m_velocities, m_bodyCount * sizeof(b2Velocity));
 		}
 
-		contactSolver.SolveVelocityConstraints();
+		if (colored)
+		{
+			coloredSolver.SolveVelocityConstraints();
+		}
+		else
+		{
+			for (int32 j = 0; j < m_jointCount; ++j)
+			{
+				m_joints[j]->SolveVelocityConstraints(solverData);
+			}
+
+			contactSolver.SolveVelocityConstraints();
+		}
+
+		++velocityIterations;
+
+		if (adaptive && velocityIterations >= step.minVelocityIterations &&
+			GetMaxImpulseDelta(oldVelocities) <= step.velocityTolerance)
+		{
+			break;
+		}
 	}
 
+	if (adaptive)
+	{
+		m_allocator->Free(oldVelocities);
+	}
+
+	profile->velocityIterations = float32(velocityIterations);
+
 	// Store impulses for warm starting
 	contactSolver.StoreImpulses();
 	profile->solveVelocity = timer.GetMilliseconds();
@@ -307,8 +371,23 @@ void b2Island::Solve(b2Profile* profile, const b2TimeStep& step, const b2Vec2& g
 	// Solve position constraints
 	timer.Reset();
 	bool positionSolved = false;
+	int32 positionIterations = 0;
 	for (int32 i = 0; i < step.positionIterations; ++i)
 	{
+		++positionIterations;
+
+		if (colored)
+		{
+			if (coloredSolver.SolvePositionConstraints())
+			{
+				// Exit early if the position errors are small.
+				positionSolved = true;
+				break;
+			}
+
+			continue;
+		}
+
 		bool contactsOkay = contactSolver.SolvePositionConstraints();
 
 		bool jointsOkay = true;
@@ -338,46 +417,231 @@ void b2Island::Solve(b2Profile* profile, const b2TimeStep& step, const b2Vec2& g
 	}
 
 	profile->solvePosition = timer.GetMilliseconds();
+	profile->positionIterations = float32(positionIterations);
 
 	Report(contactSolver.m_velocityConstraints);
 
 	if (allowSleep)
 	{
-		float32 minSleepTime = b2_maxFloat;
+		UpdateSleep(h, positionSolved);
+	}
+}
+
+float32 b2Island::GetMaxImpulseDelta(const b2Velocity* oldVelocities) const
+{
+	float32 maxImpulse = 0.0f;
+	for (int32 i = 0; i < m_bodyCount; ++i)
+	{
+		b2Body* b = m_bodies[i];
+		if (b->m_type != b2_dynamicBody)
+		{
+			continue;
+		}
+
+		float32 linearImpulse = b->m_mass * (m_velocities[i].v - oldVelocities[i].v).Length();
+		float32 angularImpulse = b->m_I * b2Abs(m_velocities[i].w - oldVelocities[i].w);
+		maxImpulse = b2Max(maxImpulse, b2Max(linearImpulse, angularImpulse));
+	}
+
+	return maxImpulse;
+}
 
-		const float32 linTolSqr = b2_linearSleepTolerance * b2_linearSleepTolerance;
-		const float32 angTolSqr = b2_angularSleepTolerance * b2_angularSleepTolerance;
+void b2Island::UpdateSleep(float32 h, bool positionSolved)
+{
+	float32 minSleepTime = b2_maxFloat;
+
+	const float32 linTolSqr = b2_linearSleepTolerance * b2_linearSleepTolerance;
+	const float32 angTolSqr = b2_angularSleepTolerance * b2_angularSleepTolerance;
+
+	for (int32 i = 0; i < m_bodyCount; ++i)
+	{
+		b2Body* b = m_bodies[i];
+		if (b->GetType() == b2_staticBody)
+		{
+			continue;
+		}
+
+		if ((b->m_flags & b2Body::e_autoSleepFlag) == 0 ||
+			b->m_angularVelocity * b->m_angularVelocity > angTolSqr ||
+			b2Dot(b->m_linearVelocity, b->m_linearVelocity) > linTolSqr)
+		{
+			b->m_sleepTime = 0.0f;
+			minSleepTime = 0.0f;
+		}
+		else
+		{
+			b->m_sleepTime += h;
+			minSleepTime = b2Min(minSleepTime, b->m_sleepTime);
+		}
+	}
 
+	if (minSleepTime >= b2_timeToSleep && positionSolved)
+	{
 		for (int32 i = 0; i < m_bodyCount; ++i)
 		{
 			b2Body* b = m_bodies[i];
-			if (b->GetType() == b2_staticBody)
+			b->SetAwake(false);
+		}
+	}
+}
+
+void b2Island::SolveSoft(b2Profile* profile, const b2TimeStep& step, const b2Vec2& gravity, bool allowSleep)
+{
+	b2Timer timer;
+
+	int32 subStepCount = step.solverSubSteps;
+	float32 h = step.dt / subStepCount;
+
+	// The velocity limits of the iterative solver, which moves a body once per step.
+	float32 maxTranslation = b2_maxTranslation * step.inv_dt * h;
+	float32 maxRotation = b2_maxRotation * step.inv_dt * h;
+
+	// Initialize the body state.
+	for (int32 i = 0; i < m_bodyCount; ++i)
+	{
+		b2Body* b = m_bodies[i];
+
+		// Store positions for continuous collision.
+		b->m_sweep.c0 = b->m_sweep.c;
+		b->m_sweep.a0 = b->m_sweep.a;
+
+		m_positions[i].c = b->m_sweep.c;
+		m_positions[i].a = b->m_sweep.a;
+		m_velocities[i].v = b->m_linearVelocity;
+		m_velocities[i].w = b->m_angularVelocity;
+	}
+
+	// Solver data for the sub-steps.
+	b2TimeStep subStep = step;
+	subStep.dt = h;
+	subStep.inv_dt = h > 0.0f ? 1.0f / h : 0.0f;
+
+	b2SolverData solverData;
+	solverData.step = subStep;
+	solverData.positions = m_positions;
+	solverData.velocities = m_velocities;
+
+	b2ContactSolverDef contactSolverDef;
+	contactSolverDef.step = step;
+	contactSolverDef.contacts = m_contacts;
+	contactSolverDef.count = m_contactCount;
+	contactSolverDef.positions = m_positions;
+	contactSolverDef.velocities = m_velocities;
+	contactSolverDef.allocator = m_allocator;
+
+	b2SoftContactSolver contactSolver(&contactSolverDef, subStepCount);
+	contactSolver.Prepare();
+
+	profile->solveInit = timer.GetMilliseconds();
+
+	timer.Reset();
+	for (int32 i = 0; i < subStepCount; ++i)
+	{
+		// Integrate velocities and apply damping.
+		for (int32 j = 0; j < m_bodyCount; ++j)
+		{
+			b2Body* b = m_bodies[j];
+			if (b->m_type != b2_dynamicBody)
 			{
 				continue;
 			}
 
-			if ((b->m_flags & b2Body::e_autoSleepFlag) == 0 ||
-				b->m_angularVelocity * b->m_angularVelocity > angTolSqr ||
-				b2Dot(b->m_linearVelocity, b->m_linearVelocity) > linTolSqr)
+			b2Vec2 v = m_velocities[j].v;
+			float32 w = m_velocities[j].w;
+
+			v += h * (b->m_gravityScale * gravity + b->m_invMass * b->m_force);
+			w += h * b->m_invI * b->m_torque;
+
+			// See Solve.
+			v *= 1.0f / (1.0f + h * b->m_linearDamping);
+			w *= 1.0f / (1.0f + h * b->m_angularDamping);
+
+			m_velocities[j].v = v;
+			m_velocities[j].w = w;
+		}
+
+		// Joint impulses carry over from the previous sub-step.
+		solverData.step.dtRatio = i == 0 ? step.dtRatio : 1.0f;
+		for (int32 j = 0; j < m_jointCount; ++j)
+		{
+			m_joints[j]->InitVelocityConstraints(solverData);
+		}
+
+		if (step.warmStarting)
+		{
+			contactSolver.WarmStart();
+		}
+
+		for (int32 j = 0; j < m_jointCount; ++j)
+		{
+			m_joints[j]->SolveVelocityConstraints(solverData);
+		}
+
+		contactSolver.Solve(true);
+
+		// Integrate positions
+		for (int32 j = 0; j < m_bodyCount; ++j)
+		{
+			b2Vec2 v = m_velocities[j].v;
+			float32 w = m_velocities[j].w;
+
+			// Check for large velocities
+			b2Vec2 translation = h * v;
+			if (b2Dot(translation, translation) > maxTranslation * maxTranslation)
 			{
-				b->m_sleepTime = 0.0f;
-				minSleepTime = 0.0f;
+				float32 ratio = maxTranslation / translation.Length();
+				v *= ratio;
 			}
-			else
+
+			float32 rotation = h * w;
+			if (rotation * rotation > maxRotation * maxRotation)
 			{
-				b->m_sleepTime += h;
-				minSleepTime = b2Min(minSleepTime, b->m_sleepTime);
+				float32 ratio = maxRotation / b2Abs(rotation);
+				w *= ratio;
 			}
+
+			m_positions[j].c += h * v;
+			m_positions[j].a += h * w;
+			m_velocities[j].v = v;
+			m_velocities[j].w = w;
 		}
 
-		if (minSleepTime >= b2_timeToSleep && positionSolved)
+		// Joints don't have soft constraints, so remove their drift directly.
+		for (int32 j = 0; j < m_jointCount; ++j)
 		{
-			for (int32 i = 0; i < m_bodyCount; ++i)
-			{
-				b2Body* b = m_bodies[i];
-				b->SetAwake(false);
-			}
+			m_joints[j]->SolvePositionConstraints(solverData);
 		}
+
+		// Relax the contacts to remove the velocity added by the position bias.
+		contactSolver.Solve(false);
+	}
+
+	contactSolver.ApplyRestitution();
+	contactSolver.StoreImpulses();
+
+	profile->solveVelocity = timer.GetMilliseconds();
+	profile->solvePosition = 0.0f;
+	profile->velocityIterations = float32(subStepCount);
+	profile->positionIterations = 0.0f;
+
+	// Copy state buffers back to the bodies
+	for (int32 i = 0; i < m_bodyCount; ++i)
+	{
+		b2Body* body = m_bodies[i];
+		body->m_sweep.c = m_positions[i].c;
+		body->m_sweep.a = m_positions[i].a;
+		body->m_linearVelocity = m_velocities[i].v;
+		body->m_angularVelocity = m_velocities[i].w;
+		body->SynchronizeTransform();
+	}
+
+	Report(contactSolver.m_constraints);
+
+	if (allowSleep)
+	{
+		// See b2ContactSolver::SolvePositionConstraints.
+		bool positionSolved = contactSolver.GetMinSeparation() >= -3.0f * b2_linearSlop;
+		UpdateSleep(step.dt, positionSolved);
 	}
 }
 
@@ -537,3 +801,28 @@ void b2Island::Report(const b2ContactVelocityConstraint* constraints)
 		m_listener->PostSolve(c, &impulse);
 	}
 }
+
+void b2Island::Report(const b2SoftContactConstraint* constraints)
+{
+	if (m_listener == NULL)
+	{
+		return;
+	}
+
+	for (int32 i = 0; i < m_contactCount; ++i)
+	{
+		b2Contact* c = m_contacts[i];
+
+		const b2SoftContactConstraint* sc = constraints + i;
+
+		b2ContactImpulse impulse;
+		impulse.count = sc->pointCount;
+		for (int32 j = 0; j < sc->pointCount; ++j)
+		{
+			impulse.normalImpulses[j] = sc->points[j].totalNormalImpulse;
+			impulse.tangentImpulses[j] = sc->points[j].totalTangentImpulse;
+		}
+
+		m_listener->PostSolve(c, &impulse);
+	}
+}
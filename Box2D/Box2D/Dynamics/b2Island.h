@@ -27,7 +27,9 @@ class b2Contact;
 class b2Joint;
 class b2StackAllocator;
 class b2ContactListener;
+class b2TaskExecutor;
 struct b2ContactVelocityConstraint;
+struct b2SoftContactConstraint;
 struct b2Profile;
 
 /// This is an internal class.
@@ -49,6 +51,15 @@ public:
 
 	void SolveTOI(const b2TimeStep& subStep, int32 toiIndexA, int32 toiIndexB);
 
+	// Solve with sub-steps and soft contacts. See b2World::SetSolverSubSteps.
+	void SolveSoft(b2Profile* profile, const b2TimeStep& step, const b2Vec2& gravity, bool allowSleep);
+
+	// Put the island to sleep if all of its bodies have rested long enough.
+	void UpdateSleep(float32 h, bool positionSolved);
+
+	// The largest change of momentum of a body since the velocities were saved.
+	float32 GetMaxImpulseDelta(const b2Velocity* oldVelocities) const;
+
 	void Add(b2Body* body)
 	{
 		b2Assert(m_bodyCount < m_bodyCapacity);
@@ -70,10 +81,15 @@ public:
 	}
 
 	void Report(const b2ContactVelocityConstraint* constraints);
+	void Report(const b2SoftContactConstraint* constraints);
 
 	b2StackAllocator* m_allocator;
 	b2ContactListener* m_listener;
 
+	// Islands with at least this many bodies are solved by b2ColoredSolver.
+	b2TaskExecutor* m_executor;
+	int32 m_parallelThreshold;
+
 	b2Body** m_bodies;
 	b2Contact** m_contacts;
 	b2Joint** m_joints;
@@ -0,0 +1,323 @@
+/*
+* Copyright (c) 2006-2009 Erin Catto http://www.box2d.org
+*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include <Box2D/Dynamics/b2IslandManager.h>
+#include <Box2D/Dynamics/b2Body.h>
+#include <Box2D/Dynamics/b2Fixture.h>
+#include <Box2D/Dynamics/Contacts/b2Contact.h>
+#include <Box2D/Dynamics/Joints/b2Joint.h>
+#include <Box2D/Common/b2BlockAllocator.h>
+#include <Box2D/Common/b2StackAllocator.h>
+
+static void b2InsertIsland(b2PersistentIsland** list, b2PersistentIsland* island)
+{
+	island->prev = NULL;
+	island->next = *list;
+	if (*list)
+	{
+		(*list)->prev = island;
+	}
+	*list = island;
+}
+
+static void b2RemoveIsland(b2PersistentIsland** list, b2PersistentIsland* island)
+{
+	if (island->prev)
+	{
+		island->prev->next = island->next;
+	}
+
+	if (island->next)
+	{
+		island->next->prev = island->prev;
+	}
+
+	if (island == *list)
+	{
+		*list = island->next;
+	}
+}
+
+b2IslandManager::b2IslandManager()
+{
+	m_awakeList = NULL;
+	m_sleepingList = NULL;
+	m_islandCount = 0;
+	m_allocator = NULL;
+}
+
+b2PersistentIsland* b2IslandManager::CreateIsland(bool awake)
+{
+	void* mem = m_allocator->Allocate(sizeof(b2PersistentIsland));
+	b2PersistentIsland* island = (b2PersistentIsland*)mem;
+	island->bodyList = NULL;
+	island->bodyTail = NULL;
+	island->bodyCount = 0;
+	island->constraintRemoveCount = 0;
+	island->awake = awake;
+
+	b2InsertIsland(awake ? &m_awakeList : &m_sleepingList, island);
+	++m_islandCount;
+
+	return island;
+}
+
+void b2IslandManager::DestroyIsland(b2PersistentIsland* island)
+{
+	b2RemoveIsland(island->awake ? &m_awakeList : &m_sleepingList, island);
+	m_allocator->Free(island, sizeof(b2PersistentIsland));
+	--m_islandCount;
+}
+
+void b2IslandManager::AppendBody(b2PersistentIsland* island, b2Body* body)
+{
+	body->m_island = island;
+	body->m_islandPrev = island->bodyTail;
+	body->m_islandNext = NULL;
+
+	if (island->bodyTail)
+	{
+		island->bodyTail->m_islandNext = body;
+	}
+	else
+	{
+		island->bodyList = body;
+	}
+
+	island->bodyTail = body;
+	++island->bodyCount;
+}
+
+void b2IslandManager::AddBody(b2Body* body)
+{
+	b2Assert(body->m_island == NULL);
+	b2Assert(body->GetType() != b2_staticBody && body->IsActive());
+
+	b2PersistentIsland* island = CreateIsland(body->IsAwake());
+	AppendBody(island, body);
+}
+
+void b2IslandManager::RemoveBody(b2Body* body)
+{
+	b2PersistentIsland* island = body->m_island;
+	if (island == NULL)
+	{
+		return;
+	}
+
+	if (body->m_islandPrev)
+	{
+		body->m_islandPrev->m_islandNext = body->m_islandNext;
+	}
+	else
+	{
+		island->bodyList = body->m_islandNext;
+	}
+
+	if (body->m_islandNext)
+	{
+		body->m_islandNext->m_islandPrev = body->m_islandPrev;
+	}
+	else
+	{
+		island->bodyTail = body->m_islandPrev;
+	}
+
+	body->m_island = NULL;
+	body->m_islandPrev = NULL;
+	body->m_islandNext = NULL;
+
+	--island->bodyCount;
+	if (island->bodyCount == 0)
+	{
+		DestroyIsland(island);
+	}
+	else
+	{
+		// The body may have held the island together.
+		++island->constraintRemoveCount;
+	}
+}
+
+void b2IslandManager::LinkBodies(b2Body* bodyA, b2Body* bodyB)
+{
+	b2PersistentIsland* islandA = bodyA->m_island;
+	b2PersistentIsland* islandB = bodyB->m_island;
+
+	// Static and inactive bodies don't join islands.
+	if (islandA == NULL || islandB == NULL || islandA == islandB)
+	{
+		return;
+	}
+
+	// Relabel the smaller island.
+	b2PersistentIsland* big = islandA;
+	b2PersistentIsland* small = islandB;
+	if (big->bodyCount < small->bodyCount)
+	{
+		big = islandB;
+		small = islandA;
+	}
+
+	for (b2Body* b = small->bodyList; b; b = b->m_islandNext)
+	{
+		b->m_island = big;
+	}
+
+	// Splice the body lists.
+	small->bodyList->m_islandPrev = big->bodyTail;
+	big->bodyTail->m_islandNext = small->bodyList;
+	big->bodyTail = small->bodyTail;
+	big->bodyCount += small->bodyCount;
+	big->constraintRemoveCount += small->constraintRemoveCount;
+
+	// An awake island keeps the merged island awake.
+	if (small->awake)
+	{
+		WakeIsland(big);
+	}
+
+	small->bodyList = NULL;
+	small->bodyTail = NULL;
+	small->bodyCount = 0;
+	DestroyIsland(small);
+}
+
+void b2IslandManager::UnlinkBodies(b2Body* bodyA, b2Body* bodyB)
+{
+	b2PersistentIsland* island = bodyA->m_island;
+	if (island != NULL && island == bodyB->m_island)
+	{
+		++island->constraintRemoveCount;
+	}
+}
+
+void b2IslandManager::WakeIsland(b2PersistentIsland* island)
+{
+	if (island->awake)
+	{
+		return;
+	}
+
+	b2RemoveIsland(&m_sleepingList, island);
+	island->awake = true;
+	b2InsertIsland(&m_awakeList, island);
+}
+
+void b2IslandManager::SleepIsland(b2PersistentIsland* island)
+{
+	if (island->awake == false)
+	{
+		return;
+	}
+
+	b2RemoveIsland(&m_awakeList, island);
+	island->awake = false;
+	b2InsertIsland(&m_sleepingList, island);
+}
+
+void b2IslandManager::SplitIsland(b2PersistentIsland* island, b2StackAllocator* stackAllocator)
+{
+	int32 bodyCount = island->bodyCount;
+	b2Body** bodies = (b2Body**)stackAllocator->Allocate(bodyCount * sizeof(b2Body*));
+	b2Body** stack = (b2Body**)stackAllocator->Allocate(bodyCount * sizeof(b2Body*));
+
+	int32 count = 0;
+	for (b2Body* b = island->bodyList; b; b = b->m_islandNext)
+	{
+		b->m_flags &= ~b2Body::e_islandFlag;
+		bodies[count++] = b;
+	}
+	b2Assert(count == bodyCount);
+
+	// The old island stays allocated until the end so that bodies not yet
+	// visited can be recognized by their island pointer.
+	bool awake = island->awake;
+
+	for (int32 i = 0; i < bodyCount; ++i)
+	{
+		b2Body* seed = bodies[i];
+		if (seed->m_flags & b2Body::e_islandFlag)
+		{
+			continue;
+		}
+
+		b2PersistentIsland* newIsland = CreateIsland(awake);
+
+		int32 stackCount = 0;
+		stack[stackCount++] = seed;
+		seed->m_flags |= b2Body::e_islandFlag;
+
+		// Perform a depth first search (DFS) on the constraint graph.
+		while (stackCount > 0)
+		{
+			b2Body* b = stack[--stackCount];
+			AppendBody(newIsland, b);
+
+			for (b2ContactEdge* ce = b->m_contactList; ce; ce = ce->next)
+			{
+				b2Contact* contact = ce->contact;
+				b2Body* other = ce->other;
+
+				// Only bodies of the island being split are visited.
+				if (other->m_island != island || (other->m_flags & b2Body::e_islandFlag))
+				{
+					continue;
+				}
+
+				// Is this contact solid and touching? Disabled contacts still link
+				// since they are only disabled for one step.
+				if (contact->IsTouching() == false ||
+					contact->GetFixtureA()->IsSensor() || contact->GetFixtureB()->IsSensor())
+				{
+					continue;
+				}
+
+				b2Assert(stackCount < bodyCount);
+				stack[stackCount++] = other;
+				other->m_flags |= b2Body::e_islandFlag;
+			}
+
+			for (b2JointEdge* je = b->m_jointList; je; je = je->next)
+			{
+				b2Body* other = je->other;
+				if (other->m_island != island || (other->m_flags & b2Body::e_islandFlag))
+				{
+					continue;
+				}
+
+				b2Assert(stackCount < bodyCount);
+				stack[stackCount++] = other;
+				other->m_flags |= b2Body::e_islandFlag;
+			}
+		}
+	}
+
+	for (int32 i = 0; i < bodyCount; ++i)
+	{
+		bodies[i]->m_flags &= ~b2Body::e_islandFlag;
+	}
+
+	stackAllocator->Free(stack);
+	stackAllocator->Free(bodies);
+
+	island->bodyList = NULL;
+	island->bodyTail = NULL;
+	island->bodyCount = 0;
+	DestroyIsland(island);
+}
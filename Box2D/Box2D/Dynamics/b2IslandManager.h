@@ -0,0 +1,89 @@
+/*
+* Copyright (c) 2006-2009 Erin Catto http://www.box2d.org
+*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#ifndef B2_ISLAND_MANAGER_H
+#define B2_ISLAND_MANAGER_H
+
+#include <Box2D/Common/b2Settings.h>
+
+class b2Body;
+class b2BlockAllocator;
+class b2StackAllocator;
+
+/// A set of non-static bodies connected by touching contacts and joints. Unlike
+/// b2Island this persists across time steps. Islands are merged as soon as a
+/// constraint connects them, but are only split when they are about to fall
+/// asleep, so an island may be larger than the connected set it stands for.
+/// This is an internal structure.
+struct b2PersistentIsland
+{
+	// Island list pointers, awake or sleeping.
+	b2PersistentIsland* prev;
+	b2PersistentIsland* next;
+
+	// Bodies linked through b2Body::m_islandNext.
+	b2Body* bodyList;
+	b2Body* bodyTail;
+	int32 bodyCount;
+
+	// Number of constraints removed since the island was built. A positive
+	// count means the island may be split.
+	int32 constraintRemoveCount;
+
+	bool awake;
+};
+
+// Delegate of b2World.
+class b2IslandManager
+{
+public:
+	b2IslandManager();
+
+	// Give a non-static, active body its own island.
+	void AddBody(b2Body* body);
+
+	// Take a body out of its island, e.g. when it is destroyed or made static.
+	void RemoveBody(b2Body* body);
+
+	// A constraint now connects these bodies. Merges their islands with a
+	// weighted union: the smaller island is relabelled into the larger one.
+	void LinkBodies(b2Body* bodyA, b2Body* bodyB);
+
+	// A constraint between these bodies went away.
+	void UnlinkBodies(b2Body* bodyA, b2Body* bodyB);
+
+	// Move an island to the awake list.
+	void WakeIsland(b2PersistentIsland* island);
+
+	// Move an island to the sleeping list.
+	void SleepIsland(b2PersistentIsland* island);
+
+	// Rebuild an island from its constraint graph. This may produce several islands.
+	void SplitIsland(b2PersistentIsland* island, b2StackAllocator* stackAllocator);
+
+	b2PersistentIsland* CreateIsland(bool awake);
+	void DestroyIsland(b2PersistentIsland* island);
+	void AppendBody(b2PersistentIsland* island, b2Body* body);
+
+	b2PersistentIsland* m_awakeList;
+	b2PersistentIsland* m_sleepingList;
+	int32 m_islandCount;
+	b2BlockAllocator* m_allocator;
+};
+
+#endif
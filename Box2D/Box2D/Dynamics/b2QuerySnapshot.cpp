@@ -0,0 +1,123 @@
+/*
+* Copyright (c) 2006-2009 Erin Catto http://www.box2d.org
+*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+#include <Box2D/Dynamics/b2QuerySnapshot.h>
+#include <Box2D/Collision/b2BroadPhase.h>
+
+b2QuerySnapshot::b2QuerySnapshot()
+{
+	m_nodes = NULL;
+	m_nodeCount = 0;
+	m_nodeCapacity = 0;
+
+	m_proxies = NULL;
+	m_proxyCount = 0;
+	m_proxyCapacity = 0;
+
+	m_stepCount = 0;
+	m_readers = 0;
+}
+
+b2QuerySnapshot::~b2QuerySnapshot()
+{
+	b2Free(m_nodes);
+	b2Free(m_proxies);
+}
+
+void b2QuerySnapshot::Build(const b2BroadPhase* broadPhase, int32 stepCount)
+{
+	const b2DynamicTree* tree = &broadPhase->m_tree;
+
+	m_stepCount = stepCount;
+	m_nodeCount = 0;
+	m_proxyCount = 0;
+
+	if (tree->m_nodeCount > m_nodeCapacity)
+	{
+		b2Free(m_nodes);
+		m_nodeCapacity = tree->m_nodeCount;
+		m_nodes = (b2SnapshotNode*)b2Alloc(m_nodeCapacity * sizeof(b2SnapshotNode));
+	}
+
+	if (broadPhase->m_proxyCount > m_proxyCapacity)
+	{
+		b2Free(m_proxies);
+		m_proxyCapacity = broadPhase->m_proxyCount;
+		m_proxies = (b2SnapshotProxy*)b2Alloc(m_proxyCapacity * sizeof(b2SnapshotProxy));
+	}
+
+	if (tree->m_root == b2_nullNode)
+	{
+		return;
+	}
+
+	// The stack holds a tree node and the snapshot node whose second child
+	// it is. The first child always follows its parent.
+	b2GrowableStack<int32, 256> stack;
+	stack.Push(b2_nullNode);
+	stack.Push(tree->m_root);
+
+	while (stack.GetCount() > 0)
+	{
+		const b2TreeNode* treeNode = tree->m_nodes + stack.Pop();
+		int32 parent = stack.Pop();
+
+		int32 index = m_nodeCount;
+		++m_nodeCount;
+
+		if (parent != b2_nullNode)
+		{
+			m_nodes[parent].child2 = index;
+		}
+
+		b2SnapshotNode* node = m_nodes + index;
+		node->filter = treeNode->filter;
+
+		if (treeNode->IsLeaf() == false)
+		{
+			node->aabb = treeNode->aabb;
+			node->child1 = index + 1;
+
+			stack.Push(index);
+			stack.Push(treeNode->child2);
+			stack.Push(b2_nullNode);
+			stack.Push(treeNode->child1);
+			continue;
+		}
+
+		const b2FixtureProxy* fixtureProxy = (b2FixtureProxy*)treeNode->userData;
+		b2Fixture* fixture = fixtureProxy->fixture;
+		b2Body* body = fixture->GetBody();
+
+		// The proxy AABB covers the swept shape of the last step.
+		b2SnapshotProxy* proxy = m_proxies + m_proxyCount;
+		proxy->transform = body->GetTransform();
+		fixture->ComputeProxyAABB(&proxy->aabb, proxy->transform, fixtureProxy->childIndex);
+		proxy->shape = fixture->GetShape();
+		proxy->childIndex = fixtureProxy->childIndex;
+		proxy->filter = treeNode->filter;
+		proxy->fixture = fixture;
+		proxy->body = body;
+		proxy->fixtureUserData = fixture->GetUserData();
+		proxy->bodyUserData = body->GetUserData();
+
+		node->aabb = proxy->aabb;
+		node->child1 = b2_nullNode;
+		node->proxy = m_proxyCount;
+		++m_proxyCount;
+	}
+}
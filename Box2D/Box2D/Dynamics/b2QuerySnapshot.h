@@ -0,0 +1,403 @@
+/*
+* Copyright (c) 2006-2009 Erin Catto http://www.box2d.org
+*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+#ifndef B2_QUERY_SNAPSHOT_H
+#define B2_QUERY_SNAPSHOT_H
+
+#include <Box2D/Collision/b2DynamicTree.h>
+#include <Box2D/Dynamics/b2Fixture.h>
+
+class b2BroadPhase;
+
+/// A broad-phase proxy as it was at the end of a step.
+struct b2SnapshotProxy
+{
+	/// The tight AABB of the fixture child at the snapshot transform. For a shape
+	/// with a child query this bounds all of its children.
+	b2AABB aabb;
+
+	/// The body transform.
+	b2Transform transform;
+
+	/// The shape. The world keeps the shapes of destroyed fixtures until
+	/// no snapshot uses them.
+	const b2Shape* shape;
+
+	/// The child index of the shape. The ray casts of a shape with a child query
+	/// set this to the child that was hit.
+	int32 childIndex;
+
+	/// The filter of the fixture.
+	b2Filter filter;
+
+	/// The fixture and its body. The world may change or destroy them while
+	/// the snapshot is used, so only use these pointers to identify them.
+	b2Fixture* fixture;
+	b2Body* body;
+
+	/// Copies of the fixture and body user data.
+	void* fixtureUserData;
+	void* bodyUserData;
+};
+
+/// A node of the snapshot tree. Leaves have no first child and hold the index
+/// of their proxy.
+struct b2SnapshotNode
+{
+	bool IsLeaf() const
+	{
+		return child1 == b2_nullNode;
+	}
+
+	b2AABB aabb;
+	int32 child1;
+
+	union
+	{
+		int32 child2;
+		int32 proxy;
+	};
+
+	b2Filter filter;
+};
+
+/// An immutable copy of the broad-phase tree and the fixture transforms,
+/// taken at the end of a step. Any number of threads may query a snapshot
+/// while the world runs the next step. Get one from
+/// b2World::AcquireQuerySnapshot and give it back with
+/// b2World::ReleaseQuerySnapshot. The queries report proxies, the
+/// fixtures themselves must not be touched from other threads.
+class b2QuerySnapshot
+{
+public:
+
+	/// Get the number of the step this snapshot was taken after, counted from
+	/// the first snapshot of the world.
+	int32 GetStepCount() const;
+
+	/// Get the number of proxies.
+	int32 GetProxyCount() const;
+
+	/// Get the proxies, in tree order.
+	const b2SnapshotProxy* GetProxies() const;
+
+	/// Query the proxies that overlap the AABB. The functor is called as
+	/// bool(const b2SnapshotProxy& proxy), return false to stop the query.
+	template <typename T>
+	void QueryAABB(const b2AABB& aabb, T callback) const;
+
+	/// Query the proxies that overlap the AABB and pass b2ShouldCollide with
+	/// the given filter.
+	template <typename T>
+	void QueryAABB(const b2AABB& aabb, const b2Filter& filter, T callback) const;
+
+	/// Query the proxies whose shape contains the point. The functor is called
+	/// as for QueryAABB.
+	template <typename T>
+	void QueryPoint(const b2Vec2& point, T callback) const;
+
+	/// Ray-cast the shapes. The functor is called as float32(const b2SnapshotProxy& proxy,
+	/// const b2Vec2& point, const b2Vec2& normal, float32 fraction) and controls the ray
+	/// like b2RayCastCallback::ReportFixture.
+	template <typename T>
+	void RayCast(const b2Vec2& point1, const b2Vec2& point2, T callback) const;
+
+	/// Ray-cast the shapes that pass b2ShouldCollide with the given filter.
+	template <typename T>
+	void RayCast(const b2Vec2& point1, const b2Vec2& point2, const b2Filter& filter, T callback) const;
+
+protected:
+
+	friend class b2World;
+
+	b2QuerySnapshot();
+	~b2QuerySnapshot();
+
+	// Copy the tree of the broad-phase in depth first order.
+	void Build(const b2BroadPhase* broadPhase, int32 stepCount);
+
+	template <typename T>
+	void Query(const b2AABB& aabb, const b2Filter* filter, T* callback) const;
+
+	template <typename T>
+	void RayCast(const b2Vec2& point1, const b2Vec2& point2, const b2Filter* filter, T* callback) const;
+
+	b2SnapshotNode* m_nodes;
+	int32 m_nodeCount;
+	int32 m_nodeCapacity;
+
+	b2SnapshotProxy* m_proxies;
+	int32 m_proxyCount;
+	int32 m_proxyCapacity;
+
+	int32 m_stepCount;
+
+	// The number of threads using this snapshot, see b2World::AcquireQuerySnapshot.
+	mutable volatile int32 m_readers;
+};
+
+inline int32 b2QuerySnapshot::GetStepCount() const
+{
+	return m_stepCount;
+}
+
+inline int32 b2QuerySnapshot::GetProxyCount() const
+{
+	return m_proxyCount;
+}
+
+inline const b2SnapshotProxy* b2QuerySnapshot::GetProxies() const
+{
+	return m_proxies;
+}
+
+template <typename T>
+inline void b2QuerySnapshot::QueryAABB(const b2AABB& aabb, T callback) const
+{
+	Query(aabb, (const b2Filter*)NULL, &callback);
+}
+
+template <typename T>
+inline void b2QuerySnapshot::QueryAABB(const b2AABB& aabb, const b2Filter& filter, T callback) const
+{
+	Query(aabb, &filter, &callback);
+}
+
+/// Reports the proxies whose shape contains a point.
+template <typename T>
+struct b2SnapshotPointFunctor
+{
+	bool operator()(const b2SnapshotProxy& proxy)
+	{
+		if (proxy.shape->TestPoint(proxy.transform, point))
+		{
+			return (*callback)(proxy);
+		}
+
+		return true;
+	}
+
+	b2Vec2 point;
+	T* callback;
+};
+
+template <typename T>
+inline void b2QuerySnapshot::QueryPoint(const b2Vec2& point, T callback) const
+{
+	b2SnapshotPointFunctor<T> functor;
+	functor.point = point;
+	functor.callback = &callback;
+
+	b2AABB aabb;
+	aabb.lowerBound = point;
+	aabb.upperBound = point;
+	Query(aabb, (const b2Filter*)NULL, &functor);
+}
+
+template <typename T>
+inline void b2QuerySnapshot::RayCast(const b2Vec2& point1, const b2Vec2& point2, T callback) const
+{
+	RayCast(point1, point2, (const b2Filter*)NULL, &callback);
+}
+
+template <typename T>
+inline void b2QuerySnapshot::RayCast(const b2Vec2& point1, const b2Vec2& point2, const b2Filter& filter, T callback) const
+{
+	RayCast(point1, point2, &filter, &callback);
+}
+
+template <typename T>
+inline void b2QuerySnapshot::Query(const b2AABB& aabb, const b2Filter* filter, T* callback) const
+{
+	if (m_nodeCount == 0)
+	{
+		return;
+	}
+
+	b2GrowableStack<int32, 256> stack;
+	stack.Push(0);
+
+	while (stack.GetCount() > 0)
+	{
+		const b2SnapshotNode* node = m_nodes + stack.Pop();
+
+		if (b2TestOverlap(node->aabb, aabb) == false || b2TestFilter(node, filter) == false)
+		{
+			continue;
+		}
+
+		if (node->IsLeaf())
+		{
+			bool proceed = (*callback)(m_proxies[node->proxy]);
+			if (proceed == false)
+			{
+				return;
+			}
+		}
+		else
+		{
+			stack.Push(node->child1);
+			stack.Push(node->child2);
+		}
+	}
+}
+
+/// Ray-casts the children that a shape with a child query finds. The proxy
+/// passed to the functor has the child index of the hit.
+template <typename T>
+struct b2SnapshotChildRayCastFunctor : public b2ChildRayCastCallback
+{
+	float32 ReportChild(const b2RayCastInput& input, int32 childIndex)
+	{
+		b2RayCastOutput output;
+		if (proxy.shape->RayCast(&output, input, identity, childIndex) == false)
+		{
+			return input.maxFraction;
+		}
+
+		float32 fraction = output.fraction;
+		b2Vec2 point = (1.0f - fraction) * p1 + fraction * p2;
+		b2Vec2 normal = b2Mul(proxy.transform.q, output.normal);
+		proxy.childIndex = childIndex;
+		float32 value = (*callback)(proxy, point, normal, fraction);
+		if (value < 0.0f)
+		{
+			// The client has filtered this proxy.
+			return input.maxFraction;
+		}
+
+		maxFraction = value;
+		return value;
+	}
+
+	b2SnapshotProxy proxy;
+	b2Transform identity;
+	b2Vec2 p1, p2;
+	float32 maxFraction;
+	T* callback;
+};
+
+template <typename T>
+inline void b2QuerySnapshot::RayCast(const b2Vec2& point1, const b2Vec2& point2, const b2Filter* filter, T* callback) const
+{
+	if (m_nodeCount == 0)
+	{
+		return;
+	}
+
+	b2RayCastInput input;
+	input.p1 = point1;
+	input.p2 = point2;
+	input.maxFraction = 1.0f;
+
+	b2Vec2 p1 = point1;
+	b2Vec2 p2 = point2;
+	b2Vec2 r = p2 - p1;
+	b2Assert(r.LengthSquared() > 0.0f);
+	r.Normalize();
+
+	// v is perpendicular to the segment.
+	b2Vec2 v = b2Cross(1.0f, r);
+	b2Vec2 abs_v = b2Abs(v);
+
+	// Build a bounding box for the segment.
+	b2AABB segmentAABB;
+	segmentAABB.lowerBound = b2Min(p1, p2);
+	segmentAABB.upperBound = b2Max(p1, p2);
+
+	b2GrowableStack<int32, 256> stack;
+	stack.Push(0);
+
+	while (stack.GetCount() > 0)
+	{
+		const b2SnapshotNode* node = m_nodes + stack.Pop();
+
+		if (b2TestOverlap(node->aabb, segmentAABB) == false || b2TestFilter(node, filter) == false)
+		{
+			continue;
+		}
+
+		// Separating axis for segment (Gino, p80).
+		// |dot(v, p1 - c)| > dot(|v|, h)
+		b2Vec2 c = node->aabb.GetCenter();
+		b2Vec2 h = node->aabb.GetExtents();
+		float32 separation = b2Abs(b2Dot(v, p1 - c)) - b2Dot(abs_v, h);
+		if (separation > 0.0f)
+		{
+			continue;
+		}
+
+		if (node->IsLeaf() == false)
+		{
+			stack.Push(node->child1);
+			stack.Push(node->child2);
+			continue;
+		}
+
+		const b2SnapshotProxy& proxy = m_proxies[node->proxy];
+		float32 value;
+
+		// A shape with a child query finds the children in its frame. Every child
+		// that is hit is reported.
+		if (proxy.shape->HasChildQuery())
+		{
+			b2RayCastInput localInput;
+			localInput.p1 = b2MulT(proxy.transform, p1);
+			localInput.p2 = b2MulT(proxy.transform, p2);
+			localInput.maxFraction = input.maxFraction;
+
+			b2SnapshotChildRayCastFunctor<T> children;
+			children.proxy = proxy;
+			children.identity.SetIdentity();
+			children.p1 = p1;
+			children.p2 = p2;
+			children.maxFraction = input.maxFraction;
+			children.callback = callback;
+			proxy.shape->RayCastChildren(&children, localInput);
+			value = children.maxFraction;
+		}
+		else
+		{
+			b2RayCastOutput output;
+			if (proxy.shape->RayCast(&output, input, proxy.transform, proxy.childIndex) == false)
+			{
+				continue;
+			}
+
+			float32 fraction = output.fraction;
+			b2Vec2 point = (1.0f - fraction) * p1 + fraction * p2;
+			value = (*callback)(proxy, point, output.normal, fraction);
+		}
+
+		if (value == 0.0f)
+		{
+			// The client has terminated the ray cast.
+			return;
+		}
+
+		if (value > 0.0f)
+		{
+			// Update segment bounding box.
+			input.maxFraction = value;
+			b2Vec2 t = p1 + value * (p2 - p1);
+			segmentAABB.lowerBound = b2Min(p1, t);
+			segmentAABB.upperBound = b2Max(p1, t);
+		}
+	}
+}
+
+#endif
@@ -0,0 +1,339 @@
+/*
+* Copyright (c) 2006-2009 Erin Catto http://www.box2d.org
+*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include <Box2D/Dynamics/b2ShardedWorld.h>
+#include <Box2D/Dynamics/b2BodyPrefab.h>
+#include <Box2D/Dynamics/b2World.h>
+#include <new>
+
+struct b2ShardedBody
+{
+	const b2BodyPrefab* prefab;
+
+	// The copies in the shards [lower, upper]. The copy in the owner shard is
+	// simulated, the others are ghosts. Static bodies have no owner.
+	b2Body** copies;
+	int32 lower;
+	int32 upper;
+
+	// The owner shard, or the next free record.
+	int32 owner;
+};
+
+class b2ShardStepTask : public b2Task
+{
+public:
+	void Execute(int32 begin, int32 end, int32 workerIndex)
+	{
+		B2_NOT_USED(workerIndex);
+		for (int32 i = begin; i < end; ++i)
+		{
+			m_shards[i]->Step(m_timeStep, m_velocityIterations, m_positionIterations);
+		}
+	}
+
+	b2World** m_shards;
+	float32 m_timeStep;
+	int32 m_velocityIterations;
+	int32 m_positionIterations;
+};
+
+b2ShardedWorld::b2ShardedWorld(const b2ShardedWorldDef* def)
+{
+	b2Assert(def->shardCount >= 1);
+	b2Assert(def->lowerX < def->upperX);
+
+	m_shardCount = def->shardCount;
+	m_shards = (b2World**)b2Alloc(m_shardCount * sizeof(b2World*));
+	for (int32 i = 0; i < m_shardCount; ++i)
+	{
+		void* mem = b2Alloc(sizeof(b2World));
+		m_shards[i] = new (mem) b2World(def->gravity);
+	}
+
+	m_taskExecutor = NULL;
+
+	m_lowerX = def->lowerX;
+	m_invStripWidth = float32(m_shardCount) / (def->upperX - def->lowerX);
+	m_ghostMargin = def->ghostMargin;
+
+	m_bodies = NULL;
+	m_bodyCapacity = 0;
+	m_bodyCount = 0;
+	m_freeBody = -1;
+	m_ghostCount = 0;
+}
+
+b2ShardedWorld::~b2ShardedWorld()
+{
+	// The shards destroy the bodies.
+	for (int32 i = 0; i < m_shardCount; ++i)
+	{
+		m_shards[i]->~b2World();
+		b2Free(m_shards[i]);
+	}
+	b2Free(m_shards);
+	b2Free(m_bodies);
+}
+
+void b2ShardedWorld::SetTaskExecutor(b2TaskExecutor* executor)
+{
+	m_taskExecutor = executor;
+}
+
+int32 b2ShardedWorld::GetShardIndex(float32 x) const
+{
+	float32 index = (x - m_lowerX) * m_invStripWidth;
+	if (index < 1.0f)
+	{
+		return 0;
+	}
+
+	if (index >= float32(m_shardCount - 1))
+	{
+		return m_shardCount - 1;
+	}
+
+	return int32(index);
+}
+
+b2Body* b2ShardedWorld::CreateCopy(const b2BodyPrefab* prefab, int32 shard, const b2Transform& transform)
+{
+	b2Body* body;
+	m_shards[shard]->CreateBodies(prefab, &transform, 1, &body);
+	return body;
+}
+
+// Move the copies to the shards [lower, upper], creating and destroying
+// ghosts as needed.
+void b2ShardedWorld::SetCopies(b2ShardedBody* body, int32 lower, int32 upper, const b2Transform& transform)
+{
+	if (lower == body->lower && upper == body->upper)
+	{
+		return;
+	}
+
+	b2Body** copies = (b2Body**)m_allocator.Allocate((upper - lower + 1) * sizeof(b2Body*));
+	for (int32 i = lower; i <= upper; ++i)
+	{
+		if (body->copies != NULL && body->lower <= i && i <= body->upper)
+		{
+			copies[i - lower] = body->copies[i - body->lower];
+		}
+		else
+		{
+			copies[i - lower] = CreateCopy(body->prefab, i, transform);
+		}
+	}
+
+	if (body->copies != NULL)
+	{
+		for (int32 i = body->lower; i <= body->upper; ++i)
+		{
+			if (i < lower || upper < i)
+			{
+				m_shards[i]->DestroyBody(body->copies[i - body->lower]);
+			}
+		}
+
+		m_allocator.Free(body->copies, (body->upper - body->lower + 1) * sizeof(b2Body*));
+		m_ghostCount -= body->upper - body->lower;
+	}
+
+	m_ghostCount += upper - lower;
+
+	body->copies = copies;
+	body->lower = lower;
+	body->upper = upper;
+}
+
+// Hand the body to the strip of its center and make the ghosts copies of it.
+void b2ShardedWorld::Synchronize(b2ShardedBody* body)
+{
+	b2Body* owner = body->copies[body->owner - body->lower];
+
+	// A ghost was woken in its shard, so something may push the body there.
+	if (owner->IsAwake() == false)
+	{
+		bool awake = false;
+		for (int32 i = body->lower; i <= body->upper; ++i)
+		{
+			awake = awake || body->copies[i - body->lower]->IsAwake();
+		}
+
+		if (awake == false)
+		{
+			return;
+		}
+
+		owner->SetAwake(true);
+	}
+
+	const b2Transform& xf = owner->GetTransform();
+	b2Vec2 v = owner->GetLinearVelocity();
+	float32 w = owner->GetAngularVelocity();
+
+	b2AABB aabb;
+	body->prefab->ComputeAABB(&aabb, xf);
+	int32 shard = GetShardIndex(owner->GetWorldCenter().x);
+	int32 lower = b2Min(GetShardIndex(aabb.lowerBound.x - m_ghostMargin), shard);
+	int32 upper = b2Max(GetShardIndex(aabb.upperBound.x + m_ghostMargin), shard);
+
+	// The owner stays in range, its state is copied before SetCopies can
+	// destroy it.
+	SetCopies(body, b2Min(lower, body->owner), b2Max(upper, body->owner), xf);
+
+	for (int32 i = body->lower; i <= body->upper; ++i)
+	{
+		if (i == body->owner)
+		{
+			continue;
+		}
+
+		b2Body* ghost = body->copies[i - body->lower];
+		ghost->SetTransform(xf.p, owner->GetAngle());
+		ghost->SetLinearVelocity(v);
+		ghost->SetAngularVelocity(w);
+		ghost->SetAwake(true);
+	}
+
+	body->owner = shard;
+	SetCopies(body, lower, upper, xf);
+}
+
+int32 b2ShardedWorld::CreateBody(const b2BodyPrefab* prefab, const b2Transform& transform)
+{
+	if (m_freeBody == -1)
+	{
+		b2ShardedBody* oldBodies = m_bodies;
+		int32 oldCapacity = m_bodyCapacity;
+		m_bodyCapacity = b2Max(2 * m_bodyCapacity, 64);
+		m_bodies = (b2ShardedBody*)b2Alloc(m_bodyCapacity * sizeof(b2ShardedBody));
+		if (oldBodies)
+		{
+			memcpy(m_bodies, oldBodies, oldCapacity * sizeof(b2ShardedBody));
+			b2Free(oldBodies);
+		}
+
+		// Link the new records into the free list in id order.
+		for (int32 i = m_bodyCapacity - 1; i >= oldCapacity; --i)
+		{
+			m_bodies[i].prefab = NULL;
+			m_bodies[i].owner = m_freeBody;
+			m_freeBody = i;
+		}
+	}
+
+	int32 id = m_freeBody;
+	b2ShardedBody* body = m_bodies + id;
+	m_freeBody = body->owner;
+	++m_bodyCount;
+
+	body->prefab = prefab;
+	body->copies = NULL;
+	body->lower = 0;
+	body->upper = -1;
+
+	b2AABB aabb;
+	prefab->ComputeAABB(&aabb, transform);
+	int32 lower = GetShardIndex(aabb.lowerBound.x - m_ghostMargin);
+	int32 upper = GetShardIndex(aabb.upperBound.x + m_ghostMargin);
+
+	if (prefab->GetBodyDef().type == b2_staticBody)
+	{
+		body->owner = lower;
+		SetCopies(body, lower, upper, transform);
+
+		// Static copies aren't ghosts.
+		m_ghostCount -= upper - lower;
+		return id;
+	}
+
+	b2MassData massData;
+	prefab->GetMassData(&massData);
+	b2Vec2 center = b2Mul(transform, massData.center);
+	body->owner = GetShardIndex(center.x);
+	SetCopies(body, b2Min(lower, body->owner), b2Max(upper, body->owner), transform);
+	return id;
+}
+
+void b2ShardedWorld::DestroyBody(int32 id)
+{
+	b2Assert(0 <= id && id < m_bodyCapacity && m_bodies[id].prefab != NULL);
+	b2ShardedBody* body = m_bodies + id;
+
+	for (int32 i = body->lower; i <= body->upper; ++i)
+	{
+		m_shards[i]->DestroyBody(body->copies[i - body->lower]);
+	}
+	m_allocator.Free(body->copies, (body->upper - body->lower + 1) * sizeof(b2Body*));
+
+	if (body->prefab->GetBodyDef().type != b2_staticBody)
+	{
+		m_ghostCount -= body->upper - body->lower;
+	}
+
+	body->prefab = NULL;
+	body->owner = m_freeBody;
+	m_freeBody = id;
+	--m_bodyCount;
+}
+
+b2Body* b2ShardedWorld::GetBody(int32 id)
+{
+	b2Assert(0 <= id && id < m_bodyCapacity && m_bodies[id].prefab != NULL);
+	b2ShardedBody* body = m_bodies + id;
+	return body->copies[body->owner - body->lower];
+}
+
+int32 b2ShardedWorld::GetBodyShard(int32 id) const
+{
+	b2Assert(0 <= id && id < m_bodyCapacity && m_bodies[id].prefab != NULL);
+	return m_bodies[id].owner;
+}
+
+void b2ShardedWorld::Step(float32 timeStep, int32 velocityIterations, int32 positionIterations)
+{
+	// Migrate and mirror the bodies before the step, this also picks up the
+	// changes made to the bodies since the last step.
+	for (int32 i = 0; i < m_bodyCapacity; ++i)
+	{
+		b2ShardedBody* body = m_bodies + i;
+		if (body->prefab == NULL || body->prefab->GetBodyDef().type == b2_staticBody)
+		{
+			continue;
+		}
+
+		Synchronize(body);
+	}
+
+	b2ShardStepTask task;
+	task.m_shards = m_shards;
+	task.m_timeStep = timeStep;
+	task.m_velocityIterations = velocityIterations;
+	task.m_positionIterations = positionIterations;
+
+	if (m_taskExecutor)
+	{
+		m_taskExecutor->ParallelFor(&task, m_shardCount);
+	}
+	else
+	{
+		task.Execute(0, m_shardCount, 0);
+	}
+}
@@ -0,0 +1,166 @@
+/*
+* Copyright (c) 2006-2009 Erin Catto http://www.box2d.org
+*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#ifndef B2_SHARDED_WORLD_H
+#define B2_SHARDED_WORLD_H
+
+#include <Box2D/Common/b2BlockAllocator.h>
+#include <Box2D/Common/b2Math.h>
+
+class b2Body;
+class b2BodyPrefab;
+class b2TaskExecutor;
+class b2World;
+struct b2ShardedBody;
+
+/// A sharded world definition is used to construct a b2ShardedWorld.
+struct b2ShardedWorldDef
+{
+	/// This constructor sets the definition default values.
+	b2ShardedWorldDef()
+	{
+		gravity.Set(0.0f, -10.0f);
+		shardCount = 1;
+		lowerX = -100.0f;
+		upperX = 100.0f;
+		ghostMargin = 1.0f;
+	}
+
+	/// The gravity of all shards.
+	b2Vec2 gravity;
+
+	/// The number of shards. Each shard is a strip along the x-axis.
+	int32 shardCount;
+
+	/// The strips split [lowerX, upperX] evenly. The first and the last strip
+	/// extend to infinity.
+	float32 lowerX;
+	float32 upperX;
+
+	/// A body gets a ghost in every strip that is closer than this to its AABB.
+	float32 ghostMargin;
+};
+
+/// A sharded world splits space into strips, each simulated by its own b2World
+/// with its own broad-phase and island solver, so that the strips can be
+/// stepped on different threads.
+///
+/// Every body is owned by the strip that contains its center of mass. A body
+/// that is close to another strip is mirrored there as a ghost, so the bodies
+/// of both strips collide with it. The ghost is simulated like any body, but
+/// before each step the world makes the ghosts copies of their owner again
+/// and wakes owners whose ghosts were woken. A body migrates by handing
+/// ownership to its ghost in the strip it moved into. This all happens between
+/// the steps in the order of the body ids, so the result doesn't depend on
+/// the number of threads.
+///
+/// Joints aren't mirrored, so the sharded world has no joints. Contact events
+/// are reported by the shard, also for the ghosts.
+class b2ShardedWorld
+{
+public:
+	/// Construct the shards.
+	b2ShardedWorld(const b2ShardedWorldDef* def);
+
+	/// Destroy the shards and all bodies.
+	~b2ShardedWorld();
+
+	/// Register a task executor to step the shards in parallel. The executor
+	/// is owned by you and must remain in scope.
+	void SetTaskExecutor(b2TaskExecutor* executor);
+
+	/// Create a body from a prefab. A static body is copied into every strip it
+	/// overlaps. The prefab is owned by you and must remain in scope while the
+	/// body exists.
+	/// @return the id of the body.
+	int32 CreateBody(const b2BodyPrefab* prefab, const b2Transform& transform);
+
+	/// Destroy a body and its ghosts.
+	void DestroyBody(int32 id);
+
+	/// Get the simulated copy of a body, in the shard that owns it. This changes
+	/// when the body migrates, so don't keep the pointer across steps. Change the
+	/// body only between steps.
+	b2Body* GetBody(int32 id);
+
+	/// Get the index of the shard that owns a body.
+	int32 GetBodyShard(int32 id) const;
+
+	/// Take a time step in all shards, see b2World::Step.
+	void Step(float32 timeStep, int32 velocityIterations, int32 positionIterations);
+
+	/// Get the number of shards.
+	int32 GetShardCount() const;
+
+	/// Get a shard, for example to set its listeners.
+	b2World* GetShard(int32 index);
+
+	/// Get the number of bodies, not counting ghosts and static copies.
+	int32 GetBodyCount() const;
+
+	/// Get the number of ghosts.
+	int32 GetGhostCount() const;
+
+private:
+
+	int32 GetShardIndex(float32 x) const;
+
+	b2Body* CreateCopy(const b2BodyPrefab* prefab, int32 shard, const b2Transform& transform);
+	void SetCopies(b2ShardedBody* body, int32 lower, int32 upper, const b2Transform& transform);
+	void Synchronize(b2ShardedBody* body);
+
+	b2BlockAllocator m_allocator;
+
+	b2World** m_shards;
+	int32 m_shardCount;
+	b2TaskExecutor* m_taskExecutor;
+
+	float32 m_lowerX;
+	float32 m_invStripWidth;
+	float32 m_ghostMargin;
+
+	// Indexed by body id. Free records form a list through b2ShardedBody::owner.
+	b2ShardedBody* m_bodies;
+	int32 m_bodyCapacity;
+	int32 m_bodyCount;
+	int32 m_freeBody;
+	int32 m_ghostCount;
+};
+
+inline int32 b2ShardedWorld::GetShardCount() const
+{
+	return m_shardCount;
+}
+
+inline b2World* b2ShardedWorld::GetShard(int32 index)
+{
+	b2Assert(0 <= index && index < m_shardCount);
+	return m_shards[index];
+}
+
+inline int32 b2ShardedWorld::GetBodyCount() const
+{
+	return m_bodyCount;
+}
+
+inline int32 b2ShardedWorld::GetGhostCount() const
+{
+	return m_ghostCount;
+}
+
+#endif
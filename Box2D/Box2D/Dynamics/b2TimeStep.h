@@ -25,13 +25,27 @@
 struct b2Profile
 {
 	float32 step;
+	float32 updatePairs;
 	float32 collide;
 	float32 solve;
+	float32 buildIslands;
 	float32 solveInit;
 	float32 solveVelocity;
 	float32 solvePosition;
 	float32 broadphase;
 	float32 solveTOI;
+	float32 solveParticles;
+	float32 velocityIterations;		///< average per island, this is not a time
+	float32 positionIterations;		///< average per island, this is not a time
+};
+
+/// The ways a step with a time budget degrades when it runs late,
+/// see b2World::Step.
+enum b2StepDegradation
+{
+	b2_reducedIterations	= 0x0001,	///< islands were solved with fewer iterations
+	b2_deferredTOI			= 0x0002,	///< only bullets had continuous collision
+	b2_skippedSensors		= 0x0004	///< sensor contacts were not updated
 };
 
 /// This is an internal structure.
@@ -42,6 +56,9 @@ struct b2TimeStep
 	float32 dtRatio;	// dt * inv_dt0
 	int32 velocityIterations;
 	int32 positionIterations;
+	int32 solverSubSteps;	// soft step sub-steps, 0 for the iterative solver
+	float32 velocityTolerance;	// impulse, 0 to always run velocityIterations
+	int32 minVelocityIterations;
 	bool warmStarting;
 };
 
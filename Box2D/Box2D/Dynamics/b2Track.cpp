@@ -0,0 +1,755 @@
+/*
+* Copyright (c) 2006-2009 Erin Catto http://www.box2d.org
+*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include <Box2D/Dynamics/b2Track.h>
+#include <Box2D/Dynamics/b2World.h>
+#include <string.h>
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#elif defined(__linux__) || defined (__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// The file starts with: "B2TK", version, body count, frame count, keyframe
+// interval, time step, position precision, index offset. All values are
+// 32-bit little endian.
+const uint32 b2_trackVersion = 1;
+const int32 b2_trackHeaderSize = 32;
+
+// Angles are stored in 16 bits per turn.
+const float32 b2_trackAngleScale = 65536.0f / (2.0f * b2_pi);
+
+// The quantized transform of a body and its change in the last frame.
+struct b2TrackState
+{
+	int32 x, y, angle;
+	int32 dx, dy, dangle;
+};
+
+static void b2WriteUint32(uint8* p, uint32 value)
+{
+	p[0] = (uint8)value;
+	p[1] = (uint8)(value >> 8);
+	p[2] = (uint8)(value >> 16);
+	p[3] = (uint8)(value >> 24);
+}
+
+static uint32 b2ReadUint32(const uint8* p)
+{
+	return (uint32)p[0] | ((uint32)p[1] << 8) | ((uint32)p[2] << 16) | ((uint32)p[3] << 24);
+}
+
+static uint32 b2FloatBits(float32 value)
+{
+	uint32 bits;
+	memcpy(&bits, &value, sizeof(bits));
+	return bits;
+}
+
+static float32 b2BitsFloat(uint32 bits)
+{
+	float32 value;
+	memcpy(&value, &bits, sizeof(value));
+	return value;
+}
+
+// Zig-zag encode a residual so that small negative values stay small, then
+// write it in 7-bit groups.
+static int32 b2WriteResidual(uint8* p, uint32 residual)
+{
+	uint32 v = (residual << 1) ^ (0u - (residual >> 31));
+	int32 n = 0;
+	while (v >= 0x80)
+	{
+		p[n++] = (uint8)(v | 0x80);
+		v >>= 7;
+	}
+	p[n++] = (uint8)v;
+	return n;
+}
+
+static bool b2ReadResidual(const uint8* data, int32 size, int32* offset, uint32* residual)
+{
+	uint32 v = 0;
+	for (int32 shift = 0; shift < 35; shift += 7)
+	{
+		if (*offset >= size)
+		{
+			return false;
+		}
+
+		uint8 b = data[(*offset)++];
+		v |= (uint32)(b & 0x7F) << shift;
+		if ((b & 0x80) == 0)
+		{
+			*residual = (v >> 1) ^ (0u - (v & 1));
+			return true;
+		}
+	}
+
+	return false;
+}
+
+// Wrap a difference of 16-bit angles to [-32768, 32767].
+static int32 b2WrapAngle(int32 angle)
+{
+	angle &= 0xFFFF;
+	return angle >= 32768 ? angle - 65536 : angle;
+}
+
+static float32 b2BytesPerSecond(int32 byteCount, int32 frameCount, float32 timeStep)
+{
+	if (frameCount < 2)
+	{
+		return 0.0f;
+	}
+
+	return (float32)byteCount / ((frameCount - 1) * timeStep);
+}
+
+// Set a state to a keyframe.
+static void b2SetKeyframe(b2TrackState* s, int32 x, int32 y, int32 angle)
+{
+	s->x = x;
+	s->y = y;
+	s->angle = angle;
+	s->dx = 0;
+	s->dy = 0;
+	s->dangle = 0;
+}
+
+// Advance a state by the residuals to the linear prediction. The arithmetic
+// wraps around, so decoding gives back exactly what was encoded.
+static void b2ApplyResiduals(b2TrackState* s, uint32 rx, uint32 ry, uint32 rangle)
+{
+	int32 x = (int32)((uint32)s->x + (uint32)s->dx + rx);
+	int32 y = (int32)((uint32)s->y + (uint32)s->dy + ry);
+	int32 angle = (int32)(((uint32)s->angle + (uint32)s->dangle + rangle) & 0xFFFF);
+
+	s->dx = (int32)((uint32)x - (uint32)s->x);
+	s->dy = (int32)((uint32)y - (uint32)s->y);
+	s->dangle = b2WrapAngle(angle - s->angle);
+	s->x = x;
+	s->y = y;
+	s->angle = angle;
+}
+
+b2TrackRecorder::b2TrackRecorder(const b2TrackDef* def)
+{
+	b2Assert(def->positionPrecision > 0.0f);
+	b2Assert(def->keyframeInterval >= 1);
+
+	m_def = *def;
+	m_timeStep = 0.0f;
+	m_file = NULL;
+	m_error = false;
+	m_bodies = NULL;
+	m_states = NULL;
+	m_bodyCount = 0;
+	m_buffer = NULL;
+	m_bufferCapacity = 0;
+	m_keyframeOffsets = NULL;
+	m_keyframeCapacity = 0;
+	m_frameCount = 0;
+	m_byteCount = 0;
+}
+
+b2TrackRecorder::~b2TrackRecorder()
+{
+	if (m_file)
+	{
+		End();
+	}
+
+	b2Free(m_buffer);
+	b2Free(m_keyframeOffsets);
+}
+
+bool b2TrackRecorder::Begin(const char* fileName, b2Body* const* bodies, int32 count, float32 timeStep)
+{
+	b2Assert(m_file == NULL);
+	b2Assert(count > 0 && timeStep > 0.0f);
+
+	m_file = fopen(fileName, "wb");
+	if (m_file == NULL)
+	{
+		return false;
+	}
+
+	m_timeStep = timeStep;
+	m_error = false;
+
+	m_bodyCount = count;
+	m_bodies = (b2Body**)b2Alloc(count * sizeof(b2Body*));
+	memcpy(m_bodies, bodies, count * sizeof(b2Body*));
+	m_states = (b2TrackState*)b2Alloc(count * sizeof(b2TrackState));
+
+	// A keyframe takes 10 bytes per body, another frame at most the mask and
+	// three 5-byte residuals per body.
+	int32 capacity = b2Max(b2_trackHeaderSize, 15 * count + (count + 7) / 8);
+	if (capacity > m_bufferCapacity)
+	{
+		b2Free(m_buffer);
+		m_buffer = (uint8*)b2Alloc(capacity);
+		m_bufferCapacity = capacity;
+	}
+
+	// The header is written by End.
+	memset(m_buffer, 0, b2_trackHeaderSize);
+	m_error = fwrite(m_buffer, 1, b2_trackHeaderSize, m_file) != (size_t)b2_trackHeaderSize;
+
+	m_frameCount = 0;
+	m_byteCount = b2_trackHeaderSize;
+
+	WriteFrame();
+	return true;
+}
+
+void b2TrackRecorder::Record()
+{
+	b2Assert(m_file != NULL);
+	WriteFrame();
+}
+
+void b2TrackRecorder::WriteFrame()
+{
+	float32 positionScale = 1.0f / m_def.positionPrecision;
+	bool keyframe = m_frameCount % m_def.keyframeInterval == 0;
+
+	int32 size = 0;
+	if (keyframe)
+	{
+		int32 keyframeIndex = m_frameCount / m_def.keyframeInterval;
+		if (keyframeIndex == m_keyframeCapacity)
+		{
+			m_keyframeCapacity = b2Max(2 * m_keyframeCapacity, 16);
+			uint32* offsets = (uint32*)b2Alloc(m_keyframeCapacity * sizeof(uint32));
+			if (keyframeIndex > 0)
+			{
+				memcpy(offsets, m_keyframeOffsets, keyframeIndex * sizeof(uint32));
+			}
+			b2Free(m_keyframeOffsets);
+			m_keyframeOffsets = offsets;
+		}
+
+		m_keyframeOffsets[keyframeIndex] = (uint32)m_byteCount;
+	}
+	else
+	{
+		size = (m_bodyCount + 7) / 8;
+		memset(m_buffer, 0, size);
+	}
+
+	for (int32 i = 0; i < m_bodyCount; ++i)
+	{
+		const b2Body* body = m_bodies[i];
+		b2Vec2 p = positionScale * body->GetPosition();
+		p.x = b2Clamp(p.x, -1073741824.0f, 1073741824.0f);
+		p.y = b2Clamp(p.y, -1073741824.0f, 1073741824.0f);
+
+		int32 x = (int32)floorf(p.x + 0.5f);
+		int32 y = (int32)floorf(p.y + 0.5f);
+		int32 angle = (int32)floorf(fmodf(body->GetAngle(), 2.0f * b2_pi) * b2_trackAngleScale + 0.5f) & 0xFFFF;
+
+		b2TrackState* s = m_states + i;
+		if (keyframe)
+		{
+			b2WriteUint32(m_buffer + size, (uint32)x);
+			b2WriteUint32(m_buffer + size + 4, (uint32)y);
+			m_buffer[size + 8] = (uint8)angle;
+			m_buffer[size + 9] = (uint8)(angle >> 8);
+			size += 10;
+
+			b2SetKeyframe(s, x, y, angle);
+			continue;
+		}
+
+		uint32 rx = (uint32)x - (uint32)s->x - (uint32)s->dx;
+		uint32 ry = (uint32)y - (uint32)s->y - (uint32)s->dy;
+		uint32 rangle = (uint32)b2WrapAngle(angle - s->angle - s->dangle);
+
+		if (rx != 0 || ry != 0 || rangle != 0)
+		{
+			m_buffer[i >> 3] |= (uint8)(1 << (i & 7));
+			size += b2WriteResidual(m_buffer + size, rx);
+			size += b2WriteResidual(m_buffer + size, ry);
+			size += b2WriteResidual(m_buffer + size, rangle);
+		}
+
+		b2ApplyResiduals(s, rx, ry, rangle);
+	}
+
+	if (fwrite(m_buffer, 1, size, m_file) != (size_t)size)
+	{
+		m_error = true;
+	}
+
+	m_byteCount += size;
+	++m_frameCount;
+}
+
+bool b2TrackRecorder::End()
+{
+	if (m_file == NULL)
+	{
+		return false;
+	}
+
+	int32 keyframeCount = (m_frameCount + m_def.keyframeInterval - 1) / m_def.keyframeInterval;
+	uint32 indexOffset = (uint32)m_byteCount;
+	for (int32 i = 0; i < keyframeCount; ++i)
+	{
+		uint8 offset[4];
+		b2WriteUint32(offset, m_keyframeOffsets[i]);
+		if (fwrite(offset, 1, 4, m_file) != 4)
+		{
+			m_error = true;
+		}
+	}
+	m_byteCount += 4 * keyframeCount;
+
+	uint8 header[b2_trackHeaderSize];
+	memcpy(header, "B2TK", 4);
+	b2WriteUint32(header + 4, b2_trackVersion);
+	b2WriteUint32(header + 8, (uint32)m_bodyCount);
+	b2WriteUint32(header + 12, (uint32)m_frameCount);
+	b2WriteUint32(header + 16, (uint32)m_def.keyframeInterval);
+	b2WriteUint32(header + 20, b2FloatBits(m_timeStep));
+	b2WriteUint32(header + 24, b2FloatBits(m_def.positionPrecision));
+	b2WriteUint32(header + 28, indexOffset);
+
+	if (fseek(m_file, 0, SEEK_SET) != 0 || fwrite(header, 1, b2_trackHeaderSize, m_file) != (size_t)b2_trackHeaderSize)
+	{
+		m_error = true;
+	}
+
+	bool ok = m_error == false && ferror(m_file) == 0;
+	if (fclose(m_file) != 0)
+	{
+		ok = false;
+	}
+	m_file = NULL;
+
+	b2Free(m_bodies);
+	b2Free(m_states);
+	m_bodies = NULL;
+	m_states = NULL;
+
+	return ok;
+}
+
+float32 b2TrackRecorder::GetBytesPerSecond() const
+{
+	return b2BytesPerSecond(m_byteCount, m_frameCount, m_timeStep);
+}
+
+// Map a file into memory for reading.
+static const uint8* b2MapFile(const char* fileName, int32* size, void** file, void** mapping)
+{
+	*file = NULL;
+	*mapping = NULL;
+
+#if defined(_WIN32)
+	HANDLE fileHandle = CreateFileA(fileName, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+	if (fileHandle == INVALID_HANDLE_VALUE)
+	{
+		return NULL;
+	}
+
+	DWORD high = 0;
+	DWORD low = GetFileSize(fileHandle, &high);
+	if (high != 0 || low == 0 || low > 0x7FFFFFFF)
+	{
+		CloseHandle(fileHandle);
+		return NULL;
+	}
+
+	HANDLE mappingHandle = CreateFileMappingA(fileHandle, NULL, PAGE_READONLY, 0, 0, NULL);
+	if (mappingHandle == NULL)
+	{
+		CloseHandle(fileHandle);
+		return NULL;
+	}
+
+	void* data = MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0);
+	if (data == NULL)
+	{
+		CloseHandle(mappingHandle);
+		CloseHandle(fileHandle);
+		return NULL;
+	}
+
+	*size = (int32)low;
+	*file = fileHandle;
+	*mapping = mappingHandle;
+	return (const uint8*)data;
+#elif defined(__linux__) || defined (__APPLE__)
+	int fd = open(fileName, O_RDONLY);
+	if (fd < 0)
+	{
+		return NULL;
+	}
+
+	struct stat info;
+	if (fstat(fd, &info) != 0 || info.st_size == 0 || info.st_size > 0x7FFFFFFF)
+	{
+		close(fd);
+		return NULL;
+	}
+
+	void* data = mmap(NULL, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (data == MAP_FAILED)
+	{
+		return NULL;
+	}
+
+	*size = (int32)info.st_size;
+	return (const uint8*)data;
+#else
+	// No mapping on this platform, read the whole file.
+	FILE* fileHandle = fopen(fileName, "rb");
+	if (fileHandle == NULL)
+	{
+		return NULL;
+	}
+
+	fseek(fileHandle, 0, SEEK_END);
+	long length = ftell(fileHandle);
+	fseek(fileHandle, 0, SEEK_SET);
+	if (length <= 0 || length > 0x7FFFFFFF)
+	{
+		fclose(fileHandle);
+		return NULL;
+	}
+
+	uint8* data = (uint8*)b2Alloc((int32)length);
+	bool ok = fread(data, 1, (size_t)length, fileHandle) == (size_t)length;
+	fclose(fileHandle);
+	if (ok == false)
+	{
+		b2Free(data);
+		return NULL;
+	}
+
+	*size = (int32)length;
+	return data;
+#endif
+}
+
+static void b2UnmapFile(const uint8* data, int32 size, void* file, void* mapping)
+{
+#if defined(_WIN32)
+	B2_NOT_USED(size);
+	UnmapViewOfFile(data);
+	CloseHandle((HANDLE)mapping);
+	CloseHandle((HANDLE)file);
+#elif defined(__linux__) || defined (__APPLE__)
+	B2_NOT_USED(file);
+	B2_NOT_USED(mapping);
+	munmap((void*)data, (size_t)size);
+#else
+	B2_NOT_USED(size);
+	B2_NOT_USED(file);
+	B2_NOT_USED(mapping);
+	b2Free((void*)data);
+#endif
+}
+
+b2TrackReader::b2TrackReader()
+{
+	m_data = NULL;
+	m_size = 0;
+	m_file = NULL;
+	m_mapping = NULL;
+	m_bodyCount = 0;
+	m_frameCount = 0;
+	m_keyframeInterval = 1;
+	m_timeStep = 0.0f;
+	m_positionPrecision = 0.0f;
+	m_keyframeOffsets = NULL;
+	m_states = NULL;
+	m_transforms = NULL;
+	m_frame = 0;
+	m_offset = 0;
+}
+
+b2TrackReader::~b2TrackReader()
+{
+	Close();
+}
+
+bool b2TrackReader::Open(const char* fileName)
+{
+	Close();
+
+	m_data = b2MapFile(fileName, &m_size, &m_file, &m_mapping);
+	if (m_data == NULL)
+	{
+		m_size = 0;
+		return false;
+	}
+
+	bool ok = m_size >= b2_trackHeaderSize && memcmp(m_data, "B2TK", 4) == 0 &&
+		b2ReadUint32(m_data + 4) == b2_trackVersion;
+
+	if (ok)
+	{
+		m_bodyCount = (int32)b2ReadUint32(m_data + 8);
+		m_frameCount = (int32)b2ReadUint32(m_data + 12);
+		m_keyframeInterval = (int32)b2ReadUint32(m_data + 16);
+		m_timeStep = b2BitsFloat(b2ReadUint32(m_data + 20));
+		m_positionPrecision = b2BitsFloat(b2ReadUint32(m_data + 24));
+		uint32 indexOffset = b2ReadUint32(m_data + 28);
+
+		ok = m_bodyCount > 0 && m_bodyCount <= (m_size - b2_trackHeaderSize) / 10 &&
+			m_frameCount > 0 && m_keyframeInterval > 0 &&
+			m_timeStep > 0.0f && m_positionPrecision > 0.0f && indexOffset >= (uint32)b2_trackHeaderSize;
+
+		if (ok)
+		{
+			uint32 keyframeCount = (uint32)((m_frameCount - 1) / m_keyframeInterval + 1);
+			ok = indexOffset <= (uint32)m_size && keyframeCount <= ((uint32)m_size - indexOffset) / 4;
+			m_keyframeOffsets = m_data + indexOffset;
+		}
+	}
+
+	if (ok == false)
+	{
+		Close();
+		return false;
+	}
+
+	m_states = (b2TrackState*)b2Alloc(m_bodyCount * sizeof(b2TrackState));
+	m_transforms = (b2BodyTransform*)b2Alloc(m_bodyCount * sizeof(b2BodyTransform));
+
+	return Seek(0);
+}
+
+void b2TrackReader::Close()
+{
+	if (m_data)
+	{
+		b2UnmapFile(m_data, m_size, m_file, m_mapping);
+	}
+
+	b2Free(m_states);
+	b2Free(m_transforms);
+
+	m_data = NULL;
+	m_size = 0;
+	m_file = NULL;
+	m_mapping = NULL;
+	m_bodyCount = 0;
+	m_frameCount = 0;
+	m_keyframeOffsets = NULL;
+	m_states = NULL;
+	m_transforms = NULL;
+	m_frame = 0;
+	m_offset = 0;
+}
+
+float32 b2TrackReader::GetBytesPerSecond() const
+{
+	return b2BytesPerSecond(m_size, m_frameCount, m_timeStep);
+}
+
+bool b2TrackReader::Seek(int32 frame)
+{
+	if (m_data == NULL || frame < 0 || frame >= m_frameCount)
+	{
+		return false;
+	}
+
+	int32 keyframe = frame / m_keyframeInterval;
+	m_frame = keyframe * m_keyframeInterval;
+	m_offset = (int32)b2ReadUint32(m_keyframeOffsets + 4 * keyframe);
+
+	while (m_frame < frame)
+	{
+		if (ReadFrame() == NULL)
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+const b2BodyTransform* b2TrackReader::ReadFrame()
+{
+	if (m_data == NULL || m_frame >= m_frameCount)
+	{
+		return NULL;
+	}
+
+	// Frames end where the index starts.
+	int32 size = (int32)(m_keyframeOffsets - m_data);
+	bool ok = m_offset >= b2_trackHeaderSize;
+
+	if (ok && m_frame % m_keyframeInterval == 0)
+	{
+		ok = m_offset <= size - 10 * m_bodyCount;
+		for (int32 i = 0; ok && i < m_bodyCount; ++i)
+		{
+			const uint8* p = m_data + m_offset;
+			int32 angle = (int32)p[8] | ((int32)p[9] << 8);
+			b2SetKeyframe(m_states + i, (int32)b2ReadUint32(p), (int32)b2ReadUint32(p + 4), angle);
+			m_offset += 10;
+		}
+	}
+	else if (ok)
+	{
+		const uint8* mask = m_data + m_offset;
+		m_offset += (m_bodyCount + 7) / 8;
+		ok = m_offset <= size;
+
+		for (int32 i = 0; ok && i < m_bodyCount; ++i)
+		{
+			uint32 rx = 0, ry = 0, rangle = 0;
+			if (mask[i >> 3] & (1 << (i & 7)))
+			{
+				ok = b2ReadResidual(m_data, size, &m_offset, &rx) &&
+					b2ReadResidual(m_data, size, &m_offset, &ry) &&
+					b2ReadResidual(m_data, size, &m_offset, &rangle);
+			}
+
+			b2ApplyResiduals(m_states + i, rx, ry, rangle);
+		}
+	}
+
+	if (ok == false)
+	{
+		// The file is damaged.
+		m_frame = m_frameCount;
+		return NULL;
+	}
+
+	for (int32 i = 0; i < m_bodyCount; ++i)
+	{
+		const b2TrackState* s = m_states + i;
+		m_transforms[i].position.Set(m_positionPrecision * (float32)s->x, m_positionPrecision * (float32)s->y);
+		m_transforms[i].angle = (float32)s->angle / b2_trackAngleScale;
+	}
+
+	++m_frame;
+	return m_transforms;
+}
+
+b2TrackPlayer::b2TrackPlayer()
+{
+	m_reader = NULL;
+	m_bodies = NULL;
+	m_types = NULL;
+	m_bodyCount = 0;
+}
+
+b2TrackPlayer::~b2TrackPlayer()
+{
+	if (m_reader)
+	{
+		End();
+	}
+}
+
+bool b2TrackPlayer::Begin(b2TrackReader* reader, b2Body* const* bodies, int32 count)
+{
+	b2Assert(m_reader == NULL);
+
+	if (count != reader->GetBodyCount() || reader->Seek(0) == false)
+	{
+		return false;
+	}
+
+	const b2BodyTransform* frame = reader->ReadFrame();
+	if (frame == NULL)
+	{
+		return false;
+	}
+
+	m_reader = reader;
+	m_bodyCount = count;
+	m_bodies = (b2Body**)b2Alloc(count * sizeof(b2Body*));
+	m_types = (b2BodyType*)b2Alloc(count * sizeof(b2BodyType));
+
+	for (int32 i = 0; i < count; ++i)
+	{
+		b2Body* body = bodies[i];
+		m_bodies[i] = body;
+		m_types[i] = body->GetType();
+
+		// A kinematic body has its center at the origin, so the velocity
+		// moves the origin.
+		body->SetType(b2_kinematicBody);
+		body->SetTransform(frame[i].position, frame[i].angle);
+		body->SetLinearVelocity(b2Vec2_zero);
+		body->SetAngularVelocity(0.0f);
+	}
+
+	return true;
+}
+
+bool b2TrackPlayer::Step()
+{
+	b2Assert(m_reader != NULL);
+
+	const b2BodyTransform* frame = m_reader->ReadFrame();
+	float32 inv_dt = 1.0f / m_reader->GetTimeStep();
+
+	for (int32 i = 0; i < m_bodyCount; ++i)
+	{
+		b2Body* body = m_bodies[i];
+		if (frame == NULL)
+		{
+			body->SetLinearVelocity(b2Vec2_zero);
+			body->SetAngularVelocity(0.0f);
+			continue;
+		}
+
+		// Aim at the frame from where the body is, so round-off doesn't add up.
+		float32 angle = frame[i].angle - body->GetAngle();
+		angle -= 2.0f * b2_pi * floorf((angle + b2_pi) / (2.0f * b2_pi));
+
+		body->SetLinearVelocity(inv_dt * (frame[i].position - body->GetPosition()));
+		body->SetAngularVelocity(inv_dt * angle);
+	}
+
+	return frame != NULL;
+}
+
+void b2TrackPlayer::End()
+{
+	b2Assert(m_reader != NULL);
+
+	for (int32 i = 0; i < m_bodyCount; ++i)
+	{
+		m_bodies[i]->SetType(m_types[i]);
+	}
+
+	b2Free(m_bodies);
+	b2Free(m_types);
+	m_reader = NULL;
+	m_bodies = NULL;
+	m_types = NULL;
+	m_bodyCount = 0;
+}
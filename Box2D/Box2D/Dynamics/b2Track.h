@@ -0,0 +1,241 @@
+/*
+* Copyright (c) 2006-2009 Erin Catto http://www.box2d.org
+*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#ifndef B2_TRACK_H
+#define B2_TRACK_H
+
+#include <Box2D/Dynamics/b2Body.h>
+#include <stdio.h>
+
+struct b2BodyTransform;
+struct b2TrackState;
+
+/// A track definition is used to construct a b2TrackRecorder.
+struct b2TrackDef
+{
+	/// This constructor sets the definition default values.
+	b2TrackDef()
+	{
+		positionPrecision = 1.0f / 1024.0f;
+		keyframeInterval = 60;
+	}
+
+	/// Positions are rounded to multiples of this, in meters.
+	float32 positionPrecision;
+
+	/// Every this many frames the track has a keyframe with the full
+	/// transforms, the frames in between only have the changes.
+	int32 keyframeInterval;
+};
+
+/// A track records the transforms of some bodies at every step, so that parts
+/// that play out the same way in every run can be replayed instead of
+/// simulated. See b2TrackPlayer.
+///
+/// Positions are quantized with b2TrackDef::positionPrecision and angles to
+/// 16 bits per turn. A keyframe stores the quantized transforms. Any other
+/// frame stores a bit per body telling if the body differs from the linear
+/// prediction of the previous two frames, followed by the variable length
+/// residuals of those bodies. A body at rest or in steady motion costs one bit
+/// per frame. The file ends with the offsets of the keyframes.
+class b2TrackRecorder
+{
+public:
+	b2TrackRecorder(const b2TrackDef* def);
+	~b2TrackRecorder();
+
+	/// Start recording to a file and record the first frame with the current
+	/// transforms. The bodies must stay alive while recording.
+	/// @param timeStep the time step of the world.
+	/// @return false if the file couldn't be created.
+	bool Begin(const char* fileName, b2Body* const* bodies, int32 count, float32 timeStep);
+
+	/// Record a frame. Call this after every step of the world.
+	void Record();
+
+	/// Finish the file.
+	/// @return false if writing the file failed.
+	bool End();
+
+	/// Get the number of frames recorded so far.
+	int32 GetFrameCount() const;
+
+	/// Get the size of the file so far, in bytes.
+	int32 GetByteCount() const;
+
+	/// Get the bytes per second of recorded time.
+	float32 GetBytesPerSecond() const;
+
+private:
+
+	void WriteFrame();
+
+	b2TrackDef m_def;
+	float32 m_timeStep;
+
+	FILE* m_file;
+	bool m_error;
+
+	b2Body** m_bodies;
+	b2TrackState* m_states;
+	int32 m_bodyCount;
+
+	// The frame being encoded.
+	uint8* m_buffer;
+	int32 m_bufferCapacity;
+
+	uint32* m_keyframeOffsets;
+	int32 m_keyframeCapacity;
+
+	int32 m_frameCount;
+	int32 m_byteCount;
+};
+
+/// Streaming reader of a track file. The file is memory mapped and decoded
+/// one frame at a time, so a long track costs little memory.
+class b2TrackReader
+{
+public:
+	b2TrackReader();
+	~b2TrackReader();
+
+	/// Map a track file. This also closes the previous one.
+	/// @return false if the file couldn't be mapped or isn't a track.
+	bool Open(const char* fileName);
+
+	/// Unmap the file.
+	void Close();
+
+	/// Get the number of bodies of the track.
+	int32 GetBodyCount() const;
+
+	/// Get the number of frames.
+	int32 GetFrameCount() const;
+
+	/// Get the time step the track was recorded with.
+	float32 GetTimeStep() const;
+
+	/// Get the size of the file, in bytes.
+	int32 GetByteCount() const;
+
+	/// Get the bytes per second of recorded time.
+	float32 GetBytesPerSecond() const;
+
+	/// Get the index of the frame the next call to ReadFrame returns.
+	int32 GetFrame() const;
+
+	/// Move to a frame. This decodes from the keyframe before it.
+	/// @return false if the frame is out of range or the file is damaged.
+	bool Seek(int32 frame);
+
+	/// Decode the next frame.
+	/// @return the transforms of the bodies, in the order they were recorded,
+	/// or NULL at the end of the track or if the file is damaged. The array is
+	/// valid until the next call.
+	const b2BodyTransform* ReadFrame();
+
+private:
+
+	const uint8* m_data;
+	int32 m_size;
+
+	// Platform handles of the mapping.
+	void* m_file;
+	void* m_mapping;
+
+	int32 m_bodyCount;
+	int32 m_frameCount;
+	int32 m_keyframeInterval;
+	float32 m_timeStep;
+	float32 m_positionPrecision;
+	const uint8* m_keyframeOffsets;
+
+	b2TrackState* m_states;
+	b2BodyTransform* m_transforms;
+
+	int32 m_frame;
+	int32 m_offset;
+};
+
+/// Drives bodies as kinematic bodies along a track. The bodies move with the
+/// velocity that takes them to the next frame, so dynamic bodies still collide
+/// with them correctly, but they cost no more than a kinematic body. The world
+/// must be stepped with the time step of the track.
+class b2TrackPlayer
+{
+public:
+	b2TrackPlayer();
+	~b2TrackPlayer();
+
+	/// Make the bodies kinematic and move them to the first frame.
+	/// @param bodies the bodies in the order they were recorded.
+	/// @return false if the count doesn't match the track.
+	bool Begin(b2TrackReader* reader, b2Body* const* bodies, int32 count);
+
+	/// Set the velocities for the next frame. Call this before every step of
+	/// the world.
+	/// @return false at the end of the track, the bodies then stop.
+	bool Step();
+
+	/// Give the bodies their old type back.
+	void End();
+
+private:
+
+	b2TrackReader* m_reader;
+	b2Body** m_bodies;
+	b2BodyType* m_types;
+	int32 m_bodyCount;
+};
+
+inline int32 b2TrackRecorder::GetFrameCount() const
+{
+	return m_frameCount;
+}
+
+inline int32 b2TrackRecorder::GetByteCount() const
+{
+	return m_byteCount;
+}
+
+inline int32 b2TrackReader::GetBodyCount() const
+{
+	return m_bodyCount;
+}
+
+inline int32 b2TrackReader::GetFrameCount() const
+{
+	return m_frameCount;
+}
+
+inline float32 b2TrackReader::GetTimeStep() const
+{
+	return m_timeStep;
+}
+
+inline int32 b2TrackReader::GetByteCount() const
+{
+	return m_size;
+}
+
+inline int32 b2TrackReader::GetFrame() const
+{
+	return m_frame;
+}
+
+#endif
@@ -18,6 +18,7 @@
 
 #include <Box2D/Dynamics/b2World.h>
 #include <Box2D/Dynamics/b2Body.h>
+#include <Box2D/Dynamics/b2BodyPrefab.h>
 #include <Box2D/Dynamics/b2Fixture.h>
 #include <Box2D/Dynamics/b2Island.h>
 #include <Box2D/Dynamics/Joints/b2PulleyJoint.h>
@@ -28,19 +29,52 @@
 #include <Box2D/Collision/Shapes/b2CircleShape.h>
 #include <Box2D/Collision/Shapes/b2EdgeShape.h>
 #include <Box2D/Collision/Shapes/b2ChainShape.h>
+#include <Box2D/Collision/Shapes/b2CompoundShape.h>
+#include <Box2D/Collision/Shapes/b2HeightFieldShape.h>
+#include <Box2D/Collision/Shapes/b2CapsuleShape.h>
 #include <Box2D/Collision/Shapes/b2PolygonShape.h>
 #include <Box2D/Collision/b2TimeOfImpact.h>
 #include <Box2D/Common/b2Draw.h>
 #include <Box2D/Common/b2Timer.h>
+#include <Box2D/Particle/b2ParticleSystem.h>
+#include <Box2D/Dynamics/b2QuerySnapshot.h>
+#include <Box2D/Common/b2Atomic.h>
 #include <new>
 
+// Budgeted steps don't scale the iterations below this.
+const float32 b2_minIterationScale = 0.25f;
+
+struct b2RetiredShape
+{
+	b2Shape* shape;
+
+	// Snapshots up to this step may use the shape.
+	int32 stepCount;
+};
+
+struct b2TransformRecord
+{
+	b2Body* body;
+
+	// The transform before the first change since the last export.
+	b2Vec2 position0;
+	float32 angle0;
+	bool created;
+
+	b2BodyTransform transform;
+	void* userData;
+};
+
 b2World::b2World(const b2Vec2& gravity)
 {
 	m_destructionListener = NULL;
 	m_debugDraw = NULL;
+	m_taskExecutor = NULL;
+	m_parallelIslandThreshold = 0;
 
 	m_bodyList = NULL;
 	m_jointList = NULL;
+	m_particleSystemList = NULL;
 
 	m_bodyCount = 0;
 	m_jointCount = 0;
@@ -48,9 +82,41 @@ b2World::b2World(const b2Vec2& gravity)
 	m_warmStarting = true;
 	m_continuousPhysics = true;
 	m_subStepping = false;
+	m_solverSubSteps = 0;
+	m_velocityTolerance = 0.0f;
+	m_minVelocityIterations = 1;
 
 	m_stepComplete = true;
 
+	m_stepPhase = e_endStepPhase;
+	m_stepCount = 0;
+
+	m_stepBudget = 0.0f;
+	m_iterationScale = 1.0f;
+	m_toiEstimate = 0.0f;
+	m_stepDegradations = 0;
+
+	m_multiRate = false;
+	m_updateRateFilter = NULL;
+	m_updateRateView.lowerBound.SetZero();
+	m_updateRateView.upperBound.SetZero();
+	m_outsideUpdateRate = 1;
+
+	m_querySnapshots = false;
+	m_snapshots = NULL;
+	m_snapshotCount = 0;
+	m_snapshotCapacity = 0;
+	m_publishedSnapshot = NULL;
+
+	m_retiredShapes = NULL;
+	m_retiredCount = 0;
+	m_retiredCapacity = 0;
+
+	m_transformExport = false;
+	m_transformRecords = NULL;
+	m_transformRecordCount = 0;
+	m_transformRecordCapacity = 0;
+
 	m_allowSleep = true;
 	m_gravity = gravity;
 
@@ -59,12 +125,35 @@ b2World::b2World(const b2Vec2& gravity)
 	m_inv_dt0 = 0.0f;
 
 	m_contactManager.m_allocator = &m_blockAllocator;
+	m_islandManager.m_allocator = &m_blockAllocator;
 
 	memset(&m_profile, 0, sizeof(b2Profile));
 }
 
 b2World::~b2World()
 {
+	while (m_particleSystemList)
+	{
+		DestroyParticleSystem(m_particleSystemList);
+	}
+
+	// No thread may use the snapshots anymore.
+	for (int32 i = 0; i < m_retiredCount; ++i)
+	{
+		b2Fixture::DestroyShape(&m_blockAllocator, m_retiredShapes[i].shape);
+	}
+	b2Free(m_retiredShapes);
+
+	b2Free(m_transformRecords);
+
+	for (int32 i = 0; i < m_snapshotCount; ++i)
+	{
+		m_snapshots[i]->~b2QuerySnapshot();
+		b2Free(m_snapshots[i]);
+	}
+	b2Free(m_snapshots);
+	m_snapshotCount = 0;
+
 	// Some shapes allocate using b2Alloc.
 	b2Body* b = m_bodyList;
 	while (b)
@@ -91,7 +180,27 @@ void b2World::SetDestructionListener(b2DestructionListener* listener)
 
 void b2World::SetContactFilter(b2ContactFilter* filter)
 {
-	m_contactManager.m_contactFilter = filter;
+	m_contactManager.SetContactFilter(filter);
+}
+
+void b2World::SetUpdateRateFilter(b2UpdateRateFilter* filter)
+{
+	m_updateRateFilter = filter;
+	if (filter)
+	{
+		m_multiRate = true;
+	}
+}
+
+void b2World::SetUpdateRateView(const b2AABB& view, int32 outsideRate)
+{
+	b2Assert(outsideRate >= 1);
+	m_updateRateView = view;
+	m_outsideUpdateRate = outsideRate;
+	if (outsideRate > 1)
+	{
+		m_multiRate = true;
+	}
 }
 
 void b2World::SetContactListener(b2ContactListener* listener)
@@ -99,6 +208,11 @@ void b2World::SetContactListener(b2ContactListener* listener)
 	m_contactManager.m_contactListener = listener;
 }
 
+void b2World::SetTaskExecutor(b2TaskExecutor* executor)
+{
+	m_taskExecutor = executor;
+}
+
 void b2World::SetDebugDraw(b2Draw* debugDraw)
 {
 	m_debugDraw = debugDraw;
@@ -125,9 +239,124 @@ b2Body* b2World::CreateBody(const b2BodyDef* def)
 	m_bodyList = b;
 	++m_bodyCount;
 
+	if (b->m_type != b2_staticBody && b->IsActive())
+	{
+		m_islandManager.AddBody(b);
+	}
+
+	if (m_transformExport)
+	{
+		RecordTransform(b, b->m_xf.p, b->m_sweep.a, true);
+	}
+
 	return b;
 }
 
+void b2World::CreateBodies(const b2BodyPrefab* prefab, const b2Transform* transforms, int32 count, b2Body** bodies)
+{
+	b2Assert(IsLocked() == false);
+	if (IsLocked() || count == 0)
+	{
+		return;
+	}
+
+	b2BodyDef def = prefab->m_def;
+
+	// The proxies of all bodies are inserted into the broad-phase together.
+	int32 proxyCount = def.active ? count * prefab->m_proxyCount : 0;
+	b2FixtureProxy** proxies = (b2FixtureProxy**)m_stackAllocator.Allocate(proxyCount * sizeof(b2FixtureProxy*));
+	b2AABB* aabbs = (b2AABB*)m_stackAllocator.Allocate(proxyCount * sizeof(b2AABB));
+	b2Filter* filters = (b2Filter*)m_stackAllocator.Allocate(proxyCount * sizeof(b2Filter));
+	int32* proxyIds = (int32*)m_stackAllocator.Allocate(proxyCount * sizeof(int32));
+	int32 proxyIndex = 0;
+
+	for (int32 i = 0; i < count; ++i)
+	{
+		def.position = transforms[i].p;
+		def.angle = transforms[i].q.GetAngle();
+
+		void* mem = m_blockAllocator.Allocate(sizeof(b2Body));
+		b2Body* b = new (mem) b2Body(&def, this);
+
+		for (int32 j = 0; j < prefab->m_fixtureCount; ++j)
+		{
+			void* memory = m_blockAllocator.Allocate(sizeof(b2Fixture));
+			b2Fixture* fixture = new (memory) b2Fixture;
+			fixture->Create(&m_blockAllocator, b, prefab->m_fixtures + j);
+
+			if (def.active)
+			{
+				fixture->InitializeProxies(b->m_xf);
+				for (int32 k = 0; k < fixture->m_proxyCount; ++k)
+				{
+					proxies[proxyIndex] = fixture->m_proxies + k;
+					aabbs[proxyIndex] = fixture->m_proxies[k].aabb;
+					filters[proxyIndex] = fixture->m_filter;
+					++proxyIndex;
+				}
+			}
+
+			fixture->m_next = b->m_fixtureList;
+			b->m_fixtureList = fixture;
+			++b->m_fixtureCount;
+		}
+
+		// The mass data of the prefab, see b2Body::ResetMassData.
+		if (b->m_type == b2_dynamicBody)
+		{
+			b->m_mass = prefab->m_mass;
+			b->m_invMass = prefab->m_invMass;
+			b->m_I = prefab->m_I;
+			b->m_invI = prefab->m_invI;
+			b->m_sweep.localCenter = prefab->m_localCenter;
+			b->m_sweep.c0 = b->m_sweep.c = b2Mul(b->m_xf, b->m_sweep.localCenter);
+			b->m_linearVelocity += b2Cross(b->m_angularVelocity, b->m_sweep.c - b->m_xf.p);
+		}
+
+		// Add to world doubly linked list.
+		b->m_prev = NULL;
+		b->m_next = m_bodyList;
+		if (m_bodyList)
+		{
+			m_bodyList->m_prev = b;
+		}
+		m_bodyList = b;
+		++m_bodyCount;
+
+		if (b->m_type != b2_staticBody && b->IsActive())
+		{
+			m_islandManager.AddBody(b);
+		}
+
+		if (m_transformExport)
+		{
+			RecordTransform(b, b->m_xf.p, b->m_sweep.a, true);
+		}
+
+		if (bodies)
+		{
+			bodies[i] = b;
+		}
+	}
+
+	b2Assert(proxyIndex == proxyCount);
+	m_contactManager.m_broadPhase.CreateProxies(proxyIds, aabbs, (void* const*)proxies, filters, proxyCount);
+	for (int32 i = 0; i < proxyCount; ++i)
+	{
+		proxies[i]->proxyId = proxyIds[i];
+	}
+
+	m_stackAllocator.Free(proxyIds);
+	m_stackAllocator.Free(filters);
+	m_stackAllocator.Free(aabbs);
+	m_stackAllocator.Free(proxies);
+
+	if (prefab->m_fixtureCount > 0)
+	{
+		m_flags |= e_newFixture;
+	}
+}
+
 void b2World::DestroyBody(b2Body* b)
 {
 	b2Assert(m_bodyCount > 0);
@@ -178,6 +407,7 @@ void b2World::DestroyBody(b2Body* b)
 		}
 
 		f0->DestroyProxies(&m_contactManager.m_broadPhase);
+		m_contactManager.m_impulseCache.RemoveFixture(f0);
 		f0->Destroy(&m_blockAllocator);
 		f0->~b2Fixture();
 		m_blockAllocator.Free(f0, sizeof(b2Fixture));
@@ -188,6 +418,10 @@ void b2World::DestroyBody(b2Body* b)
 	b->m_fixtureList = NULL;
 	b->m_fixtureCount = 0;
 
+	m_islandManager.RemoveBody(b);
+
+	RemoveTransformRecord(b);
+
 	// Remove world body list.
 	if (b->m_prev)
 	{
@@ -264,7 +498,8 @@ b2Joint* b2World::CreateJoint(const b2JointDef* def)
 		}
 	}
 
-	// Note: creating a joint doesn't wake the bodies.
+	// Join the islands. Note: creating a joint doesn't wake the bodies.
+	m_islandManager.LinkBodies(bodyA, bodyB);
 
 	return j;
 }
@@ -303,6 +538,9 @@ void b2World::DestroyJoint(b2Joint* j)
 	bodyA->SetAwake(true);
 	bodyB->SetAwake(true);
 
+	// The island may fall apart.
+	m_islandManager.UnlinkBodies(bodyA, bodyB);
+
 	// Remove from body 1.
 	if (j->m_edgeA.prev)
 	{
@@ -364,6 +602,58 @@ void b2World::DestroyJoint(b2Joint* j)
 	}
 }
 
+b2ParticleSystem* b2World::CreateParticleSystem(const b2ParticleSystemDef* def)
+{
+	b2Assert(IsLocked() == false);
+	if (IsLocked())
+	{
+		return NULL;
+	}
+
+	// The particle arrays are allocated with b2Alloc, so is the system.
+	void* mem = b2Alloc(sizeof(b2ParticleSystem));
+	b2ParticleSystem* p = new (mem) b2ParticleSystem(def, this);
+
+	// Add to world doubly linked list.
+	p->m_prev = NULL;
+	p->m_next = m_particleSystemList;
+	if (m_particleSystemList)
+	{
+		m_particleSystemList->m_prev = p;
+	}
+	m_particleSystemList = p;
+
+	return p;
+}
+
+void b2World::DestroyParticleSystem(b2ParticleSystem* p)
+{
+	b2Assert(IsLocked() == false);
+	if (IsLocked())
+	{
+		return;
+	}
+
+	// Remove from the world list.
+	if (p->m_prev)
+	{
+		p->m_prev->m_next = p->m_next;
+	}
+
+	if (p->m_next)
+	{
+		p->m_next->m_prev = p->m_prev;
+	}
+
+	if (p == m_particleSystemList)
+	{
+		m_particleSystemList = p->m_next;
+	}
+
+	p->~b2ParticleSystem();
+	b2Free(p);
+}
+
 //
 void b2World::SetAllowSleeping(bool flag)
 {
@@ -382,12 +672,18 @@ void b2World::SetAllowSleeping(bool flag)
 	}
 }
 
-// Find islands, integrate and solve constraints, solve position constraints
+// Build the awake islands, integrate and solve constraints, solve position constraints
 void b2World::Solve(const b2TimeStep& step)
 {
+	m_profile.buildIslands = 0.0f;
 	m_profile.solveInit = 0.0f;
 	m_profile.solveVelocity = 0.0f;
 	m_profile.solvePosition = 0.0f;
+	m_profile.velocityIterations = 0.0f;
+	m_profile.positionIterations = 0.0f;
+
+	float32 synchronizeTime = 0.0f;
+	int32 islandCount = 0;
 
 	// Size the island for the worst case.
 	b2Island island(m_bodyCount,
@@ -395,73 +691,94 @@ void b2World::Solve(const b2TimeStep& step)
 					m_jointCount,
 					&m_stackAllocator,
 					m_contactManager.m_contactListener);
+	island.m_executor = m_taskExecutor;
+	island.m_parallelThreshold = m_parallelIslandThreshold;
 
-	// Clear all the island flags.
-	for (b2Body* b = m_bodyList; b; b = b->m_next)
-	{
-		b->m_flags &= ~b2Body::e_islandFlag;
-	}
-	for (b2Contact* c = m_contactManager.m_contactList; c; c = c->m_next)
-	{
-		c->m_flags &= ~b2Contact::e_islandFlag;
-	}
-	for (b2Joint* j = m_jointList; j; j = j->m_next)
-	{
-		j->m_islandFlag = false;
-	}
+	// The island with the sleepiest body that has pending constraint removals.
+	b2PersistentIsland* splitCandidate = NULL;
+	float32 splitSleepTime = 0.0f;
 
-	// Build and simulate all awake islands.
-	int32 stackSize = m_bodyCount;
-	b2Body** stack = (b2Body**)m_stackAllocator.Allocate(stackSize * sizeof(b2Body*));
-	for (b2Body* seed = m_bodyList; seed; seed = seed->m_next)
+	// Simulate the awake islands. Sleeping islands are not visited.
+	b2PersistentIsland* persistent = m_islandManager.m_awakeList;
+	while (persistent)
 	{
-		if (seed->m_flags & b2Body::e_islandFlag)
+		b2PersistentIsland* next = persistent->next;
+
+		b2Timer buildTimer;
+
+		// The island only sleeps if all bodies are asleep.
+		bool awake = false;
+		for (b2Body* b = persistent->bodyList; b; b = b->m_islandNext)
 		{
-			continue;
+			if (b->IsAwake())
+			{
+				awake = true;
+				break;
+			}
 		}
 
-		if (seed->IsAwake() == false || seed->IsActive() == false)
+		if (awake == false)
 		{
+			m_islandManager.SleepIsland(persistent);
+			m_profile.buildIslands += buildTimer.GetMilliseconds();
+			persistent = next;
 			continue;
 		}
 
-		// The seed can be dynamic or kinematic.
-		if (seed->GetType() == b2_staticBody)
+		// An island is updated at the rate of its most frequently updated body,
+		// once that many steps have passed since the update of any of its bodies.
+		int32 rate = 1;
+		if (m_multiRate)
 		{
-			continue;
+			rate = GetUpdateRate(persistent->bodyList);
+			int32 lastUpdate = persistent->bodyList->m_updateStep;
+			for (b2Body* b = persistent->bodyList->m_islandNext; b; b = b->m_islandNext)
+			{
+				rate = b2Min(rate, GetUpdateRate(b));
+				lastUpdate = b2Min(lastUpdate, b->m_updateStep);
+			}
+
+			if (m_stepCount - lastUpdate < rate)
+			{
+				// Stop the sweeps so that SolveTOI doesn't move the bodies again.
+				for (b2Body* b = persistent->bodyList; b; b = b->m_islandNext)
+				{
+					b->m_sweep.c0 = b->m_sweep.c;
+					b->m_sweep.a0 = b->m_sweep.a;
+				}
+
+				m_profile.buildIslands += buildTimer.GetMilliseconds();
+				persistent = next;
+				continue;
+			}
 		}
 
-		// Reset island and stack.
 		island.Clear();
-		int32 stackCount = 0;
-		stack[stackCount++] = seed;
-		seed->m_flags |= b2Body::e_islandFlag;
-
-		// Perform a depth first search (DFS) on the constraint graph.
-		while (stackCount > 0)
+		for (b2Body* b = persistent->bodyList; b; b = b->m_islandNext)
 		{
-			// Grab the next body off the stack and add it to the island.
-			b2Body* b = stack[--stackCount];
 			b2Assert(b->IsActive() == true);
 			island.Add(b);
 
+			b->m_updateStep = m_stepCount;
+			b->m_updateInterval = rate;
+			b->m_interpolationCenter = b->m_sweep.c;
+			b->m_interpolationAngle = b->m_sweep.a;
+
 			// Make sure the body is awake.
 			b->SetAwake(true);
+		}
 
-			// To keep islands as small as possible, we don't
-			// propagate islands across static bodies.
-			if (b->GetType() == b2_staticBody)
-			{
-				continue;
-			}
-
+		// Gather the constraints. Static bodies are added once per island and
+		// don't propagate it.
+		for (b2Body* b = persistent->bodyList; b; b = b->m_islandNext)
+		{
 			// Search all contacts connected to this body.
 			for (b2ContactEdge* ce = b->m_contactList; ce; ce = ce->next)
 			{
 				b2Contact* contact = ce->contact;
 
-				// Has this contact already been added to an island?
-				if (contact->m_flags & b2Contact::e_islandFlag)
+				// Has this contact already been added to this island?
+				if (contact->m_state->flags & b2Contact::e_islandFlag)
 				{
 					continue;
 				}
@@ -474,27 +791,31 @@ void b2World::Solve(const b2TimeStep& step)
 				}
 
 				// Skip sensors.
-				bool sensorA = contact->m_fixtureA->m_isSensor;
-				bool sensorB = contact->m_fixtureB->m_isSensor;
+				bool sensorA = contact->m_state->fixtureA->m_isSensor;
+				bool sensorB = contact->m_state->fixtureB->m_isSensor;
 				if (sensorA || sensorB)
 				{
 					continue;
 				}
 
-				island.Add(contact);
-				contact->m_flags |= b2Contact::e_islandFlag;
-
 				b2Body* other = ce->other;
-
-				// Was the other body already added to this island?
-				if (other->m_flags & b2Body::e_islandFlag)
+				if (other->GetType() == b2_staticBody)
 				{
+					if ((other->m_flags & b2Body::e_islandFlag) == 0)
+					{
+						island.Add(other);
+						other->m_flags |= b2Body::e_islandFlag;
+					}
+				}
+				else if (other->m_island != persistent)
+				{
+					// Touching contacts link their islands in b2Contact::Update.
+					b2Assert(false);
 					continue;
 				}
 
-				b2Assert(stackCount < stackSize);
-				stack[stackCount++] = other;
-				other->m_flags |= b2Body::e_islandFlag;
+				island.Add(contact);
+				contact->m_state->flags |= b2Contact::e_islandFlag;
 			}
 
 			// Search all joints connect to this body.
@@ -513,27 +834,75 @@ void b2World::Solve(const b2TimeStep& step)
 					continue;
 				}
 
+				if (other->GetType() == b2_staticBody)
+				{
+					if ((other->m_flags & b2Body::e_islandFlag) == 0)
+					{
+						island.Add(other);
+						other->m_flags |= b2Body::e_islandFlag;
+					}
+				}
+				else
+				{
+					b2Assert(other->m_island == persistent);
+				}
+
 				island.Add(je->joint);
 				je->joint->m_islandFlag = true;
+			}
+		}
+
+		m_profile.buildIslands += buildTimer.GetMilliseconds();
+
+		// Islands take fewer iterations when the steps run over budget, and
+		// as few as possible once this step has used up its budget.
+		b2TimeStep islandStep = step;
+		if (rate > 1)
+		{
+			islandStep.dt = rate * step.dt;
+			islandStep.inv_dt = step.inv_dt / rate;
+		}
+		if (m_stepBudget > 0.0f)
+		{
+			float32 scale = m_iterationScale;
+			if (m_stepTimer.GetMilliseconds() > m_stepBudget)
+			{
+				scale = b2_minIterationScale;
+			}
 
-				if (other->m_flags & b2Body::e_islandFlag)
+			if (scale < 1.0f)
+			{
+				islandStep.velocityIterations = b2Max(int32(scale * step.velocityIterations + 0.5f), 1);
+				islandStep.positionIterations = b2Max(int32(scale * step.positionIterations + 0.5f), 1);
+				if (step.solverSubSteps > 0)
 				{
-					continue;
+					islandStep.solverSubSteps = b2Max(int32(scale * step.solverSubSteps + 0.5f), 1);
 				}
-
-				b2Assert(stackCount < stackSize);
-				stack[stackCount++] = other;
-				other->m_flags |= b2Body::e_islandFlag;
+				m_stepDegradations |= b2_reducedIterations;
 			}
 		}
 
 		b2Profile profile;
-		island.Solve(&profile, step, m_gravity, m_allowSleep);
+		island.Solve(&profile, islandStep, m_gravity, m_allowSleep);
 		m_profile.solveInit += profile.solveInit;
 		m_profile.solveVelocity += profile.solveVelocity;
 		m_profile.solvePosition += profile.solvePosition;
+		m_profile.velocityIterations += profile.velocityIterations;
+		m_profile.positionIterations += profile.positionIterations;
+		++islandCount;
 
 		// Post solve cleanup.
+		for (int32 i = 0; i < island.m_contactCount; ++i)
+		{
+			island.m_contacts[i]->m_state->flags &= ~b2Contact::e_islandFlag;
+		}
+
+		for (int32 i = 0; i < island.m_jointCount; ++i)
+		{
+			island.m_joints[i]->m_islandFlag = false;
+		}
+
+		b2Timer synchronizeTimer;
 		for (int32 i = 0; i < island.m_bodyCount; ++i)
 		{
 			// Allow static bodies to participate in other islands.
@@ -541,35 +910,61 @@ void b2World::Solve(const b2TimeStep& step)
 			if (b->GetType() == b2_staticBody)
 			{
 				b->m_flags &= ~b2Body::e_islandFlag;
+				continue;
 			}
-		}
-	}
 
-	m_stackAllocator.Free(stack);
+			// Update fixtures (for broad-phase).
+			b->SynchronizeFixtures();
 
-	{
-		b2Timer timer;
-		// Synchronize fixtures, check for out of range bodies.
-		for (b2Body* b = m_bodyList; b; b = b->GetNext())
-		{
-			// If a body was not in an island then it did not move.
-			if ((b->m_flags & b2Body::e_islandFlag) == 0)
+			if (m_transformExport)
 			{
-				continue;
+				b2Rot q0(b->m_sweep.a0);
+				RecordTransform(b, b->m_sweep.c0 - b2Mul(q0, b->m_sweep.localCenter), b->m_sweep.a0, false);
 			}
+		}
+		synchronizeTime += synchronizeTimer.GetMilliseconds();
 
-			if (b->GetType() == b2_staticBody)
+		// b2Island::Solve puts all bodies to sleep together.
+		if (persistent->bodyList->IsAwake() == false)
+		{
+			m_islandManager.SleepIsland(persistent);
+		}
+		else if (persistent->constraintRemoveCount > 0)
+		{
+			for (b2Body* b = persistent->bodyList; b; b = b->m_islandNext)
 			{
-				continue;
+				if (b->m_sleepTime >= b2_timeToSleep && b->m_sleepTime > splitSleepTime)
+				{
+					splitCandidate = persistent;
+					splitSleepTime = b->m_sleepTime;
+				}
 			}
-
-			// Update fixtures (for broad-phase).
-			b->SynchronizeFixtures();
 		}
 
+		persistent = next;
+	}
+
+	if (islandCount > 0)
+	{
+		m_profile.velocityIterations /= float32(islandCount);
+		m_profile.positionIterations /= float32(islandCount);
+	}
+
+	// Split at most one island per step. The parts that are at rest can then
+	// fall asleep on the next step.
+	if (splitCandidate)
+	{
+		b2Timer buildTimer;
+		m_islandManager.SplitIsland(splitCandidate, &m_stackAllocator);
+		m_profile.buildIslands += buildTimer.GetMilliseconds();
+	}
+
+	{
+		b2Timer timer;
+
 		// Look for new contacts.
 		m_contactManager.FindNewContacts();
-		m_profile.broadphase = timer.GetMilliseconds();
+		m_profile.broadphase = synchronizeTime + timer.GetMilliseconds();
 	}
 }
 
@@ -577,6 +972,7 @@ void b2World::Solve(const b2TimeStep& step)
 void b2World::SolveTOI(const b2TimeStep& step)
 {
 	b2Island island(2 * b2_maxTOIContacts, b2_maxTOIContacts, 0, &m_stackAllocator, m_contactManager.m_contactListener);
+	b2ImpulseCache* cache = m_contactManager.m_impulseCaching ? &m_contactManager.m_impulseCache : NULL;
 
 	if (m_stepComplete)
 	{
@@ -586,12 +982,16 @@ void b2World::SolveTOI(const b2TimeStep& step)
 			b->m_sweep.alpha0 = 0.0f;
 		}
 
-		for (b2Contact* c = m_contactManager.m_contactList; c; c = c->m_next)
+		// Inactive contacts are invalidated when they are activated.
+		b2ContactState* states = m_contactManager.m_contacts;
+		const int32* active = m_contactManager.m_activeContacts;
+		for (int32 i = 0; i < m_contactManager.m_activeCount; ++i)
 		{
 			// Invalidate TOI
-			c->m_flags &= ~(b2Contact::e_toiFlag | b2Contact::e_islandFlag);
-			c->m_toiCount = 0;
-			c->m_toi = 1.0f;
+			b2ContactState* state = states + active[i];
+			state->flags &= ~(b2Contact::e_toiFlag | b2Contact::e_islandFlag);
+			state->toiCount = 0;
+			state->toi = 1.0f;
 		}
 	}
 
@@ -602,30 +1002,34 @@ void b2World::SolveTOI(const b2TimeStep& step)
 		b2Contact* minContact = NULL;
 		float32 minAlpha = 1.0f;
 
-		for (b2Contact* c = m_contactManager.m_contactList; c; c = c->m_next)
+		b2ContactState* states = m_contactManager.m_contacts;
+		const int32* active = m_contactManager.m_activeContacts;
+		for (int32 i = 0; i < m_contactManager.m_activeCount; ++i)
 		{
+			b2ContactState* state = states + active[i];
+
 			// Is this contact disabled?
-			if (c->IsEnabled() == false)
+			if ((state->flags & b2Contact::e_enabledFlag) == 0)
 			{
 				continue;
 			}
 
 			// Prevent excessive sub-stepping.
-			if (c->m_toiCount > b2_maxSubSteps)
+			if (state->toiCount > b2_maxSubSteps)
 			{
 				continue;
 			}
 
 			float32 alpha = 1.0f;
-			if (c->m_flags & b2Contact::e_toiFlag)
+			if (state->flags & b2Contact::e_toiFlag)
 			{
 				// This contact has a valid cached TOI.
-				alpha = c->m_toi;
+				alpha = state->toi;
 			}
 			else
 			{
-				b2Fixture* fA = c->GetFixtureA();
-				b2Fixture* fB = c->GetFixtureB();
+				b2Fixture* fA = state->fixtureA;
+				b2Fixture* fB = state->fixtureB;
 
 				// Is there a sensor?
 				if (fA->IsSensor() || fB->IsSensor())
@@ -658,6 +1062,22 @@ void b2World::SolveTOI(const b2TimeStep& step)
 					continue;
 				}
 
+				// Only bullets and the bodies updated this step at the full rate get
+				// continuous collision. With the larger time step of a lower rate,
+				// resting bodies would have TOI events all the time.
+				if (m_multiRate && bA->IsBullet() == false && bB->IsBullet() == false &&
+					(bA->m_updateStep != m_stepCount || bA->m_updateInterval > 1) &&
+					(bB->m_updateStep != m_stepCount || bB->m_updateInterval > 1))
+				{
+					continue;
+				}
+
+				// Is the step over budget and neither body a bullet?
+				if ((m_stepDegradations & b2_deferredTOI) && bA->IsBullet() == false && bB->IsBullet() == false)
+				{
+					continue;
+				}
+
 				// Compute the TOI for this contact.
 				// Put the sweeps onto the same time interval.
 				float32 alpha0 = bA->m_sweep.alpha0;
@@ -675,8 +1095,8 @@ void b2World::SolveTOI(const b2TimeStep& step)
 
 				b2Assert(alpha0 < 1.0f);
 
-				int32 indexA = c->GetChildIndexA();
-				int32 indexB = c->GetChildIndexB();
+				int32 indexA = state->indexA;
+				int32 indexB = state->indexB;
 
 				// Compute the time of impact in interval [0, minTOI]
 				b2TOIInput input;
@@ -700,14 +1120,14 @@ void b2World::SolveTOI(const b2TimeStep& step)
 					alpha = 1.0f;
 				}
 
-				c->m_toi = alpha;
-				c->m_flags |= b2Contact::e_toiFlag;
+				state->toi = alpha;
+				state->flags |= b2Contact::e_toiFlag;
 			}
 
 			if (alpha < minAlpha)
 			{
 				// This is the minimum TOI found so far.
-				minContact = c;
+				minContact = state->contact;
 				minAlpha = alpha;
 			}
 		}
@@ -720,8 +1140,8 @@ void b2World::SolveTOI(const b2TimeStep& step)
 		}
 
 		// Advance the bodies to the TOI.
-		b2Fixture* fA = minContact->GetFixtureA();
-		b2Fixture* fB = minContact->GetFixtureB();
+		b2Fixture* fA = minContact->m_state->fixtureA;
+		b2Fixture* fB = minContact->m_state->fixtureB;
 		b2Body* bA = fA->GetBody();
 		b2Body* bB = fB->GetBody();
 
@@ -732,9 +1152,9 @@ void b2World::SolveTOI(const b2TimeStep& step)
 		bB->Advance(minAlpha);
 
 		// The TOI contact likely has some new contact points.
-		minContact->Update(m_contactManager.m_contactListener);
-		minContact->m_flags &= ~b2Contact::e_toiFlag;
-		++minContact->m_toiCount;
+		minContact->Update(m_contactManager.m_contactListener, cache);
+		minContact->m_state->flags &= ~b2Contact::e_toiFlag;
+		++minContact->m_state->toiCount;
 
 		// Is the contact solid?
 		if (minContact->IsEnabled() == false || minContact->IsTouching() == false)
@@ -759,7 +1179,7 @@ void b2World::SolveTOI(const b2TimeStep& step)
 
 		bA->m_flags |= b2Body::e_islandFlag;
 		bB->m_flags |= b2Body::e_islandFlag;
-		minContact->m_flags |= b2Contact::e_islandFlag;
+		minContact->m_state->flags |= b2Contact::e_islandFlag;
 
 		// Get contacts on bodyA and bodyB.
 		b2Body* bodies[2] = {bA, bB};
@@ -783,7 +1203,7 @@ void b2World::SolveTOI(const b2TimeStep& step)
 					b2Contact* contact = ce->contact;
 
 					// Has this contact already been added to the island?
-					if (contact->m_flags & b2Contact::e_islandFlag)
+					if (contact->m_state->flags & b2Contact::e_islandFlag)
 					{
 						continue;
 					}
@@ -797,8 +1217,8 @@ void b2World::SolveTOI(const b2TimeStep& step)
 					}
 
 					// Skip sensors.
-					bool sensorA = contact->m_fixtureA->m_isSensor;
-					bool sensorB = contact->m_fixtureB->m_isSensor;
+					bool sensorA = contact->m_state->fixtureA->m_isSensor;
+					bool sensorB = contact->m_state->fixtureB->m_isSensor;
 					if (sensorA || sensorB)
 					{
 						continue;
@@ -812,7 +1232,7 @@ void b2World::SolveTOI(const b2TimeStep& step)
 					}
 
 					// Update the contact points
-					contact->Update(m_contactManager.m_contactListener);
+					contact->Update(m_contactManager.m_contactListener, cache);
 
 					// Was the contact disabled by the user?
 					if (contact->IsEnabled() == false)
@@ -831,7 +1251,7 @@ void b2World::SolveTOI(const b2TimeStep& step)
 					}
 
 					// Add the contact to the island
-					contact->m_flags |= b2Contact::e_islandFlag;
+					contact->m_state->flags |= b2Contact::e_islandFlag;
 					island.Add(contact);
 
 					// Has the other body already been added to the island?
@@ -859,6 +1279,9 @@ void b2World::SolveTOI(const b2TimeStep& step)
 		subStep.dtRatio = 1.0f;
 		subStep.positionIterations = 20;
 		subStep.velocityIterations = step.velocityIterations;
+		subStep.solverSubSteps = 0;
+		subStep.velocityTolerance = 0.0f;
+		subStep.minVelocityIterations = 0;
 		subStep.warmStarting = false;
 		island.SolveTOI(subStep, bA->m_islandIndex, bB->m_islandIndex);
 
@@ -875,10 +1298,16 @@ void b2World::SolveTOI(const b2TimeStep& step)
 
 			body->SynchronizeFixtures();
 
+			if (m_transformExport)
+			{
+				b2Rot q0(body->m_sweep.a0);
+				RecordTransform(body, body->m_sweep.c0 - b2Mul(q0, body->m_sweep.localCenter), body->m_sweep.a0, false);
+			}
+
 			// Invalidate all contact TOIs on this displaced body.
 			for (b2ContactEdge* ce = body->m_contactList; ce; ce = ce->next)
 			{
-				ce->contact->m_flags &= ~(b2Contact::e_toiFlag | b2Contact::e_islandFlag);
+				ce->contact->m_state->flags &= ~(b2Contact::e_toiFlag | b2Contact::e_islandFlag);
 			}
 		}
 
@@ -896,21 +1325,58 @@ void b2World::SolveTOI(const b2TimeStep& step)
 
 void b2World::Step(float32 dt, int32 velocityIterations, int32 positionIterations)
 {
-	b2Timer stepTimer;
+	Step(dt, velocityIterations, positionIterations, 0.0f);
+}
 
-	// If new fixtures were added, we need to find the new contacts.
-	if (m_flags & e_newFixture)
+void b2World::Step(float32 dt, int32 velocityIterations, int32 positionIterations, float32 budget)
+{
+	BeginStep(dt, velocityIterations, positionIterations, budget);
+	UpdatePairs();
+	Collide();
+	Solve();
+	SolveTOI();
+	SolveParticles();
+	EndStep();
+}
+
+void b2World::BeginStep(float32 dt, int32 velocityIterations, int32 positionIterations)
+{
+	BeginStep(dt, velocityIterations, positionIterations, 0.0f);
+}
+
+void b2World::BeginStep(float32 dt, int32 velocityIterations, int32 positionIterations, float32 budget)
+{
+	b2Assert(m_stepPhase == e_endStepPhase);
+	m_stepPhase = e_beginStepPhase;
+
+	m_stepTimer.Reset();
+
+	// The profile still has the time of the last step.
+	bool lateStep = m_stepBudget > 0.0f && m_profile.step > m_stepBudget;
+	m_stepBudget = budget;
+	m_stepDegradations = 0;
+	if (budget <= 0.0f)
 	{
-		m_contactManager.FindNewContacts();
-		m_flags &= ~e_newFixture;
+		m_iterationScale = 1.0f;
+	}
+
+	// Sensor contacts don't move anything, so they are the first to wait when
+	// the last step was late.
+	m_contactManager.m_skipSensors = budget > 0.0f && lateStep;
+	if (m_contactManager.m_skipSensors)
+	{
+		m_stepDegradations |= b2_skippedSensors;
 	}
 
 	m_flags |= e_locked;
 
-	b2TimeStep step;
+	b2TimeStep& step = m_step;
 	step.dt = dt;
 	step.velocityIterations	= velocityIterations;
 	step.positionIterations = positionIterations;
+	step.solverSubSteps = m_solverSubSteps;
+	step.velocityTolerance = m_velocityTolerance;
+	step.minVelocityIterations = m_minVelocityIterations;
 	if (dt > 0.0f)
 	{
 		step.inv_dt = 1.0f / dt;
@@ -923,33 +1389,105 @@ void b2World::Step(float32 dt, int32 velocityIterations, int32 positionIteration
 	step.dtRatio = m_inv_dt0 * dt;
 
 	step.warmStarting = m_warmStarting;
-	
-	// Update contacts. This is where some contacts are destroyed.
+}
+
+void b2World::UpdatePairs()
+{
+	b2Assert(m_stepPhase == e_beginStepPhase);
+	m_stepPhase = e_updatePairsPhase;
+
+	b2Timer timer;
+
+	// If new fixtures were added, we need to find the new contacts.
+	if (m_flags & e_newFixture)
 	{
-		b2Timer timer;
-		m_contactManager.Collide();
-		m_profile.collide = timer.GetMilliseconds();
+		m_contactManager.FindNewContacts();
+		m_flags &= ~e_newFixture;
 	}
 
+	m_profile.updatePairs = timer.GetMilliseconds();
+}
+
+void b2World::Collide()
+{
+	b2Assert(m_stepPhase == e_updatePairsPhase);
+	m_stepPhase = e_collidePhase;
+
+	// Update contacts. This is where some contacts are destroyed.
+	b2Timer timer;
+	m_contactManager.Collide();
+	m_profile.collide = timer.GetMilliseconds();
+}
+
+void b2World::Solve()
+{
+	b2Assert(m_stepPhase == e_collidePhase);
+	m_stepPhase = e_solvePhase;
+
 	// Integrate velocities, solve velocity constraints, and integrate positions.
-	if (m_stepComplete && step.dt > 0.0f)
+	if (m_stepComplete && m_step.dt > 0.0f)
 	{
 		b2Timer timer;
-		Solve(step);
+		Solve(m_step);
 		m_profile.solve = timer.GetMilliseconds();
 	}
+}
+
+void b2World::SolveTOI()
+{
+	b2Assert(m_stepPhase == e_solvePhase);
+	m_stepPhase = e_solveTOIPhase;
 
-	// Handle TOI events.
-	if (m_continuousPhysics && step.dt > 0.0f)
+	// Handle TOI events. Only bullets get continuous collision when the
+	// time of the full TOI pass would exceed the budget. The estimate decays
+	// while TOI is deferred so that the full pass is tried again.
+	if (m_continuousPhysics && m_step.dt > 0.0f)
 	{
+		if (m_stepBudget > 0.0f && m_stepTimer.GetMilliseconds() + m_toiEstimate > m_stepBudget)
+		{
+			m_stepDegradations |= b2_deferredTOI;
+		}
+
 		b2Timer timer;
-		SolveTOI(step);
+		SolveTOI(m_step);
 		m_profile.solveTOI = timer.GetMilliseconds();
+
+		if (m_stepDegradations & b2_deferredTOI)
+		{
+			m_toiEstimate *= 0.9f;
+		}
+		else
+		{
+			m_toiEstimate = m_profile.solveTOI;
+		}
 	}
+}
+
+void b2World::SolveParticles()
+{
+	b2Assert(m_stepPhase == e_solveTOIPhase);
+	m_stepPhase = e_solveParticlesPhase;
 
-	if (step.dt > 0.0f)
+	// Particles collide with the bodies at their new positions.
+	if (m_step.dt > 0.0f)
 	{
-		m_inv_dt0 = step.inv_dt;
+		b2Timer timer;
+		for (b2ParticleSystem* p = m_particleSystemList; p; p = p->m_next)
+		{
+			p->Solve(m_step);
+		}
+		m_profile.solveParticles = timer.GetMilliseconds();
+	}
+}
+
+void b2World::EndStep()
+{
+	b2Assert(m_stepPhase == e_solveParticlesPhase);
+	m_stepPhase = e_endStepPhase;
+
+	if (m_step.dt > 0.0f)
+	{
+		m_inv_dt0 = m_step.inv_dt;
 	}
 
 	if (m_flags & e_clearForces)
@@ -957,9 +1495,284 @@ void b2World::Step(float32 dt, int32 velocityIterations, int32 positionIteration
 		ClearForces();
 	}
 
+	++m_stepCount;
+
+	if (m_snapshotCount > 0 || m_querySnapshots)
+	{
+		UpdateQuerySnapshots();
+	}
+
 	m_flags &= ~e_locked;
 
-	m_profile.step = stepTimer.GetMilliseconds();
+	m_profile.step = m_stepTimer.GetMilliseconds();
+
+	// Back off quickly when late and recover slowly.
+	if (m_stepBudget > 0.0f)
+	{
+		if (m_profile.step > m_stepBudget)
+		{
+			m_iterationScale = b2Max(m_iterationScale * m_stepBudget / m_profile.step, b2_minIterationScale);
+		}
+		else if (m_profile.step < 0.75f * m_stepBudget)
+		{
+			m_iterationScale = b2Min(1.25f * m_iterationScale, 1.0f);
+		}
+	}
+}
+
+void b2World::SetQuerySnapshots(bool flag)
+{
+	m_querySnapshots = flag;
+
+	if (flag == false)
+	{
+		b2AtomicStorePointer(&m_publishedSnapshot, NULL);
+	}
+}
+
+const b2QuerySnapshot* b2World::AcquireQuerySnapshot() const
+{
+	for (;;)
+	{
+		b2QuerySnapshot* snapshot = (b2QuerySnapshot*)b2AtomicLoadPointer(&m_publishedSnapshot);
+		if (snapshot == NULL)
+		{
+			return NULL;
+		}
+
+		b2AtomicAdd(&snapshot->m_readers, 1);
+
+		// The world only reuses snapshots that are not published and have no
+		// readers. If another snapshot was published meanwhile, this one may
+		// be rebuilt already.
+		if (b2AtomicLoadPointer(&m_publishedSnapshot) == snapshot)
+		{
+			return snapshot;
+		}
+
+		b2AtomicAdd(&snapshot->m_readers, -1);
+	}
+}
+
+void b2World::ReleaseQuerySnapshot(const b2QuerySnapshot* snapshot) const
+{
+	b2Assert(b2AtomicLoad(&snapshot->m_readers) > 0);
+	b2AtomicAdd(&snapshot->m_readers, -1);
+}
+
+bool b2World::RetireShape(b2Shape* shape)
+{
+	if (m_snapshotCount == 0)
+	{
+		return false;
+	}
+
+	if (m_retiredCount == m_retiredCapacity)
+	{
+		b2RetiredShape* old = m_retiredShapes;
+		m_retiredCapacity = b2Max(2 * m_retiredCapacity, 16);
+		m_retiredShapes = (b2RetiredShape*)b2Alloc(m_retiredCapacity * sizeof(b2RetiredShape));
+		if (old)
+		{
+			memcpy(m_retiredShapes, old, m_retiredCount * sizeof(b2RetiredShape));
+			b2Free(old);
+		}
+	}
+
+	m_retiredShapes[m_retiredCount].shape = shape;
+	m_retiredShapes[m_retiredCount].stepCount = m_stepCount;
+	++m_retiredCount;
+	return true;
+}
+
+int32 b2World::GetUpdateRate(b2Body* body)
+{
+	int32 rate = body->m_updateRate;
+	if (m_updateRateFilter)
+	{
+		rate = m_updateRateFilter->GetUpdateRate(body);
+		b2Assert(rate >= 1);
+	}
+
+	if (m_outsideUpdateRate > rate)
+	{
+		const b2Vec2& c = body->m_sweep.c;
+		const b2AABB& view = m_updateRateView;
+		if (c.x < view.lowerBound.x || c.y < view.lowerBound.y ||
+			view.upperBound.x < c.x || view.upperBound.y < c.y)
+		{
+			rate = m_outsideUpdateRate;
+		}
+	}
+
+	return rate;
+}
+
+void b2World::SetTransformExport(bool flag)
+{
+	if (flag == m_transformExport)
+	{
+		return;
+	}
+
+	m_transformExport = flag;
+	m_transformRecordCount = 0;
+
+	if (flag)
+	{
+		for (b2Body* b = m_bodyList; b; b = b->m_next)
+		{
+			RecordTransform(b, b->m_xf.p, b->m_sweep.a, true);
+		}
+	}
+}
+
+int32 b2World::ExportTransforms(b2BodyTransform* transforms, void** userData, int32 capacity, bool changedOnly)
+{
+	b2Assert(capacity >= m_transformRecordCount || changedOnly);
+
+	int32 count = 0;
+	for (int32 i = 0; i < m_transformRecordCount && count < capacity; ++i)
+	{
+		const b2TransformRecord* r = m_transformRecords + i;
+		if (changedOnly && r->created == false &&
+			r->transform.position == r->position0 && r->transform.angle == r->angle0)
+		{
+			continue;
+		}
+
+		transforms[count] = r->transform;
+		if (userData)
+		{
+			userData[count] = r->userData;
+		}
+		++count;
+	}
+
+	// Bodies keep the index of their old record, see RecordTransform.
+	m_transformRecordCount = 0;
+	return count;
+}
+
+// A body owns the record at m_transformRecord only if the record points back
+// to it, so clearing the records doesn't have to touch the bodies.
+void b2World::RecordTransform(b2Body* body, const b2Vec2& position0, float32 angle0, bool created)
+{
+	int32 index = body->m_transformRecord;
+	if (index < 0 || m_transformRecordCount <= index || m_transformRecords[index].body != body)
+	{
+		if (m_transformRecordCount == m_transformRecordCapacity)
+		{
+			b2TransformRecord* old = m_transformRecords;
+			m_transformRecordCapacity = b2Max(2 * m_transformRecordCapacity, 64);
+			m_transformRecords = (b2TransformRecord*)b2Alloc(m_transformRecordCapacity * sizeof(b2TransformRecord));
+			if (old)
+			{
+				memcpy(m_transformRecords, old, m_transformRecordCount * sizeof(b2TransformRecord));
+				b2Free(old);
+			}
+		}
+
+		index = m_transformRecordCount++;
+		body->m_transformRecord = index;
+
+		b2TransformRecord* r = m_transformRecords + index;
+		r->body = body;
+		r->position0 = position0;
+		r->angle0 = angle0;
+		r->created = created;
+	}
+
+	b2TransformRecord* r = m_transformRecords + index;
+	r->transform.position = body->m_xf.p;
+	r->transform.angle = body->m_sweep.a;
+	r->userData = body->m_userData;
+}
+
+void b2World::RemoveTransformRecord(b2Body* body)
+{
+	int32 index = body->m_transformRecord;
+	if (index < 0 || m_transformRecordCount <= index || m_transformRecords[index].body != body)
+	{
+		return;
+	}
+
+	--m_transformRecordCount;
+	if (index < m_transformRecordCount)
+	{
+		m_transformRecords[index] = m_transformRecords[m_transformRecordCount];
+		m_transformRecords[index].body->m_transformRecord = index;
+	}
+	body->m_transformRecord = -1;
+}
+
+// Build the snapshot of this step into a snapshot that nobody uses, then
+// free the retired shapes that no snapshot in use can reach.
+void b2World::UpdateQuerySnapshots()
+{
+	b2QuerySnapshot* published = (b2QuerySnapshot*)b2AtomicLoadPointer(&m_publishedSnapshot);
+
+	if (m_querySnapshots)
+	{
+		b2QuerySnapshot* snapshot = NULL;
+		for (int32 i = 0; i < m_snapshotCount; ++i)
+		{
+			if (m_snapshots[i] != published && b2AtomicLoad(&m_snapshots[i]->m_readers) == 0)
+			{
+				snapshot = m_snapshots[i];
+				break;
+			}
+		}
+
+		if (snapshot == NULL)
+		{
+			if (m_snapshotCount == m_snapshotCapacity)
+			{
+				b2QuerySnapshot** old = m_snapshots;
+				m_snapshotCapacity = b2Max(2 * m_snapshotCapacity, 2);
+				m_snapshots = (b2QuerySnapshot**)b2Alloc(m_snapshotCapacity * sizeof(b2QuerySnapshot*));
+				if (old)
+				{
+					memcpy(m_snapshots, old, m_snapshotCount * sizeof(b2QuerySnapshot*));
+					b2Free(old);
+				}
+			}
+
+			void* mem = b2Alloc(sizeof(b2QuerySnapshot));
+			snapshot = new (mem) b2QuerySnapshot;
+			m_snapshots[m_snapshotCount] = snapshot;
+			++m_snapshotCount;
+		}
+
+		snapshot->Build(&m_contactManager.m_broadPhase, m_stepCount);
+		b2AtomicStorePointer(&m_publishedSnapshot, snapshot);
+		published = snapshot;
+	}
+
+	int32 oldestStep = m_stepCount + 1;
+	for (int32 i = 0; i < m_snapshotCount; ++i)
+	{
+		b2QuerySnapshot* snapshot = m_snapshots[i];
+		if (snapshot == published || b2AtomicLoad(&snapshot->m_readers) > 0)
+		{
+			oldestStep = b2Min(oldestStep, snapshot->m_stepCount);
+		}
+	}
+
+	int32 retiredCount = 0;
+	for (int32 i = 0; i < m_retiredCount; ++i)
+	{
+		if (m_retiredShapes[i].stepCount < oldestStep)
+		{
+			b2Fixture::DestroyShape(&m_blockAllocator, m_retiredShapes[i].shape);
+		}
+		else
+		{
+			m_retiredShapes[retiredCount] = m_retiredShapes[i];
+			++retiredCount;
+		}
+	}
+	m_retiredCount = retiredCount;
 }
 
 void b2World::ClearForces()
@@ -971,61 +1784,54 @@ void b2World::ClearForces()
 	}
 }
 
+// Forwards the hits of the templated queries to the virtual callbacks.
 struct b2WorldQueryWrapper
 {
-	bool QueryCallback(int32 proxyId)
+	bool operator()(b2Fixture* fixture)
 	{
-		b2FixtureProxy* proxy = (b2FixtureProxy*)broadPhase->GetUserData(proxyId);
-		return callback->ReportFixture(proxy->fixture);
+		return callback->ReportFixture(fixture);
 	}
 
-	const b2BroadPhase* broadPhase;
 	b2QueryCallback* callback;
 };
 
 void b2World::QueryAABB(b2QueryCallback* callback, const b2AABB& aabb) const
 {
 	b2WorldQueryWrapper wrapper;
-	wrapper.broadPhase = &m_contactManager.m_broadPhase;
 	wrapper.callback = callback;
-	m_contactManager.m_broadPhase.Query(&wrapper, aabb);
+	QueryAABB(aabb, wrapper);
+}
+
+void b2World::QueryAABB(b2QueryCallback* callback, const b2AABB& aabb, const b2Filter& filter) const
+{
+	b2WorldQueryWrapper wrapper;
+	wrapper.callback = callback;
+	QueryAABB(aabb, filter, wrapper);
 }
 
 struct b2WorldRayCastWrapper
 {
-	float32 RayCastCallback(const b2RayCastInput& input, int32 proxyId)
+	float32 operator()(b2Fixture* fixture, const b2Vec2& point, const b2Vec2& normal, float32 fraction)
 	{
-		void* userData = broadPhase->GetUserData(proxyId);
-		b2FixtureProxy* proxy = (b2FixtureProxy*)userData;
-		b2Fixture* fixture = proxy->fixture;
-		int32 index = proxy->childIndex;
-		b2RayCastOutput output;
-		bool hit = fixture->RayCast(&output, input, index);
-
-		if (hit)
-		{
-			float32 fraction = output.fraction;
-			b2Vec2 point = (1.0f - fraction) * input.p1 + fraction * input.p2;
-			return callback->ReportFixture(fixture, point, output.normal, fraction);
-		}
-
-		return input.maxFraction;
+		return callback->ReportFixture(fixture, point, normal, fraction);
 	}
 
-	const b2BroadPhase* broadPhase;
 	b2RayCastCallback* callback;
 };
 
 void b2World::RayCast(b2RayCastCallback* callback, const b2Vec2& point1, const b2Vec2& point2) const
 {
 	b2WorldRayCastWrapper wrapper;
-	wrapper.broadPhase = &m_contactManager.m_broadPhase;
 	wrapper.callback = callback;
-	b2RayCastInput input;
-	input.maxFraction = 1.0f;
-	input.p1 = point1;
-	input.p2 = point2;
-	m_contactManager.m_broadPhase.RayCast(&wrapper, input);
+	RayCast(point1, point2, wrapper);
+}
+
+void b2World::RayCast(b2RayCastCallback* callback, const b2Vec2& point1, const b2Vec2& point2,
+					  const b2Filter& filter) const
+{
+	b2WorldRayCastWrapper wrapper;
+	wrapper.callback = callback;
+	RayCast(point1, point2, filter, wrapper);
 }
 
 void b2World::DrawShape(b2Fixture* fixture, const b2Transform& xf, const b2Color& color)
@@ -1085,6 +1891,58 @@ void b2World::DrawShape(b2Fixture* fixture, const b2Transform& xf, const b2Color
 			m_debugDraw->DrawSolidPolygon(vertices, vertexCount, color);
 		}
 		break;
+
+	case b2Shape::e_compound:
+		{
+			b2CompoundShape* compound = (b2CompoundShape*)fixture->GetShape();
+			b2Vec2 vertices[b2_maxPolygonVertices];
+
+			for (int32 i = 0; i < compound->m_childCount; ++i)
+			{
+				const b2CompoundChild* child = compound->m_children + i;
+				for (int32 j = 0; j < child->count; ++j)
+				{
+					vertices[j] = b2Mul(xf, compound->m_vertices[child->firstVertex + j]);
+				}
+
+				m_debugDraw->DrawSolidPolygon(vertices, child->count, color);
+			}
+		}
+		break;
+
+	case b2Shape::e_heightField:
+		{
+			b2HeightFieldShape* heightField = (b2HeightFieldShape*)fixture->GetShape();
+			int32 count = heightField->m_count;
+
+			b2Vec2 v1 = b2Mul(xf, heightField->GetVertex(0));
+			for (int32 i = 1; i < count; ++i)
+			{
+				b2Vec2 v2 = b2Mul(xf, heightField->GetVertex(i));
+				m_debugDraw->DrawSegment(v1, v2, color);
+				v1 = v2;
+			}
+		}
+		break;
+
+	case b2Shape::e_capsule:
+		{
+			b2CapsuleShape* capsule = (b2CapsuleShape*)fixture->GetShape();
+
+			b2Vec2 v1 = b2Mul(xf, capsule->m_vertex1);
+			b2Vec2 v2 = b2Mul(xf, capsule->m_vertex2);
+			float32 radius = capsule->m_radius;
+
+			b2Vec2 axis = v2 - v1;
+			axis.Normalize();
+			b2Vec2 side = radius * b2Cross(1.0f, axis);
+
+			m_debugDraw->DrawSolidCircle(v1, radius, axis, color);
+			m_debugDraw->DrawSolidCircle(v2, radius, axis, color);
+			m_debugDraw->DrawSegment(v1 + side, v2 + side, color);
+			m_debugDraw->DrawSegment(v1 - side, v2 - side, color);
+		}
+		break;
             
     default:
         break;
@@ -1170,6 +2028,11 @@ void b2World::DrawDebugData()
 				}
 			}
 		}
+
+		for (b2ParticleSystem* p = m_particleSystemList; p; p = p->m_next)
+		{
+			p->Draw(m_debugDraw);
+		}
 	}
 
 	if (flags & b2Draw::e_jointBit)
@@ -1183,7 +2046,7 @@ void b2World::DrawDebugData()
 	if (flags & b2Draw::e_pairBit)
 	{
 		b2Color color(0.3f, 0.9f, 0.9f);
-		for (b2Contact* c = m_contactManager.m_contactList; c; c = c->GetNext())
+		for (b2Contact* c = GetContactList(); c; c = c->GetNext())
 		{
 			//b2Fixture* fixtureA = c->GetFixtureA();
 			//b2Fixture* fixtureB = c->GetFixtureB();
@@ -1236,6 +2099,21 @@ void b2World::DrawDebugData()
 	}
 }
 
+b2Contact* b2World::GetContactList()
+{
+	return m_contactManager.m_contacts[0].contact;
+}
+
+const b2Contact* b2World::GetContactList() const
+{
+	return m_contactManager.m_contacts[0].contact;
+}
+
+b2Contact* b2World::GetContact(const b2ContactHandle& handle)
+{
+	return m_contactManager.GetContact(handle);
+}
+
 int32 b2World::GetProxyCount() const
 {
 	return m_contactManager.m_broadPhase.GetProxyCount();
@@ -1266,9 +2144,16 @@ void b2World::ShiftOrigin(const b2Vec2& newOrigin)
 
 	for (b2Body* b = m_bodyList; b; b = b->m_next)
 	{
+		b2Vec2 position0 = b->m_xf.p;
 		b->m_xf.p -= newOrigin;
 		b->m_sweep.c0 -= newOrigin;
 		b->m_sweep.c -= newOrigin;
+		b->m_interpolationCenter -= newOrigin;
+
+		if (m_transformExport)
+		{
+			RecordTransform(b, position0, b->m_sweep.a, false);
+		}
 	}
 
 	for (b2Joint* j = m_jointList; j; j = j->m_next)
@@ -1276,6 +2161,11 @@ void b2World::ShiftOrigin(const b2Vec2& newOrigin)
 		j->ShiftOrigin(newOrigin);
 	}
 
+	for (b2ParticleSystem* p = m_particleSystemList; p; p = p->m_next)
+	{
+		p->ShiftOrigin(newOrigin);
+	}
+
 	m_contactManager.m_broadPhase.ShiftOrigin(newOrigin);
 }
 
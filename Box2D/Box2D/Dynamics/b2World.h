@@ -22,7 +22,10 @@
 #include <Box2D/Common/b2Math.h>
 #include <Box2D/Common/b2BlockAllocator.h>
 #include <Box2D/Common/b2StackAllocator.h>
+#include <Box2D/Common/b2Timer.h>
 #include <Box2D/Dynamics/b2ContactManager.h>
+#include <Box2D/Dynamics/b2Fixture.h>
+#include <Box2D/Dynamics/b2IslandManager.h>
 #include <Box2D/Dynamics/b2WorldCallbacks.h>
 #include <Box2D/Dynamics/b2TimeStep.h>
 
@@ -30,10 +33,27 @@ struct b2AABB;
 struct b2BodyDef;
 struct b2Color;
 struct b2JointDef;
+struct b2ContactHandle;
+struct b2ParticleSystemDef;
 class b2Body;
+class b2BodyPrefab;
 class b2Draw;
 class b2Fixture;
 class b2Joint;
+class b2ParticleSystem;
+class b2QuerySnapshot;
+struct b2RetiredShape;
+struct b2TransformRecord;
+
+/// The transform of a body written by b2World::ExportTransforms.
+struct b2BodyTransform
+{
+	/// The position of the body origin.
+	b2Vec2 position;
+
+	/// The body angle in radians.
+	float32 angle;
+};
 
 /// The world class manages all physics entities, dynamic simulation,
 /// and asynchronous queries. The world also contains efficient memory
@@ -61,6 +81,21 @@ public:
 	/// remain in scope.
 	void SetContactListener(b2ContactListener* listener);
 
+	/// Register an update rate filter to choose how often the awake bodies are
+	/// updated, instead of the rate set on the bodies. The filter is owned by
+	/// you and must remain in scope.
+	void SetUpdateRateFilter(b2UpdateRateFilter* filter);
+
+	/// Update the bodies whose center is outside of the view at most every
+	/// outsideRate steps, for example the bodies that are off screen. An outside
+	/// rate of 1 disables this.
+	void SetUpdateRateView(const b2AABB& view, int32 outsideRate);
+
+	/// Register a task executor to solve large islands on several threads. The
+	/// executor is owned by you and must remain in scope. Set a parallel island
+	/// threshold as well, islands are not colored by default.
+	void SetTaskExecutor(b2TaskExecutor* executor);
+
 	/// Register a routine for debug drawing. The debug draw functions are called
 	/// inside with b2World::DrawDebugData method. The debug draw object is owned
 	/// by you and must remain in scope.
@@ -71,6 +106,13 @@ public:
 	/// @warning This function is locked during callbacks.
 	b2Body* CreateBody(const b2BodyDef* def);
 
+	/// Create many bodies from a prefab, one for each transform. This is much
+	/// faster than creating the bodies and fixtures one by one: the mass isn't
+	/// computed again and the proxies are inserted into the broad-phase together.
+	/// @param bodies receives the new bodies, may be NULL.
+	/// @warning This function is locked during callbacks.
+	void CreateBodies(const b2BodyPrefab* prefab, const b2Transform* transforms, int32 count, b2Body** bodies);
+
 	/// Destroy a rigid body given a definition. No reference to the definition
 	/// is retained. This function is locked during callbacks.
 	/// @warning This automatically deletes all associated shapes and joints.
@@ -86,6 +128,15 @@ public:
 	/// @warning This function is locked during callbacks.
 	void DestroyJoint(b2Joint* joint);
 
+	/// Create a particle system given a definition. No reference to the definition
+	/// is retained.
+	/// @warning This function is locked during callbacks.
+	b2ParticleSystem* CreateParticleSystem(const b2ParticleSystemDef* def);
+
+	/// Destroy a particle system and all of its particles.
+	/// @warning This function is locked during callbacks.
+	void DestroyParticleSystem(b2ParticleSystem* system);
+
 	/// Take a time step. This performs collision detection, integration,
 	/// and constraint solution.
 	/// @param timeStep the amount of time to simulate, this should not vary.
@@ -95,6 +146,48 @@ public:
 				int32 velocityIterations,
 				int32 positionIterations);
 
+	/// Take a time step that tries to stay within a wall-clock budget. A late step
+	/// degrades instead of making the next frame longer: islands are solved with
+	/// fewer iterations, non-bullet bodies skip continuous collision and sensor
+	/// contacts wait for the next step. The iteration counts recover gradually
+	/// once the steps fit the budget again. See GetStepDegradations.
+	/// @param budget the wall-clock time for the step in milliseconds, zero for no budget.
+	void Step(	float32 timeStep,
+				int32 velocityIterations,
+				int32 positionIterations,
+				float32 budget);
+
+	/// Get the b2StepDegradation flags of the last step.
+	uint32 GetStepDegradations() const { return m_stepDegradations; }
+
+	/// Take a time step in phases instead of calling Step, for example to overlap
+	/// rendering with physics. Call BeginStep, UpdatePairs, Collide, Solve,
+	/// SolveTOI, SolveParticles and EndStep in this order, this is exactly what
+	/// Step does. The world is locked from BeginStep to EndStep. UpdatePairs and
+	/// Collide don't move the bodies, so other threads may read the body
+	/// transforms until Solve is called. Each phase sets its time in the profile,
+	/// the step time runs from BeginStep to EndStep.
+	void BeginStep(float32 timeStep, int32 velocityIterations, int32 positionIterations);
+	void BeginStep(float32 timeStep, int32 velocityIterations, int32 positionIterations, float32 budget);
+
+	/// Find the contacts of the fixtures added since the last step.
+	void UpdatePairs();
+
+	/// Update the contacts. This is where some contacts are destroyed.
+	void Collide();
+
+	/// Integrate velocities, solve velocity constraints, and integrate positions.
+	void Solve();
+
+	/// Handle the time of impact events of continuous physics.
+	void SolveTOI();
+
+	/// Move the particles of the particle systems.
+	void SolveParticles();
+
+	/// Clear the forces, take the query snapshot and unlock the world.
+	void EndStep();
+
 	/// Manually clear the force buffer on all bodies. By default, forces are cleared automatically
 	/// after each call to Step. The default behavior is modified by calling SetAutoClearForces.
 	/// The purpose of this function is to support sub-stepping. Sub-stepping is often used to maintain
@@ -113,6 +206,12 @@ public:
 	/// @param aabb the query box.
 	void QueryAABB(b2QueryCallback* callback, const b2AABB& aabb) const;
 
+	/// Query the world for the fixtures that potentially overlap the provided
+	/// AABB and would collide with a fixture that has the given filter. The
+	/// filter is tested in the broad-phase, so fixtures of other categories
+	/// cost little.
+	void QueryAABB(b2QueryCallback* callback, const b2AABB& aabb, const b2Filter& filter) const;
+
 	/// Ray-cast the world for all fixtures in the path of the ray. Your callback
 	/// controls whether you get the closest point, any point, or n-points.
 	/// The ray-cast ignores shapes that contain the starting point.
@@ -121,6 +220,34 @@ public:
 	/// @param point2 the ray ending point
 	void RayCast(b2RayCastCallback* callback, const b2Vec2& point1, const b2Vec2& point2) const;
 
+	/// Ray-cast the world for the fixtures in the path of the ray that would
+	/// collide with a fixture that has the given filter.
+	void RayCast(b2RayCastCallback* callback, const b2Vec2& point1, const b2Vec2& point2,
+				 const b2Filter& filter) const;
+
+	/// Query the world with a functor or lambda instead of a b2QueryCallback.
+	/// The functor is called as bool(b2Fixture* fixture) like
+	/// b2QueryCallback::ReportFixture and is inlined into the tree traversal,
+	/// so there are no virtual calls. The functor is passed by value.
+	template <typename T>
+	void QueryAABB(const b2AABB& aabb, T callback) const;
+
+	/// Query the world with a functor for the fixtures that would collide
+	/// with a fixture that has the given filter.
+	template <typename T>
+	void QueryAABB(const b2AABB& aabb, const b2Filter& filter, T callback) const;
+
+	/// Ray-cast the world with a functor or lambda instead of a b2RayCastCallback.
+	/// The functor is called as float32(b2Fixture* fixture, const b2Vec2& point,
+	/// const b2Vec2& normal, float32 fraction) like b2RayCastCallback::ReportFixture.
+	template <typename T>
+	void RayCast(const b2Vec2& point1, const b2Vec2& point2, T callback) const;
+
+	/// Ray-cast the world with a functor for the fixtures that would collide
+	/// with a fixture that has the given filter.
+	template <typename T>
+	void RayCast(const b2Vec2& point1, const b2Vec2& point2, const b2Filter& filter, T callback) const;
+
 	/// Get the world body list. With the returned body, use b2Body::GetNext to get
 	/// the next body in the world list. A NULL body indicates the end of the list.
 	/// @return the head of the world body list.
@@ -133,6 +260,12 @@ public:
 	b2Joint* GetJointList();
 	const b2Joint* GetJointList() const;
 
+	/// Get the world particle system list. With the returned system, use
+	/// b2ParticleSystem::GetNext to get the next system in the world list.
+	/// @return the head of the world particle system list.
+	b2ParticleSystem* GetParticleSystemList();
+	const b2ParticleSystem* GetParticleSystemList() const;
+
 	/// Get the world contact list. With the returned contact, use b2Contact::GetNext to get
 	/// the next contact in the world list. A NULL contact indicates the end of the list.
 	/// @return the head of the world contact list.
@@ -141,6 +274,10 @@ public:
 	b2Contact* GetContactList();
 	const b2Contact* GetContactList() const;
 
+	/// Get a contact from a handle.
+	/// @return the contact or NULL if the contact has been destroyed.
+	b2Contact* GetContact(const b2ContactHandle& handle);
+
 	/// Enable/disable sleep.
 	void SetAllowSleeping(bool flag);
 	bool GetAllowSleeping() const { return m_allowSleep; }
@@ -157,6 +294,80 @@ public:
 	void SetSubStepping(bool flag) { m_subStepping = flag; }
 	bool GetSubStepping() const { return m_subStepping; }
 
+	/// Use the soft step solver with this many sub-steps per time step. Each sub-step
+	/// solves the constraints once with soft contacts and then relaxes them, so the
+	/// iteration counts given to Step are not used. This is often more stable than
+	/// raising the iteration counts. Zero selects the iterative solver.
+	void SetSolverSubSteps(int32 count) { m_solverSubSteps = count; }
+	int32 GetSolverSubSteps() const { return m_solverSubSteps; }
+
+	/// Stop the velocity iterations of an island once an iteration changes the
+	/// momentum of each body by less than this impulse. The velocity iterations
+	/// given to Step are the upper bound. See b2Profile for the average number of
+	/// iterations. Zero always runs all velocity iterations.
+	void SetVelocityTolerance(float32 impulse) { m_velocityTolerance = impulse; }
+	float32 GetVelocityTolerance() const { return m_velocityTolerance; }
+
+	/// The lower bound of the velocity iterations when using a tolerance.
+	void SetMinVelocityIterations(int32 count) { m_minVelocityIterations = count; }
+	int32 GetMinVelocityIterations() const { return m_minVelocityIterations; }
+
+	/// Enable/disable the impulse cache. The cache keeps the impulses of contact
+	/// points for a few steps after they stop touching or their contact is
+	/// destroyed, so that points that come back are warm started. This is off by
+	/// default. It helps piles come to rest when a velocity tolerance is set, with
+	/// all velocity iterations it makes no difference.
+	void SetImpulseCaching(bool flag) { m_contactManager.m_impulseCaching = flag; }
+	bool GetImpulseCaching() const { return m_contactManager.m_impulseCaching; }
+
+	/// Islands with at least this many bodies have their constraints partitioned
+	/// by graph coloring so that each color can be solved in parallel by the task
+	/// executor. This changes the order in which constraints are solved, but the
+	/// result doesn't depend on the executor or its thread count. Zero, the
+	/// default, disables coloring. The soft step solver doesn't use coloring.
+	void SetParallelIslandThreshold(int32 bodyCount) { m_parallelIslandThreshold = bodyCount; }
+	int32 GetParallelIslandThreshold() const { return m_parallelIslandThreshold; }
+
+	/// Take a b2QuerySnapshot of the broad-phase and the fixture transforms at
+	/// the end of every step, so that other threads can query the world while
+	/// it steps. The shapes of destroyed fixtures are kept until no snapshot
+	/// uses them. Off by default.
+	void SetQuerySnapshots(bool flag);
+	bool GetQuerySnapshots() const { return m_querySnapshots; }
+
+	/// Get the snapshot of the last step and keep the world from reusing it.
+	/// This may be called from any thread, also during Step. Give the snapshot
+	/// back with ReleaseQuerySnapshot soon, the world allocates another snapshot
+	/// while all of them are in use.
+	/// @return the snapshot, or NULL if there is none.
+	const b2QuerySnapshot* AcquireQuerySnapshot() const;
+
+	/// Give back a snapshot. This may be called from any thread.
+	void ReleaseQuerySnapshot(const b2QuerySnapshot* snapshot) const;
+
+	/// Get the number of steps taken.
+	int32 GetStepCount() const { return m_stepCount; }
+
+	/// Record the transforms of the bodies that are awake or moved while the
+	/// world steps, so that ExportTransforms doesn't have to walk the body list.
+	/// The first export after enabling this writes all bodies. Off by default.
+	void SetTransformExport(bool flag);
+	bool GetTransformExport() const { return m_transformExport; }
+
+	/// Write the transforms of the bodies that were awake, moved or created since
+	/// the last export into packed arrays, for the renderer. This forgets the
+	/// written bodies, so each export only has the changes since the one before.
+	/// @param transforms receives the body transforms.
+	/// @param userData receives the body user data, may be NULL. This is the user
+	/// data the body had when its transform changed.
+	/// @param capacity the length of the arrays, see GetExportCount.
+	/// @param changedOnly skip the bodies that were awake but didn't move.
+	/// @return the number of bodies written.
+	int32 ExportTransforms(b2BodyTransform* transforms, void** userData, int32 capacity, bool changedOnly);
+
+	/// Get the number of bodies the next ExportTransforms may write.
+	int32 GetExportCount() const { return m_transformRecordCount; }
+
 	/// Get the number of broad-phase proxies.
 	int32 GetProxyCount() const;
 
@@ -219,14 +430,41 @@ private:
 		e_clearForces	= 0x0004
 	};
 
+	// m_stepPhase, the last phase of the step that was run.
+	enum
+	{
+		e_beginStepPhase,
+		e_updatePairsPhase,
+		e_collidePhase,
+		e_solvePhase,
+		e_solveTOIPhase,
+		e_solveParticlesPhase,
+		e_endStepPhase
+	};
+
 	friend class b2Body;
 	friend class b2Fixture;
 	friend class b2ContactManager;
+	friend class b2Contact;
 	friend class b2Controller;
+	friend class b2ParticleSystem;
 
 	void Solve(const b2TimeStep& step);
 	void SolveTOI(const b2TimeStep& step);
 
+	void UpdateQuerySnapshots();
+
+	int32 GetUpdateRate(b2Body* body);
+
+	// Keep the shape of a destroyed fixture for the query snapshots.
+	// Returns false if no snapshot can use it.
+	bool RetireShape(b2Shape* shape);
+
+	// Record the transform of a body for ExportTransforms. The position and
+	// angle are those of the body before the change.
+	void RecordTransform(b2Body* body, const b2Vec2& position0, float32 angle0, bool created);
+	void RemoveTransformRecord(b2Body* body);
+
 	void DrawJoint(b2Joint* joint);
 	void DrawShape(b2Fixture* shape, const b2Transform& xf, const b2Color& color);
 
@@ -236,9 +474,11 @@ private:
 	int32 m_flags;
 
 	b2ContactManager m_contactManager;
+	b2IslandManager m_islandManager;
 
 	b2Body* m_bodyList;
 	b2Joint* m_jointList;
+	b2ParticleSystem* m_particleSystemList;
 
 	int32 m_bodyCount;
 	int32 m_jointCount;
@@ -248,6 +488,8 @@ private:
 
 	b2DestructionListener* m_destructionListener;
 	b2Draw* m_debugDraw;
+	b2TaskExecutor* m_taskExecutor;
+	int32 m_parallelIslandThreshold;
 
 	// This is used to compute the time step ratio to
 	// support a variable time step.
@@ -257,9 +499,51 @@ private:
 	bool m_warmStarting;
 	bool m_continuousPhysics;
 	bool m_subStepping;
+	int32 m_solverSubSteps;
+	float32 m_velocityTolerance;
+	int32 m_minVelocityIterations;
 
 	bool m_stepComplete;
 
+	// The step taken in phases.
+	b2TimeStep m_step;
+	b2Timer m_stepTimer;
+	int32 m_stepPhase;
+
+	// The time budget of the step. The iteration scale shrinks when steps run
+	// over the budget and grows back when they fit.
+	float32 m_stepBudget;
+	float32 m_iterationScale;
+	float32 m_toiEstimate;
+	uint32 m_stepDegradations;
+
+	// Multi-rate updates. m_multiRate is set once a body may be updated less
+	// often than every step.
+	bool m_multiRate;
+	b2UpdateRateFilter* m_updateRateFilter;
+	b2AABB m_updateRateView;
+	int32 m_outsideUpdateRate;
+
+	int32 m_stepCount;
+
+	// The query snapshots. Snapshots are only freed with the world, since
+	// other threads may still hold a pointer to them.
+	bool m_querySnapshots;
+	b2QuerySnapshot** m_snapshots;
+	int32 m_snapshotCount;
+	int32 m_snapshotCapacity;
+	void* volatile m_publishedSnapshot;
+
+	b2RetiredShape* m_retiredShapes;
+	int32 m_retiredCount;
+	int32 m_retiredCapacity;
+
+	// The bodies to export, a body indexes its record with m_transformRecord.
+	bool m_transformExport;
+	b2TransformRecord* m_transformRecords;
+	int32 m_transformRecordCount;
+	int32 m_transformRecordCapacity;
+
 	b2Profile m_profile;
 };
 
@@ -283,14 +567,14 @@ inline const b2Joint* b2World::GetJointList() const
 	return m_jointList;
 }
 
-inline b2Contact* b2World::GetContactList()
+inline b2ParticleSystem* b2World::GetParticleSystemList()
 {
-	return m_contactManager.m_contactList;
+	return m_particleSystemList;
 }
 
-inline const b2Contact* b2World::GetContactList() const
+inline const b2ParticleSystem* b2World::GetParticleSystemList() const
 {
-	return m_contactManager.m_contactList;
+	return m_particleSystemList;
 }
 
 inline int32 b2World::GetBodyCount() const
@@ -351,4 +635,145 @@ inline const b2Profile& b2World::GetProfile() const
 	return m_profile;
 }
 
+/// Calls a query functor for each proxy found in the tree.
+template <typename T>
+struct b2WorldQueryFunctor
+{
+	bool QueryCallback(int32 proxyId)
+	{
+		b2FixtureProxy* proxy = (b2FixtureProxy*)broadPhase->GetUserData(proxyId);
+		return (*callback)(proxy->fixture);
+	}
+
+	const b2BroadPhase* broadPhase;
+	T* callback;
+};
+
+/// Ray-casts the children that a shape with a child query finds and calls a
+/// ray-cast functor for each hit.
+template <typename T>
+struct b2WorldChildRayCastFunctor : public b2ChildRayCastCallback
+{
+	float32 ReportChild(const b2RayCastInput& input, int32 childIndex)
+	{
+		b2RayCastOutput output;
+		if (fixture->GetShape()->RayCast(&output, input, identity, childIndex) == false)
+		{
+			return input.maxFraction;
+		}
+
+		float32 fraction = output.fraction;
+		b2Vec2 point = (1.0f - fraction) * p1 + fraction * p2;
+		b2Vec2 normal = b2Mul(fixture->GetBody()->GetTransform().q, output.normal);
+		float32 value = (*callback)(fixture, point, normal, fraction);
+		if (value < 0.0f)
+		{
+			// The client has filtered this fixture.
+			return input.maxFraction;
+		}
+
+		maxFraction = value;
+		return value;
+	}
+
+	b2Fixture* fixture;
+	b2Transform identity;
+	b2Vec2 p1, p2;
+	float32 maxFraction;
+	T* callback;
+};
+
+/// Ray-casts the fixture of each proxy found in the tree and calls a ray-cast
+/// functor for the hits.
+template <typename T>
+struct b2WorldRayCastFunctor
+{
+	float32 RayCastCallback(const b2RayCastInput& input, int32 proxyId)
+	{
+		b2FixtureProxy* proxy = (b2FixtureProxy*)broadPhase->GetUserData(proxyId);
+		b2Fixture* fixture = proxy->fixture;
+
+		// A shape with a child query finds the children in its frame. Every child
+		// that is hit is reported.
+		const b2Shape* shape = fixture->GetShape();
+		if (shape->HasChildQuery())
+		{
+			const b2Transform& xf = fixture->GetBody()->GetTransform();
+			b2RayCastInput localInput;
+			localInput.p1 = b2MulT(xf, input.p1);
+			localInput.p2 = b2MulT(xf, input.p2);
+			localInput.maxFraction = input.maxFraction;
+
+			b2WorldChildRayCastFunctor<T> children;
+			children.fixture = fixture;
+			children.identity.SetIdentity();
+			children.p1 = input.p1;
+			children.p2 = input.p2;
+			children.maxFraction = input.maxFraction;
+			children.callback = callback;
+			shape->RayCastChildren(&children, localInput);
+			return children.maxFraction;
+		}
+
+		b2RayCastOutput output;
+		bool hit = fixture->RayCast(&output, input, proxy->childIndex);
+
+		if (hit)
+		{
+			float32 fraction = output.fraction;
+			b2Vec2 point = (1.0f - fraction) * input.p1 + fraction * input.p2;
+			return (*callback)(fixture, point, output.normal, fraction);
+		}
+
+		return input.maxFraction;
+	}
+
+	const b2BroadPhase* broadPhase;
+	T* callback;
+};
+
+template <typename T>
+inline void b2World::QueryAABB(const b2AABB& aabb, T callback) const
+{
+	b2WorldQueryFunctor<T> functor;
+	functor.broadPhase = &m_contactManager.m_broadPhase;
+	functor.callback = &callback;
+	m_contactManager.m_broadPhase.Query(&functor, aabb);
+}
+
+template <typename T>
+inline void b2World::QueryAABB(const b2AABB& aabb, const b2Filter& filter, T callback) const
+{
+	b2WorldQueryFunctor<T> functor;
+	functor.broadPhase = &m_contactManager.m_broadPhase;
+	functor.callback = &callback;
+	m_contactManager.m_broadPhase.Query(&functor, aabb, filter);
+}
+
+template <typename T>
+inline void b2World::RayCast(const b2Vec2& point1, const b2Vec2& point2, T callback) const
+{
+	b2WorldRayCastFunctor<T> functor;
+	functor.broadPhase = &m_contactManager.m_broadPhase;
+	functor.callback = &callback;
+	b2RayCastInput input;
+	input.maxFraction = 1.0f;
+	input.p1 = point1;
+	input.p2 = point2;
+	m_contactManager.m_broadPhase.RayCast(&functor, input);
+}
+
+template <typename T>
+inline void b2World::RayCast(const b2Vec2& point1, const b2Vec2& point2, const b2Filter& filter, T callback) const
+{
+	b2WorldRayCastFunctor<T> functor;
+	functor.broadPhase = &m_contactManager.m_broadPhase;
+	functor.callback = &callback;
+	b2RayCastInput input;
+	input.maxFraction = 1.0f;
+	input.p1 = point1;
+	input.p2 = point2;
+	m_contactManager.m_broadPhase.RayCast(&functor, input, filter);
+}
+
 #endif
@@ -59,6 +59,18 @@ public:
 	virtual bool ShouldCollide(b2Fixture* fixtureA, b2Fixture* fixtureB);
 };
 
+/// Implement this class to choose how often the awake bodies are updated, for
+/// example by how important they are to the game. See b2Body::SetUpdateRate.
+class b2UpdateRateFilter
+{
+public:
+	virtual ~b2UpdateRateFilter() {}
+
+	/// Return the number of steps between the updates of the body, at least 1.
+	/// This is called every step for the awake bodies.
+	virtual int32 GetUpdateRate(b2Body* body);
+};
+
 /// Contact impulses for reporting. Impulses are used instead of forces because
 /// sub-step forces may approach infinity for rigid body collisions. These
 /// match up one-to-one with the contact points in b2Manifold.
@@ -118,6 +130,34 @@ public:
 	}
 };
 
+/// A unit of work that can be split into ranges. See b2TaskExecutor.
+class b2Task
+{
+public:
+	virtual ~b2Task() {}
+
+	/// Process the items in [begin, end). This may be called concurrently
+	/// on disjoint ranges.
+	/// @param workerIndex the index of the calling thread, less than
+	/// b2TaskExecutor::GetWorkerCount.
+	virtual void Execute(int32 begin, int32 end, int32 workerIndex) = 0;
+};
+
+/// Implement this class to let the world run work on your threads.
+/// See b2World::SetTaskExecutor
+class b2TaskExecutor
+{
+public:
+	virtual ~b2TaskExecutor() {}
+
+	/// The number of threads that may execute tasks, including the calling thread.
+	virtual int32 GetWorkerCount() const = 0;
+
+	/// Execute the task on ranges that cover [0, count) exactly once. This
+	/// must not return before every range is done.
+	virtual void ParallelFor(b2Task* task, int32 count) = 0;
+};
+
 /// Callback class for AABB queries.
 /// See b2World::Query
 class b2QueryCallback
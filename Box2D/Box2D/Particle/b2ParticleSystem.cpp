@@ -0,0 +1,1162 @@
+/*
+* Copyright (c) 2006-2009 Erin Catto http://www.box2d.org
+*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include <Box2D/Particle/b2ParticleSystem.h>
+#include <Box2D/Collision/b2BroadPhase.h>
+#include <Box2D/Collision/b2Collision.h>
+#include <Box2D/Collision/Shapes/b2CapsuleShape.h>
+#include <Box2D/Collision/Shapes/b2ChainShape.h>
+#include <Box2D/Collision/Shapes/b2CircleShape.h>
+#include <Box2D/Collision/Shapes/b2CompoundShape.h>
+#include <Box2D/Collision/Shapes/b2EdgeShape.h>
+#include <Box2D/Collision/Shapes/b2HeightFieldShape.h>
+#include <Box2D/Collision/Shapes/b2PolygonShape.h>
+#include <Box2D/Common/b2Draw.h>
+#include <Box2D/Dynamics/b2Body.h>
+#include <Box2D/Dynamics/b2Fixture.h>
+#include <Box2D/Dynamics/b2TimeStep.h>
+#include <Box2D/Dynamics/b2World.h>
+#include <algorithm>
+#include <memory.h>
+
+#if defined(B2_SIMD_SSE2)
+#include <emmintrin.h>
+#endif
+
+// A particle touching a fixture. The fixture surface is linearized to the
+// plane dot(normal, p) = offset + radius.
+struct b2ParticleBodyContact
+{
+	int32 index;		// in cell order
+	int32 bodyIndex;	// into the touched dynamic bodies, or -1
+	b2Body* body;
+	b2Vec2 normal;		// from the fixture to the particle
+	b2Vec2 point;
+	float32 offset;
+	float32 approach;	// normal speed towards the fixture before the solve
+	float32 push;		// distance the particle was moved along the normal
+	float32 residual;	// overlap left by the stabilization of a sub-step
+};
+
+// A dynamic body touching particles. The body moves with the particles it
+// pushes during the solve, in proportion to the mass ratio.
+struct b2ParticleBody
+{
+	b2Body* body;
+	float32 share;		// of a correction taken by the particle
+	b2Vec2 shift;
+};
+
+// The number of sub-steps solved with one set of contacts.
+static const int32 b2_particleSearchInterval = 4;
+
+// A sub-step corrects a particle by at most this fraction of the radius. The
+// rest of a deep overlap is separated by the next sub-steps without adding
+// velocity, so that particles squeezed by a heavy body don't shoot away.
+static const float32 b2_particleMaxCorrection = 0.5f;
+
+// Particles closer than this fraction of the radius beyond touching are
+// contact candidates, so that resting contacts aren't lost to gravity.
+static const float32 b2_particleMargin = 0.5f;
+
+// The tag of a grid cell sorts row by row. The coordinates are offset so
+// that neighbouring cells have consecutive tags; they wrap after 65536 cells.
+inline uint32 b2CellTag(int32 x, int32 y)
+{
+	return ((uint32)(y + 0x8000) << 16) | ((uint32)(x + 0x8000) & 0xffff);
+}
+
+inline int32 b2CellCoordinate(float32 x, float32 inverseCellSize)
+{
+	return (int32)floorf(x * inverseCellSize);
+}
+
+template <typename T>
+inline T* b2Reallocate(T* old, int32 oldCount, int32 newCount)
+{
+	T* data = (T*)b2Alloc(newCount * sizeof(T));
+	if (old)
+	{
+		memcpy(data, old, oldCount * sizeof(T));
+		b2Free(old);
+	}
+	return data;
+}
+
+b2ParticleSystem::b2ParticleSystem(const b2ParticleSystemDef* def, b2World* world)
+{
+	b2Assert(def->radius > 0.0f);
+	b2Assert(def->density >= 0.0f);
+	b2Assert(def->iterations >= 1);
+
+	m_world = world;
+	m_prev = NULL;
+	m_next = NULL;
+
+	m_radius = def->radius;
+	m_diameter = 2.0f * def->radius;
+	m_margin = b2_particleMargin * def->radius;
+	m_inverseCellSize = 1.0f / (m_diameter + m_margin);
+	m_mass = def->density * b2_pi * m_radius * m_radius;
+	m_gravityScale = def->gravityScale;
+	m_damping = def->damping;
+	m_friction = def->friction;
+	m_iterations = def->iterations;
+	m_filter = def->filter;
+
+	m_count = 0;
+	m_capacity = 0;
+	m_positionX = NULL;
+	m_positionY = NULL;
+	m_velocityX = NULL;
+	m_velocityY = NULL;
+	m_userData = NULL;
+
+	m_scratchCapacity = 0;
+	m_order = NULL;
+	m_tags = NULL;
+	m_sortBuffer = NULL;
+	m_tagBuffer = NULL;
+	m_x0 = NULL;
+	m_y0 = NULL;
+	m_x = NULL;
+	m_y = NULL;
+	m_predictedX = NULL;
+	m_predictedY = NULL;
+	m_vx = NULL;
+	m_vy = NULL;
+	m_colorMasks = NULL;
+
+	m_contactA = NULL;
+	m_contactB = NULL;
+	m_contactBufferA = NULL;
+	m_contactBufferB = NULL;
+	m_contactGroups = NULL;
+	m_contactCount = 0;
+	m_contactCapacity = 0;
+
+	m_bodyContacts = NULL;
+	m_bodyContactCount = 0;
+	m_bodyContactCapacity = 0;
+
+	m_bodies = NULL;
+	m_bodyCount = 0;
+	m_bodyCapacity = 0;
+}
+
+b2ParticleSystem::~b2ParticleSystem()
+{
+	b2Free(m_positionX);
+	b2Free(m_positionY);
+	b2Free(m_velocityX);
+	b2Free(m_velocityY);
+	b2Free(m_userData);
+
+	b2Free(m_order);
+	b2Free(m_tags);
+	b2Free(m_sortBuffer);
+	b2Free(m_tagBuffer);
+	b2Free(m_x0);
+	b2Free(m_y0);
+	b2Free(m_x);
+	b2Free(m_y);
+	b2Free(m_predictedX);
+	b2Free(m_predictedY);
+	b2Free(m_vx);
+	b2Free(m_vy);
+	b2Free(m_colorMasks);
+
+	b2Free(m_contactA);
+	b2Free(m_contactB);
+	b2Free(m_contactBufferA);
+	b2Free(m_contactBufferB);
+	b2Free(m_contactGroups);
+	b2Free(m_bodyContacts);
+	b2Free(m_bodies);
+}
+
+void b2ParticleSystem::Reserve(int32 capacity)
+{
+	if (capacity <= m_capacity)
+	{
+		return;
+	}
+
+	m_positionX = b2Reallocate(m_positionX, m_count, capacity);
+	m_positionY = b2Reallocate(m_positionY, m_count, capacity);
+	m_velocityX = b2Reallocate(m_velocityX, m_count, capacity);
+	m_velocityY = b2Reallocate(m_velocityY, m_count, capacity);
+	m_userData = b2Reallocate(m_userData, m_count, capacity);
+	m_capacity = capacity;
+}
+
+void b2ParticleSystem::ReserveScratch()
+{
+	if (m_scratchCapacity >= m_capacity)
+	{
+		return;
+	}
+
+	// The scratch data doesn't survive a step.
+	m_order = b2Reallocate(m_order, 0, m_capacity);
+	m_tags = b2Reallocate(m_tags, 0, m_capacity);
+	m_sortBuffer = b2Reallocate(m_sortBuffer, 0, m_capacity);
+	m_tagBuffer = b2Reallocate(m_tagBuffer, 0, m_capacity);
+	m_x0 = b2Reallocate(m_x0, 0, m_capacity);
+	m_y0 = b2Reallocate(m_y0, 0, m_capacity);
+	m_x = b2Reallocate(m_x, 0, m_capacity);
+	m_y = b2Reallocate(m_y, 0, m_capacity);
+	m_predictedX = b2Reallocate(m_predictedX, 0, m_capacity);
+	m_predictedY = b2Reallocate(m_predictedY, 0, m_capacity);
+	m_vx = b2Reallocate(m_vx, 0, m_capacity);
+	m_vy = b2Reallocate(m_vy, 0, m_capacity);
+	m_colorMasks = b2Reallocate(m_colorMasks, 0, m_capacity);
+	m_scratchCapacity = m_capacity;
+}
+
+int32 b2ParticleSystem::CreateParticle(const b2Vec2& position, const b2Vec2& velocity)
+{
+	b2Assert(m_world->IsLocked() == false);
+	if (m_world->IsLocked())
+	{
+		return -1;
+	}
+
+	if (m_count == m_capacity)
+	{
+		Reserve(b2Max(2 * m_capacity, 64));
+	}
+
+	int32 index = m_count;
+	m_positionX[index] = position.x;
+	m_positionY[index] = position.y;
+	m_velocityX[index] = velocity.x;
+	m_velocityY[index] = velocity.y;
+	m_userData[index] = NULL;
+	++m_count;
+	return index;
+}
+
+void b2ParticleSystem::DestroyParticle(int32 index)
+{
+	b2Assert(m_world->IsLocked() == false);
+	if (m_world->IsLocked())
+	{
+		return;
+	}
+
+	b2Assert(0 <= index && index < m_count);
+	--m_count;
+	m_positionX[index] = m_positionX[m_count];
+	m_positionY[index] = m_positionY[m_count];
+	m_velocityX[index] = m_velocityX[m_count];
+	m_velocityY[index] = m_velocityY[m_count];
+	m_userData[index] = m_userData[m_count];
+}
+
+void b2ParticleSystem::Solve(const b2TimeStep& step)
+{
+	m_contactCount = 0;
+	m_bodyContactCount = 0;
+	m_bodyCount = 0;
+
+	if (m_count == 0)
+	{
+		return;
+	}
+
+	ReserveScratch();
+
+	// The step is split into sub-steps. The contacts are found again after a
+	// few sub-steps, the margin covers the moves in between.
+	float32 h = step.dt / m_iterations;
+	for (int32 i = 0; i < m_iterations; i += b2_particleSearchInterval)
+	{
+		int32 count = b2Min(m_iterations - i, b2_particleSearchInterval);
+		m_contactCount = 0;
+		m_bodyContactCount = 0;
+		m_bodyCount = 0;
+
+		PredictPositions(count * h);
+		SortParticles();
+		FindContacts();
+		ColorContacts();
+		FindFixtureContacts();
+		SolvePositions(h, count);
+		SolveContinuous();
+		FinishVelocities(h, count);
+	}
+}
+
+// Predict the positions after time h into m_predictedX/Y. The contacts are
+// found there.
+void b2ParticleSystem::PredictPositions(float32 h)
+{
+	b2Vec2 g = h * m_gravityScale * m_world->GetGravity();
+
+	int32 i = 0;
+#if defined(B2_SIMD_SSE2)
+	__m128 hv = _mm_set1_ps(h);
+	__m128 gx = _mm_set1_ps(g.x);
+	__m128 gy = _mm_set1_ps(g.y);
+	for (; i + 4 <= m_count; i += 4)
+	{
+		__m128 vx = _mm_add_ps(_mm_loadu_ps(m_velocityX + i), gx);
+		__m128 vy = _mm_add_ps(_mm_loadu_ps(m_velocityY + i), gy);
+		_mm_storeu_ps(m_predictedX + i, _mm_add_ps(_mm_loadu_ps(m_positionX + i), _mm_mul_ps(hv, vx)));
+		_mm_storeu_ps(m_predictedY + i, _mm_add_ps(_mm_loadu_ps(m_positionY + i), _mm_mul_ps(hv, vy)));
+	}
+#endif
+	for (; i < m_count; ++i)
+	{
+		m_predictedX[i] = m_positionX[i] + h * (m_velocityX[i] + g.x);
+		m_predictedY[i] = m_positionY[i] + h * (m_velocityY[i] + g.y);
+	}
+}
+
+// Sort the particles by cell tag with a radix sort, which is stable, so
+// particles in a cell stay in index order.
+void b2ParticleSystem::SortParticles()
+{
+	b2Vec2 lower(b2_maxFloat, b2_maxFloat);
+	b2Vec2 upper(-b2_maxFloat, -b2_maxFloat);
+
+	uint32* tags = m_tagBuffer;
+	int32* order = m_sortBuffer;
+	for (int32 i = 0; i < m_count; ++i)
+	{
+		float32 x = m_predictedX[i];
+		float32 y = m_predictedY[i];
+		lower.x = b2Min(lower.x, x);
+		lower.y = b2Min(lower.y, y);
+		upper.x = b2Max(upper.x, x);
+		upper.y = b2Max(upper.y, y);
+
+		tags[i] = b2CellTag(b2CellCoordinate(x, m_inverseCellSize), b2CellCoordinate(y, m_inverseCellSize));
+		order[i] = i;
+	}
+
+	m_bounds.lowerBound = lower;
+	m_bounds.upperBound = upper;
+
+	uint32* tagsOut = m_tags;
+	int32* orderOut = m_order;
+	for (uint32 shift = 0; shift < 32; shift += 8)
+	{
+		int32 counts[257];
+		memset(counts, 0, sizeof(counts));
+		for (int32 i = 0; i < m_count; ++i)
+		{
+			++counts[((tags[i] >> shift) & 0xff) + 1];
+		}
+
+		// Skip a byte that all particles share.
+		if (counts[((tags[0] >> shift) & 0xff) + 1] == m_count)
+		{
+			continue;
+		}
+
+		for (int32 i = 1; i < 257; ++i)
+		{
+			counts[i] += counts[i - 1];
+		}
+
+		for (int32 i = 0; i < m_count; ++i)
+		{
+			int32 k = counts[(tags[i] >> shift) & 0xff]++;
+			tagsOut[k] = tags[i];
+			orderOut[k] = order[i];
+		}
+
+		b2Swap(tags, tagsOut);
+		b2Swap(order, orderOut);
+	}
+
+	// Keep the sorted arrays in m_tags and m_order.
+	if (tags != m_tags)
+	{
+		m_tagBuffer = m_tags;
+		m_sortBuffer = m_order;
+		m_tags = tags;
+		m_order = order;
+	}
+
+	for (int32 k = 0; k < m_count; ++k)
+	{
+		int32 i = m_order[k];
+		m_x0[k] = m_positionX[i];
+		m_y0[k] = m_positionY[i];
+		m_x[k] = m_predictedX[i];
+		m_y[k] = m_predictedY[i];
+		m_vx[k] = m_velocityX[i];
+		m_vy[k] = m_velocityY[i];
+	}
+}
+
+void b2ParticleSystem::FindContactsInRange(int32 a, int32 begin, int32 end)
+{
+	if (begin >= end)
+	{
+		return;
+	}
+
+	if (m_contactCount + (end - begin) > m_contactCapacity)
+	{
+		int32 capacity = b2Max(2 * m_contactCapacity, m_contactCount + (end - begin));
+		m_contactA = b2Reallocate(m_contactA, m_contactCount, capacity);
+		m_contactB = b2Reallocate(m_contactB, m_contactCount, capacity);
+		m_contactBufferA = b2Reallocate(m_contactBufferA, 0, capacity);
+		m_contactBufferB = b2Reallocate(m_contactBufferB, 0, capacity);
+		m_contactGroups = b2Reallocate(m_contactGroups, 0, capacity);
+		m_contactCapacity = capacity;
+	}
+
+	float32 ax = m_x[a];
+	float32 ay = m_y[a];
+	float32 distance = m_diameter + m_margin;
+	float32 distanceSquared = distance * distance;
+
+	int32 j = begin;
+#if defined(B2_SIMD_SSE2)
+	__m128 axv = _mm_set1_ps(ax);
+	__m128 ayv = _mm_set1_ps(ay);
+	__m128 dsv = _mm_set1_ps(distanceSquared);
+	for (; j + 4 <= end; j += 4)
+	{
+		__m128 dx = _mm_sub_ps(_mm_loadu_ps(m_x + j), axv);
+		__m128 dy = _mm_sub_ps(_mm_loadu_ps(m_y + j), ayv);
+		__m128 dd = _mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy));
+		int32 mask = _mm_movemask_ps(_mm_cmplt_ps(dd, dsv));
+		for (int32 k = 0; mask; ++k, mask >>= 1)
+		{
+			if (mask & 1)
+			{
+				m_contactA[m_contactCount] = a;
+				m_contactB[m_contactCount] = j + k;
+				++m_contactCount;
+			}
+		}
+	}
+#endif
+	for (; j < end; ++j)
+	{
+		float32 dx = m_x[j] - ax;
+		float32 dy = m_y[j] - ay;
+		if (dx * dx + dy * dy < distanceSquared)
+		{
+			m_contactA[m_contactCount] = a;
+			m_contactB[m_contactCount] = j;
+			++m_contactCount;
+		}
+	}
+}
+
+// A particle touches particles in its own cell and the eight around it. With
+// the cell size equal to the contact distance it is enough to look to the right in
+// the same row and at the three cells in the next row. Those are two runs of
+// consecutive tags. Their bounds only move forward as the tags increase.
+void b2ParticleSystem::FindContacts()
+{
+	int32 rowEnd = 0;
+	int32 nextBegin = 0;
+	int32 nextEnd = 0;
+	for (int32 a = 0; a < m_count; ++a)
+	{
+		uint32 tag = m_tags[a];
+
+		while (rowEnd < m_count && m_tags[rowEnd] <= tag + 1)
+		{
+			++rowEnd;
+		}
+
+		FindContactsInRange(a, a + 1, rowEnd);
+
+		uint32 nextLower = tag + 0x10000 - 1;
+		uint32 nextUpper = tag + 0x10000 + 1;
+		while (nextBegin < m_count && m_tags[nextBegin] < nextLower)
+		{
+			++nextBegin;
+		}
+
+		nextEnd = b2Max(nextEnd, nextBegin);
+		while (nextEnd < m_count && m_tags[nextEnd] <= nextUpper)
+		{
+			++nextEnd;
+		}
+
+		FindContactsInRange(a, nextBegin, nextEnd);
+	}
+}
+
+// Color the contacts greedily so that contacts of a color share no particle,
+// then sort them by color with a counting sort. A particle has few
+// neighbours, so nearly all contacts get a color. See b2ColoredSolver.
+void b2ParticleSystem::ColorContacts()
+{
+	memset(m_colorMasks, 0, m_count * sizeof(uint32));
+	memset(m_contactStarts, 0, sizeof(m_contactStarts));
+
+	for (int32 i = 0; i < m_contactCount; ++i)
+	{
+		int32 a = m_contactA[i];
+		int32 b = m_contactB[i];
+		uint32 used = m_colorMasks[a] | m_colorMasks[b];
+		int32 group = 0;
+		for (int32 color = 0; color < e_colorCount; ++color)
+		{
+			uint32 bit = 1u << color;
+			if ((used & bit) == 0)
+			{
+				m_colorMasks[a] |= bit;
+				m_colorMasks[b] |= bit;
+				group = color + 1;
+				break;
+			}
+		}
+
+		m_contactGroups[i] = group;
+		++m_contactStarts[group + 1];
+	}
+
+	for (int32 group = 1; group <= e_groupCount; ++group)
+	{
+		m_contactStarts[group] += m_contactStarts[group - 1];
+	}
+
+	int32 offsets[e_groupCount];
+	memcpy(offsets, m_contactStarts, sizeof(offsets));
+	for (int32 i = 0; i < m_contactCount; ++i)
+	{
+		int32 k = offsets[m_contactGroups[i]]++;
+		m_contactBufferA[k] = m_contactA[i];
+		m_contactBufferB[k] = m_contactB[i];
+	}
+
+	b2Swap(m_contactA, m_contactBufferA);
+	b2Swap(m_contactB, m_contactBufferB);
+}
+
+static void b2CollideParticle(b2Manifold* manifold, const b2Shape* shape, int32 childIndex,
+							  const b2Transform& xf, const b2CircleShape* circle, const b2Transform& xfP)
+{
+	switch (shape->GetType())
+	{
+	case b2Shape::e_circle:
+		b2CollideCircles(manifold, (const b2CircleShape*)shape, xf, circle, xfP);
+		break;
+
+	case b2Shape::e_edge:
+		b2CollideEdgeAndCircle(manifold, (const b2EdgeShape*)shape, xf, circle, xfP);
+		break;
+
+	case b2Shape::e_polygon:
+		b2CollidePolygonAndCircle(manifold, (const b2PolygonShape*)shape, xf, circle, xfP);
+		break;
+
+	case b2Shape::e_chain:
+		{
+			b2EdgeShape edge;
+			((const b2ChainShape*)shape)->GetChildEdge(&edge, childIndex);
+			b2CollideEdgeAndCircle(manifold, &edge, xf, circle, xfP);
+		}
+		break;
+
+	case b2Shape::e_compound:
+		{
+			b2PolygonShape polygon;
+			((const b2CompoundShape*)shape)->GetChildPolygon(&polygon, childIndex);
+			b2CollidePolygonAndCircle(manifold, &polygon, xf, circle, xfP);
+		}
+		break;
+
+	case b2Shape::e_heightField:
+		{
+			b2EdgeShape edge;
+			((const b2HeightFieldShape*)shape)->GetChildEdge(&edge, childIndex);
+			b2CollideEdgeAndCircle(manifold, &edge, xf, circle, xfP);
+		}
+		break;
+
+	case b2Shape::e_capsule:
+		b2CollideCapsuleAndCircle(manifold, (const b2CapsuleShape*)shape, xf, circle, xfP);
+		break;
+
+	default:
+		b2Assert(false);
+		manifold->pointCount = 0;
+		break;
+	}
+}
+
+// The island index of a body is free after the island solve. It holds the
+// index of the body in m_bodies during the particle solve.
+int32 b2ParticleSystem::AddBody(b2Body* body)
+{
+	if (body->m_type != b2_dynamicBody)
+	{
+		return -1;
+	}
+
+	int32 index = body->m_islandIndex;
+	if (0 <= index && index < m_bodyCount && m_bodies[index].body == body)
+	{
+		return index;
+	}
+
+	if (m_bodyCount == m_bodyCapacity)
+	{
+		int32 capacity = b2Max(2 * m_bodyCapacity, 16);
+		m_bodies = b2Reallocate(m_bodies, m_bodyCount, capacity);
+		m_bodyCapacity = capacity;
+	}
+
+	index = m_bodyCount++;
+	body->m_islandIndex = index;
+	b2ParticleBody* b = m_bodies + index;
+	b->body = body;
+	b->share = 1.0f / (1.0f + m_mass * body->m_invMass);
+	b->shift.SetZero();
+	return index;
+}
+
+// Collide the particles near a fixture child. The particles in a row of cells
+// are a run of consecutive tags.
+void b2ParticleSystem::CollideFixture(b2Fixture* fixture, int32 childIndex)
+{
+	b2Body* body = fixture->GetBody();
+	const b2Transform& xf = body->GetTransform();
+	const b2Shape* shape = fixture->GetShape();
+
+	b2AABB aabb;
+	shape->ComputeAABB(&aabb, xf, childIndex);
+
+	b2Vec2 r(m_radius + m_margin, m_radius + m_margin);
+	b2Vec2 lower = b2Max(aabb.lowerBound - r, m_bounds.lowerBound);
+	b2Vec2 upper = b2Min(aabb.upperBound + r, m_bounds.upperBound);
+	if (lower.x > upper.x || lower.y > upper.y)
+	{
+		return;
+	}
+
+	int32 x0 = b2CellCoordinate(lower.x, m_inverseCellSize);
+	int32 x1 = b2CellCoordinate(upper.x, m_inverseCellSize);
+	int32 y0 = b2CellCoordinate(lower.y, m_inverseCellSize);
+	int32 y1 = b2CellCoordinate(upper.y, m_inverseCellSize);
+
+	// Use a larger circle to find the contacts close to touching.
+	b2CircleShape circle;
+	circle.m_radius = m_radius + m_margin;
+	b2Transform xfP;
+	xfP.q.SetIdentity();
+
+	for (int32 y = y0; y <= y1; ++y)
+	{
+		uint32 first = b2CellTag(x0, y);
+		uint32 last = b2CellTag(x1, y);
+		int32 k = (int32)(std::lower_bound(m_tags, m_tags + m_count, first) - m_tags);
+		for (; k < m_count && m_tags[k] <= last; ++k)
+		{
+			b2Vec2 p(m_x[k], m_y[k]);
+			if (p.x < lower.x || p.y < lower.y || p.x > upper.x || p.y > upper.y)
+			{
+				continue;
+			}
+
+			xfP.p = p;
+			b2Manifold manifold;
+			b2CollideParticle(&manifold, shape, childIndex, xf, &circle, xfP);
+			if (manifold.pointCount == 0)
+			{
+				continue;
+			}
+
+			b2WorldManifold worldManifold;
+			worldManifold.Initialize(&manifold, xf, shape->m_radius, xfP, m_radius);
+
+			if (m_bodyContactCount == m_bodyContactCapacity)
+			{
+				int32 capacity = b2Max(2 * m_bodyContactCapacity, 64);
+				m_bodyContacts = b2Reallocate(m_bodyContacts, m_bodyContactCount, capacity);
+				m_bodyContactCapacity = capacity;
+			}
+
+			int32 i = m_order[k];
+			b2Vec2 v(m_velocityX[i], m_velocityY[i]);
+			b2Vec2 n = worldManifold.normal;
+
+			b2ParticleBodyContact* c = m_bodyContacts + m_bodyContactCount;
+			c->index = k;
+			c->bodyIndex = AddBody(body);
+			c->body = body;
+			c->normal = n;
+			c->point = worldManifold.points[0];
+			c->offset = b2Dot(n, p) - worldManifold.separations[0];
+			c->approach = -b2Dot(n, v - body->GetLinearVelocityFromWorldPoint(c->point));
+			c->push = 0.0f;
+			c->residual = 0.0f;
+			++m_bodyContactCount;
+		}
+	}
+}
+
+// Finds the fixtures near the particles through the broad-phase. The
+// broad-phase skips the fixtures that don't pass the particle filter.
+struct b2ParticleFixtureQuery : public b2ChildQueryCallback
+{
+	bool QueryCallback(int32 proxyId)
+	{
+		b2FixtureProxy* proxy = (b2FixtureProxy*)broadPhase->GetUserData(proxyId);
+		b2Fixture* fixture = proxy->fixture;
+		if (fixture->IsSensor())
+		{
+			return true;
+		}
+
+		const b2Shape* shape = fixture->GetShape();
+		if (shape->HasChildQuery() == false)
+		{
+			system->CollideFixture(fixture, proxy->childIndex);
+			return true;
+		}
+
+		// Bound the particles in the frame of the shape.
+		const b2Transform& xf = fixture->GetBody()->GetTransform();
+		b2Vec2 c = b2MulT(xf, bounds.GetCenter());
+		b2Vec2 h = bounds.GetExtents();
+		b2Vec2 r;
+		r.x = b2Abs(xf.q.c) * h.x + b2Abs(xf.q.s) * h.y;
+		r.y = b2Abs(xf.q.s) * h.x + b2Abs(xf.q.c) * h.y;
+
+		b2AABB localAABB;
+		localAABB.lowerBound = c - r;
+		localAABB.upperBound = c + r;
+
+		parent = fixture;
+		shape->QueryChildren(this, localAABB);
+		return true;
+	}
+
+	bool ReportChild(int32 childIndex)
+	{
+		system->CollideFixture(parent, childIndex);
+		return true;
+	}
+
+	const b2BroadPhase* broadPhase;
+	b2ParticleSystem* system;
+	b2Fixture* parent;
+	b2AABB bounds;
+};
+
+void b2ParticleSystem::FindFixtureContacts()
+{
+	b2Vec2 r(m_radius + m_margin, m_radius + m_margin);
+
+	b2ParticleFixtureQuery query;
+	query.broadPhase = &m_world->m_contactManager.m_broadPhase;
+	query.system = this;
+	query.parent = NULL;
+	query.bounds.lowerBound = m_bounds.lowerBound - r;
+	query.bounds.upperBound = m_bounds.upperBound + r;
+	query.broadPhase->Query(&query, query.bounds, m_filter);
+}
+
+// Push a touching pair apart, half the overlap each.
+inline void b2SolveParticlePair(float32* x, float32* y, int32 a, int32 b, float32 diameter)
+{
+	float32 dx = x[b] - x[a];
+	float32 dy = y[b] - y[a];
+	float32 d = b2Sqrt(dx * dx + dy * dy);
+	float32 s = 0.5f * b2Min(d - diameter, 0.0f) / b2Max(d, b2_epsilon);
+	float32 px = s * dx;
+	float32 py = s * dy;
+	if (d < b2_epsilon)
+	{
+		// Separate coincident particles along x.
+		px = -0.5f * diameter;
+		py = 0.0f;
+	}
+
+	x[a] += px;
+	y[a] += py;
+	x[b] -= px;
+	y[b] -= py;
+}
+
+// Gauss-Seidel relaxation of the particle pairs. Contacts of one color share
+// no particle, so four of them are relaxed at once and written back in place.
+void b2ParticleSystem::SolvePairs()
+{
+	const float32 diameter = m_diameter;
+	float32* x = m_x;
+	float32* y = m_y;
+
+	for (int32 i = m_contactStarts[0]; i < m_contactStarts[1]; ++i)
+	{
+		b2SolveParticlePair(x, y, m_contactA[i], m_contactB[i], diameter);
+	}
+
+	for (int32 group = 1; group < e_groupCount; ++group)
+	{
+		int32 i = m_contactStarts[group];
+		int32 end = m_contactStarts[group + 1];
+#if defined(B2_SIMD_SSE2)
+		__m128 diameterv = _mm_set1_ps(diameter);
+		__m128 half = _mm_set1_ps(0.5f);
+		__m128 zero = _mm_setzero_ps();
+		__m128 epsilon = _mm_set1_ps(b2_epsilon);
+		for (; i + 4 <= end; i += 4)
+		{
+			const int32* a = m_contactA + i;
+			const int32* b = m_contactB + i;
+			__m128 xa = _mm_setr_ps(x[a[0]], x[a[1]], x[a[2]], x[a[3]]);
+			__m128 ya = _mm_setr_ps(y[a[0]], y[a[1]], y[a[2]], y[a[3]]);
+			__m128 xb = _mm_setr_ps(x[b[0]], x[b[1]], x[b[2]], x[b[3]]);
+			__m128 yb = _mm_setr_ps(y[b[0]], y[b[1]], y[b[2]], y[b[3]]);
+			__m128 dx = _mm_sub_ps(xb, xa);
+			__m128 dy = _mm_sub_ps(yb, ya);
+			__m128 d = _mm_sqrt_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)));
+			__m128 overlap = _mm_min_ps(_mm_sub_ps(d, diameterv), zero);
+			__m128 s = _mm_div_ps(_mm_mul_ps(half, overlap), _mm_max_ps(d, epsilon));
+			__m128 px = _mm_mul_ps(s, dx);
+			__m128 py = _mm_mul_ps(s, dy);
+
+			float32 outA[8], outB[8];
+			_mm_storeu_ps(outA, _mm_add_ps(xa, px));
+			_mm_storeu_ps(outA + 4, _mm_add_ps(ya, py));
+			_mm_storeu_ps(outB, _mm_sub_ps(xb, px));
+			_mm_storeu_ps(outB + 4, _mm_sub_ps(yb, py));
+			int32 coincident = _mm_movemask_ps(_mm_cmplt_ps(d, epsilon));
+			for (int32 k = 0; k < 4; ++k)
+			{
+				if (coincident & (1 << k))
+				{
+					b2SolveParticlePair(x, y, a[k], b[k], diameter);
+					continue;
+				}
+
+				x[a[k]] = outA[k];
+				y[a[k]] = outA[k + 4];
+				x[b[k]] = outB[k];
+				y[b[k]] = outB[k + 4];
+			}
+		}
+#endif
+		for (; i < end; ++i)
+		{
+			b2SolveParticlePair(x, y, m_contactA[i], m_contactB[i], diameter);
+		}
+	}
+}
+
+float32 b2ParticleSystem::GetSeparation(const b2ParticleBodyContact& c) const
+{
+	float32 separation = c.normal.x * m_x[c.index] + c.normal.y * m_y[c.index] - c.offset;
+	if (c.bodyIndex >= 0)
+	{
+		separation -= b2Dot(c.normal, m_bodies[c.bodyIndex].shift);
+	}
+	return separation;
+}
+
+// Project the particles out of the fixtures. Fixtures of dynamic bodies give
+// way in proportion to the mass ratio and go first, a body pressing particles
+// into the ground must not push them through it. When stabilizing the
+// particles alone move and nothing is recorded. The overlap that remains, of
+// a particle trapped between a body and the ground, is separated again by
+// every sub-step and must not add up to an impulse.
+void b2ParticleSystem::SolveFixtures(bool stabilize)
+{
+	for (int32 pass = 0; pass < 2; ++pass)
+	{
+		for (int32 j = 0; j < m_bodyContactCount; ++j)
+		{
+			b2ParticleBodyContact* c = m_bodyContacts + j;
+			b2BodyType type = c->body->GetType();
+			bool solve = pass == 0 ? type == b2_dynamicBody : type != b2_dynamicBody;
+			if (solve == false)
+			{
+				continue;
+			}
+
+			float32 separation = GetSeparation(*c);
+			if (separation >= 0.0f)
+			{
+				continue;
+			}
+
+			if (stabilize || c->bodyIndex < 0)
+			{
+				m_x[c->index] -= separation * c->normal.x;
+				m_y[c->index] -= separation * c->normal.y;
+				if (stabilize == false)
+				{
+					c->push -= b2Min(separation - c->residual, 0.0f);
+				}
+				continue;
+			}
+
+			b2ParticleBody* b = m_bodies + c->bodyIndex;
+			float32 push = -b->share * separation;
+			m_x[c->index] += push * c->normal.x;
+			m_y[c->index] += push * c->normal.y;
+
+			float32 depth = b2Min(separation - c->residual, 0.0f);
+			c->push -= b->share * depth;
+			b->shift += ((1.0f - b->share) * depth) * c->normal;
+		}
+	}
+
+	if (stabilize)
+	{
+		for (int32 j = 0; j < m_bodyContactCount; ++j)
+		{
+			b2ParticleBodyContact* c = m_bodyContacts + j;
+			c->residual = b2Min(GetSeparation(*c), 0.0f);
+		}
+	}
+}
+
+// Deep piles need small steps to keep their shape. Each sub-step first
+// separates the particles that overlap without adding velocity, then moves
+// them and relaxes the contacts once.
+void b2ParticleSystem::SolvePositions(float32 h, int32 count)
+{
+	float32 inv_h = 1.0f / h;
+	b2Vec2 g = h * m_gravityScale * m_world->GetGravity();
+	float32 damping = 1.0f / (1.0f + h * m_damping);
+	float32 maxCorrection = b2_particleMaxCorrection * m_radius;
+
+	memcpy(m_x, m_x0, m_count * sizeof(float32));
+	memcpy(m_y, m_y0, m_count * sizeof(float32));
+
+	for (int32 iteration = 0; iteration < count; ++iteration)
+	{
+		SolvePairs();
+		SolveFixtures(true);
+
+		int32 k = 0;
+#if defined(B2_SIMD_SSE2)
+		__m128 hv = _mm_set1_ps(h);
+		__m128 gx = _mm_set1_ps(g.x);
+		__m128 gy = _mm_set1_ps(g.y);
+		__m128 dv = _mm_set1_ps(damping);
+		for (; k + 4 <= m_count; k += 4)
+		{
+			__m128 x = _mm_loadu_ps(m_x + k);
+			__m128 y = _mm_loadu_ps(m_y + k);
+			__m128 vx = _mm_mul_ps(_mm_add_ps(_mm_loadu_ps(m_vx + k), gx), dv);
+			__m128 vy = _mm_mul_ps(_mm_add_ps(_mm_loadu_ps(m_vy + k), gy), dv);
+			_mm_storeu_ps(m_x0 + k, x);
+			_mm_storeu_ps(m_y0 + k, y);
+			_mm_storeu_ps(m_vx + k, vx);
+			_mm_storeu_ps(m_vy + k, vy);
+			_mm_storeu_ps(m_x + k, _mm_add_ps(x, _mm_mul_ps(hv, vx)));
+			_mm_storeu_ps(m_y + k, _mm_add_ps(y, _mm_mul_ps(hv, vy)));
+		}
+#endif
+		for (; k < m_count; ++k)
+		{
+			float32 vx = (m_vx[k] + g.x) * damping;
+			float32 vy = (m_vy[k] + g.y) * damping;
+			m_x0[k] = m_x[k];
+			m_y0[k] = m_y[k];
+			m_vx[k] = vx;
+			m_vy[k] = vy;
+			m_x[k] += h * vx;
+			m_y[k] += h * vy;
+		}
+
+		SolvePairs();
+		SolveFixtures(false);
+
+		k = 0;
+#if defined(B2_SIMD_SSE2)
+		__m128 inv_hv = _mm_set1_ps(inv_h);
+		__m128 maxv = _mm_set1_ps(maxCorrection);
+		__m128 one = _mm_set1_ps(1.0f);
+		for (; k + 4 <= m_count; k += 4)
+		{
+			__m128 x0 = _mm_add_ps(_mm_loadu_ps(m_x0 + k), _mm_mul_ps(hv, _mm_loadu_ps(m_vx + k)));
+			__m128 y0 = _mm_add_ps(_mm_loadu_ps(m_y0 + k), _mm_mul_ps(hv, _mm_loadu_ps(m_vy + k)));
+			__m128 cx = _mm_sub_ps(_mm_loadu_ps(m_x + k), x0);
+			__m128 cy = _mm_sub_ps(_mm_loadu_ps(m_y + k), y0);
+			__m128 length = _mm_sqrt_ps(_mm_add_ps(_mm_mul_ps(cx, cx), _mm_mul_ps(cy, cy)));
+			__m128 scale = _mm_min_ps(one, _mm_div_ps(maxv, length));
+			__m128 x = _mm_add_ps(x0, _mm_mul_ps(scale, cx));
+			__m128 y = _mm_add_ps(y0, _mm_mul_ps(scale, cy));
+			_mm_storeu_ps(m_x + k, x);
+			_mm_storeu_ps(m_y + k, y);
+			_mm_storeu_ps(m_vx + k, _mm_mul_ps(_mm_sub_ps(x, _mm_loadu_ps(m_x0 + k)), inv_hv));
+			_mm_storeu_ps(m_vy + k, _mm_mul_ps(_mm_sub_ps(y, _mm_loadu_ps(m_y0 + k)), inv_hv));
+		}
+#endif
+		for (; k < m_count; ++k)
+		{
+			b2Vec2 p0(m_x0[k] + h * m_vx[k], m_y0[k] + h * m_vy[k]);
+			b2Vec2 correction(m_x[k] - p0.x, m_y[k] - p0.y);
+			float32 length = correction.Length();
+			if (length > maxCorrection)
+			{
+				correction *= maxCorrection / length;
+			}
+
+			m_x[k] = p0.x + correction.x;
+			m_y[k] = p0.y + correction.y;
+			m_vx[k] = (m_x[k] - m_x0[k]) * inv_h;
+			m_vy[k] = (m_y[k] - m_y0[k]) * inv_h;
+		}
+	}
+}
+
+struct b2ParticleRayCastHit
+{
+	bool hit;
+	b2Vec2 point;
+	b2Vec2 normal;
+};
+
+// Finds the first fixture of a static or kinematic body along a particle move.
+struct b2ParticleRayCastFunctor
+{
+	float32 operator()(b2Fixture* fixture, const b2Vec2& point, const b2Vec2& normal, float32 fraction)
+	{
+		if (fixture->IsSensor() || fixture->GetBody()->GetType() == b2_dynamicBody)
+		{
+			return -1.0f;
+		}
+
+		result->hit = true;
+		result->point = point;
+		result->normal = normal;
+		return fraction;
+	}
+
+	b2ParticleRayCastHit* result;
+};
+
+// The fixture contacts are found at the predicted positions, so a particle
+// that moves further than the margin may pass through a thin fixture or be
+// pushed into the ground by a body. Like bullets, such particles are stopped
+// at the first static or kinematic fixture along their move.
+void b2ParticleSystem::SolveContinuous()
+{
+	float32 marginSquared = m_margin * m_margin;
+	for (int32 k = 0; k < m_count; ++k)
+	{
+		int32 i = m_order[k];
+		b2Vec2 p0(m_positionX[i], m_positionY[i]);
+		b2Vec2 p(m_x[k], m_y[k]);
+		if (b2DistanceSquared(p0, p) <= marginSquared)
+		{
+			continue;
+		}
+
+		b2ParticleRayCastHit result;
+		result.hit = false;
+		b2ParticleRayCastFunctor functor;
+		functor.result = &result;
+		m_world->RayCast(p0, p, m_filter, functor);
+		if (result.hit == false)
+		{
+			continue;
+		}
+
+		// Put the particle in front of the surface and stop it going in.
+		b2Vec2 n = result.normal;
+		p = result.point + (m_radius + b2_linearSlop) * n;
+		m_x[k] = p.x;
+		m_y[k] = p.y;
+
+		float32 vn = m_vx[k] * n.x + m_vy[k] * n.y;
+		if (vn < 0.0f)
+		{
+			m_vx[k] -= vn * n.x;
+			m_vy[k] -= vn * n.y;
+		}
+	}
+}
+
+// Apply friction and the reaction impulses to the bodies and store the
+// particles back in index order.
+void b2ParticleSystem::FinishVelocities(float32 h, int32 count)
+{
+	// The pushes of the sub-steps add up to the velocity change of one.
+	float32 inv_h = 1.0f / h;
+
+	// A particle resting on a fixture approaches it by gravity alone. Faster
+	// particles wake sleeping bodies.
+	float32 restingSpeed = count * h * m_gravityScale * m_world->GetGravity().Length() + b2_linearSleepTolerance;
+
+	for (int32 j = 0; j < m_bodyContactCount; ++j)
+	{
+		const b2ParticleBodyContact* c = m_bodyContacts + j;
+		if (c->push <= 0.0f)
+		{
+			continue;
+		}
+
+		b2Vec2 v(m_vx[c->index], m_vy[c->index]);
+		b2Vec2 vr = v - c->body->GetLinearVelocityFromWorldPoint(c->point);
+		b2Vec2 vt = vr - b2Dot(vr, c->normal) * c->normal;
+		float32 normalSpeed = c->push * inv_h;
+
+		// Coulomb friction on the velocity change of the push.
+		b2Vec2 friction(0.0f, 0.0f);
+		float32 tangentSpeed = vt.Length();
+		if (tangentSpeed > b2_epsilon)
+		{
+			friction = (-b2Min(tangentSpeed, m_friction * normalSpeed) / tangentSpeed) * vt;
+			m_vx[c->index] += friction.x;
+			m_vy[c->index] += friction.y;
+		}
+
+		if (c->body->GetType() == b2_dynamicBody)
+		{
+			b2Vec2 impulse = -m_mass * (normalSpeed * c->normal + friction);
+			c->body->ApplyLinearImpulse(impulse, c->point, c->approach > restingSpeed);
+		}
+	}
+
+	for (int32 k = 0; k < m_count; ++k)
+	{
+		int32 i = m_order[k];
+		m_positionX[i] = m_x[k];
+		m_positionY[i] = m_y[k];
+		m_velocityX[i] = m_vx[k];
+		m_velocityY[i] = m_vy[k];
+	}
+}
+
+void b2ParticleSystem::Draw(b2Draw* draw) const
+{
+	b2Color color(0.3f, 0.5f, 0.9f);
+	for (int32 i = 0; i < m_count; ++i)
+	{
+		draw->DrawCircle(b2Vec2(m_positionX[i], m_positionY[i]), m_radius, color);
+	}
+}
+
+void b2ParticleSystem::ShiftOrigin(const b2Vec2& newOrigin)
+{
+	for (int32 i = 0; i < m_count; ++i)
+	{
+		m_positionX[i] -= newOrigin.x;
+		m_positionY[i] -= newOrigin.y;
+	}
+}
@@ -0,0 +1,313 @@
+/*
+* Copyright (c) 2006-2009 Erin Catto http://www.box2d.org
+*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#ifndef B2_PARTICLE_SYSTEM_H
+#define B2_PARTICLE_SYSTEM_H
+
+#include <Box2D/Common/b2Math.h>
+#include <Box2D/Dynamics/b2Fixture.h>
+
+class b2Draw;
+class b2World;
+class b2Body;
+class b2Fixture;
+struct b2TimeStep;
+struct b2ParticleBody;
+struct b2ParticleBodyContact;
+
+/// A particle system definition holds the properties shared by all of its
+/// particles.
+struct b2ParticleSystemDef
+{
+	/// The constructor sets the default particle system definition values.
+	b2ParticleSystemDef()
+	{
+		radius = 0.05f;
+		density = 1.0f;
+		gravityScale = 1.0f;
+		damping = 0.0f;
+		friction = 0.2f;
+		iterations = 8;
+	}
+
+	/// The radius of every particle, in meters.
+	float32 radius;
+
+	/// The density, usually in kg/m^2. The particles are solid discs.
+	float32 density;
+
+	/// Scale the world gravity applied to the particles.
+	float32 gravityScale;
+
+	/// Linear damping of the particle velocities.
+	float32 damping;
+
+	/// The friction coefficient against fixtures.
+	float32 friction;
+
+	/// The number of sub-steps of the particle solve each step. Deep piles need
+	/// more sub-steps to keep their shape.
+	int32 iterations;
+
+	/// Contact filtering against fixtures. Particles of one system always
+	/// collide with each other.
+	b2Filter filter;
+};
+
+/// A particle system simulates many identical balls without the cost of a
+/// body, fixture and broad-phase proxy each. The particles are kept in
+/// arrays per attribute. Each step the particles are sorted by grid cell so
+/// that neighbours are contiguous, contacts are found four at a time with SSE2
+/// and colored so that contacts without shared particles are relaxed four at a
+/// time. Contacts with fixtures are found through the broad-phase.
+/// Particle contacts are inelastic and move the particle positions directly,
+/// the velocities follow from the positions. Fixtures of dynamic bodies get
+/// the reaction impulses. Particles don't report contacts to the listener.
+class b2ParticleSystem
+{
+public:
+
+	/// Create a particle.
+	/// @return the index of the particle, or -1 if the world is locked.
+	/// @warning This function is locked during callbacks.
+	int32 CreateParticle(const b2Vec2& position, const b2Vec2& velocity);
+
+	/// Destroy a particle. The last particle moves into its index.
+	/// @warning This function is locked during callbacks.
+	void DestroyParticle(int32 index);
+
+	/// Get the number of particles.
+	int32 GetParticleCount() const;
+
+	/// Get the position of a particle.
+	b2Vec2 GetPosition(int32 index) const;
+
+	/// Move a particle.
+	void SetPosition(int32 index, const b2Vec2& position);
+
+	/// Get the velocity of a particle.
+	b2Vec2 GetVelocity(int32 index) const;
+
+	/// Set the velocity of a particle.
+	void SetVelocity(int32 index, const b2Vec2& velocity);
+
+	/// Get the user data of a particle.
+	void* GetUserData(int32 index) const;
+
+	/// Set the user data of a particle.
+	void SetUserData(int32 index, void* data);
+
+	/// Get the particle radius.
+	float32 GetRadius() const;
+
+	/// Get the mass of one particle.
+	float32 GetParticleMass() const;
+
+	/// Get the number of particle pairs that touched in the last step.
+	int32 GetContactCount() const;
+
+	/// Get the next particle system in the world's list.
+	b2ParticleSystem* GetNext();
+	const b2ParticleSystem* GetNext() const;
+
+	/// Get the parent world of this particle system.
+	b2World* GetWorld();
+	const b2World* GetWorld() const;
+
+protected:
+
+	friend class b2World;
+	friend struct b2ParticleFixtureQuery;
+
+	enum
+	{
+		e_colorCount = 24,
+
+		// Group zero holds the contacts without a color.
+		e_groupCount = e_colorCount + 1
+	};
+
+	b2ParticleSystem(const b2ParticleSystemDef* def, b2World* world);
+	~b2ParticleSystem();
+
+	void Solve(const b2TimeStep& step);
+	void Draw(b2Draw* draw) const;
+	void ShiftOrigin(const b2Vec2& newOrigin);
+
+	void Reserve(int32 capacity);
+	void ReserveScratch();
+
+	// The steps of Solve.
+	void PredictPositions(float32 h);
+	void SortParticles();
+	void FindContacts();
+	void ColorContacts();
+	void FindFixtureContacts();
+	void CollideFixture(b2Fixture* fixture, int32 childIndex);
+	int32 AddBody(b2Body* body);
+	void SolvePositions(float32 h, int32 count);
+	void SolvePairs();
+	void SolveFixtures(bool stabilize);
+	float32 GetSeparation(const b2ParticleBodyContact& c) const;
+	void SolveContinuous();
+	void FinishVelocities(float32 h, int32 count);
+
+	// Add the pairs of particle a and the particles in [begin, end) that touch.
+	void FindContactsInRange(int32 a, int32 begin, int32 end);
+
+	b2World* m_world;
+	b2ParticleSystem* m_prev;
+	b2ParticleSystem* m_next;
+
+	float32 m_radius;
+	float32 m_diameter;
+	float32 m_margin;
+	float32 m_inverseCellSize;
+	float32 m_mass;
+	float32 m_gravityScale;
+	float32 m_damping;
+	float32 m_friction;
+	int32 m_iterations;
+	b2Filter m_filter;
+
+	// Particle attributes, by particle index.
+	int32 m_count;
+	int32 m_capacity;
+	float32* m_positionX;
+	float32* m_positionY;
+	float32* m_velocityX;
+	float32* m_velocityY;
+	void** m_userData;
+
+	// Scratch data of a step, in cell order except the predicted positions.
+	// m_order maps the cell order to the particle index.
+	int32 m_scratchCapacity;
+	float32* m_predictedX;
+	float32* m_predictedY;
+	int32* m_order;
+	uint32* m_tags;
+	int32* m_sortBuffer;
+	uint32* m_tagBuffer;
+	float32* m_x0;
+	float32* m_y0;
+	float32* m_x;
+	float32* m_y;
+	float32* m_vx;
+	float32* m_vy;
+	uint32* m_colorMasks;
+	b2AABB m_bounds;
+
+	// Particle pairs in cell order, then sorted by color.
+	int32* m_contactA;
+	int32* m_contactB;
+	int32* m_contactBufferA;
+	int32* m_contactBufferB;
+	int32* m_contactGroups;
+	int32 m_contactCount;
+	int32 m_contactCapacity;
+	int32 m_contactStarts[e_groupCount + 1];
+
+	b2ParticleBodyContact* m_bodyContacts;
+	int32 m_bodyContactCount;
+	int32 m_bodyContactCapacity;
+
+	// The dynamic bodies touching particles.
+	b2ParticleBody* m_bodies;
+	int32 m_bodyCount;
+	int32 m_bodyCapacity;
+};
+
+inline int32 b2ParticleSystem::GetParticleCount() const
+{
+	return m_count;
+}
+
+inline b2Vec2 b2ParticleSystem::GetPosition(int32 index) const
+{
+	b2Assert(0 <= index && index < m_count);
+	return b2Vec2(m_positionX[index], m_positionY[index]);
+}
+
+inline void b2ParticleSystem::SetPosition(int32 index, const b2Vec2& position)
+{
+	b2Assert(0 <= index && index < m_count);
+	m_positionX[index] = position.x;
+	m_positionY[index] = position.y;
+}
+
+inline b2Vec2 b2ParticleSystem::GetVelocity(int32 index) const
+{
+	b2Assert(0 <= index && index < m_count);
+	return b2Vec2(m_velocityX[index], m_velocityY[index]);
+}
+
+inline void b2ParticleSystem::SetVelocity(int32 index, const b2Vec2& velocity)
+{
+	b2Assert(0 <= index && index < m_count);
+	m_velocityX[index] = velocity.x;
+	m_velocityY[index] = velocity.y;
+}
+
+inline void* b2ParticleSystem::GetUserData(int32 index) const
+{
+	b2Assert(0 <= index && index < m_count);
+	return m_userData[index];
+}
+
+inline void b2ParticleSystem::SetUserData(int32 index, void* data)
+{
+	b2Assert(0 <= index && index < m_count);
+	m_userData[index] = data;
+}
+
+inline float32 b2ParticleSystem::GetRadius() const
+{
+	return m_radius;
+}
+
+inline float32 b2ParticleSystem::GetParticleMass() const
+{
+	return m_mass;
+}
+
+inline int32 b2ParticleSystem::GetContactCount() const
+{
+	return m_contactCount;
+}
+
+inline b2ParticleSystem* b2ParticleSystem::GetNext()
+{
+	return m_next;
+}
+
+inline const b2ParticleSystem* b2ParticleSystem::GetNext() const
+{
+	return m_next;
+}
+
+inline b2World* b2ParticleSystem::GetWorld()
+{
+	return m_world;
+}
+
+inline const b2World* b2ParticleSystem::GetWorld() const
+{
+	return m_world;
+}
+
+#endif